@@ -0,0 +1,125 @@
+#include "allocation_table.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define INITIAL_SLOTS 1024
+
+// Fibonacci hashing of the address; the low bits are mostly alignment, so
+// the high bits of the product are used
+static size_t hash_pointer(const AllocationTable *table, const void *ptr) {
+    uint64_t hash = (uint64_t)(uintptr_t)ptr * 0x9E3779B97F4A7C15ull;
+    return (size_t)(hash >> 32) & table->slot_mask;
+}
+
+// Slots come straight from mmap rather than malloc, so the table can track
+// malloc itself when the detector is preloaded into another program
+static MemoryBlock *allocate_slots(size_t count) {
+    void *slots = mmap(NULL, count * sizeof(MemoryBlock), PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (slots == MAP_FAILED) {
+        fputs("Error: Unable to allocate memory for tracking.\n", stderr);
+        _exit(1);
+    }
+    return slots;
+}
+
+static void release_slots(MemoryBlock *slots, size_t count) {
+    munmap(slots, count * sizeof(MemoryBlock));
+}
+
+void table_init(AllocationTable *table) {
+    memset(table, 0, sizeof(*table));
+    table->slots = allocate_slots(INITIAL_SLOTS);
+    table->slot_mask = INITIAL_SLOTS - 1;
+}
+
+void table_destroy(AllocationTable *table) {
+    if (table->slots) {
+        release_slots(table->slots, table->slot_mask + 1);
+    }
+    memset(table, 0, sizeof(*table));
+}
+
+static size_t find_slot(const AllocationTable *table, const void *ptr) {
+    size_t slot = hash_pointer(table, ptr);
+    while (table->slots[slot].ptr && table->slots[slot].ptr != ptr) {
+        slot = (slot + 1) & table->slot_mask;
+    }
+    return slot;
+}
+
+// Double the table and reinsert every live block
+static void rehash(AllocationTable *table) {
+    MemoryBlock *old_slots = table->slots;
+    size_t old_count = table->slot_mask + 1;
+    table->slots = allocate_slots(old_count * 2);
+    table->slot_mask = old_count * 2 - 1;
+    for (size_t i = 0; i < old_count; i++) {
+        if (old_slots[i].ptr) {
+            table->slots[find_slot(table, old_slots[i].ptr)] = old_slots[i];
+        }
+    }
+    release_slots(old_slots, old_count);
+}
+
+void table_insert(AllocationTable *table, void *ptr, size_t size, uint32_t stack) {
+    // Keep the load factor at or below one half
+    if ((table->live_count + 1) * 2 > table->slot_mask + 1) {
+        rehash(table);
+    }
+    MemoryBlock *slot = &table->slots[find_slot(table, ptr)];
+    if (slot->ptr) {
+        table->live_bytes -= slot->size;
+        table->live_count--;
+    }
+    slot->ptr = ptr;
+    slot->size = size;
+    slot->stack = stack;
+    table->live_count++;
+    table->live_bytes += size;
+    table->total_allocations++;
+    if (table->live_count > table->peak_count) table->peak_count = table->live_count;
+    if (table->live_bytes > table->peak_bytes) table->peak_bytes = table->live_bytes;
+}
+
+int table_remove(AllocationTable *table, void *ptr, size_t *size) {
+    size_t slot = find_slot(table, ptr);
+    if (!ptr || !table->slots[slot].ptr) {
+        return 0;
+    }
+    if (size) *size = table->slots[slot].size;
+    table->live_count--;
+    table->live_bytes -= table->slots[slot].size;
+    table->total_frees++;
+
+    // Shift later entries of the probe run back so lookups never stop at
+    // a hole
+    size_t hole = slot;
+    for (;;) {
+        slot = (slot + 1) & table->slot_mask;
+        if (!table->slots[slot].ptr) break;
+        size_t home = hash_pointer(table, table->slots[slot].ptr);
+        // Move the entry unless its home lies cyclically in (hole, slot]
+        if (((slot - home) & table->slot_mask) >= ((slot - hole) & table->slot_mask)) {
+            table->slots[hole] = table->slots[slot];
+            hole = slot;
+        }
+    }
+    table->slots[hole] = (MemoryBlock){0};
+    return 1;
+}
+
+size_t table_lookup(const AllocationTable *table, void *ptr) {
+    return ptr ? table->slots[find_slot(table, ptr)].size : 0;
+}
+
+void table_for_each(const AllocationTable *table, void (*visit)(const MemoryBlock *, void *), void *context) {
+    for (size_t i = 0; i <= table->slot_mask; i++) {
+        if (table->slots[i].ptr) {
+            visit(&table->slots[i], context);
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef ALLOCATION_TABLE_H
+#define ALLOCATION_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Open-addressing hash table of live allocations keyed by address. Linear
+// probing keeps a lookup within one or two cache lines, and removal shifts
+// later entries of the probe run back instead of leaving tombstones, so
+// the table never degrades under churn. Live totals are kept up to date on
+// every insert and remove.
+
+typedef struct {
+    void *ptr;       // NULL marks an empty slot
+    size_t size;
+    uint32_t stack;  // Stack depot id of the allocation site, 0 when unknown
+} MemoryBlock;
+
+typedef struct {
+    MemoryBlock *slots;
+    size_t slot_mask;
+    size_t live_count, live_bytes;
+    size_t peak_count, peak_bytes;
+    uint64_t total_allocations, total_frees;
+} AllocationTable;
+
+void table_init(AllocationTable *table);
+void table_destroy(AllocationTable *table);
+// Start tracking a block; an address already present is overwritten
+void table_insert(AllocationTable *table, void *ptr, size_t size, uint32_t stack);
+// Stop tracking a block. Returns 1 and its size if it was tracked.
+int table_remove(AllocationTable *table, void *ptr, size_t *size);
+// Size of a tracked block, 0 if the address is unknown
+size_t table_lookup(const AllocationTable *table, void *ptr);
+// Call visit for every live block, in no particular order
+void table_for_each(const AllocationTable *table, void (*visit)(const MemoryBlock *, void *), void *context);
+
+#endif // ALLOCATION_TABLE_H
@@ -0,0 +1,424 @@
+#include "allocation_tracker.h"
+#include "stack_depot.h"
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define SHARD_BITS 6  // log2(TRACKER_SHARDS)
+#define ORPHAN_LIMIT 4096
+
+typedef struct {
+    pthread_mutex_t lock;
+    AllocationTable table;
+    AllocationTable orphans;  // Frees of blocks not published yet; size holds the time of the free
+    size_t orphan_limit;      // Expire orphans when there are this many
+} __attribute__((aligned(64))) TrackerShard;
+
+typedef struct {
+    void *ptr;
+    size_t size;
+    uint64_t time;  // orphan_clock when the block was allocated
+    uint32_t stack;
+} TrackRecord;
+
+typedef struct {
+    LogHistogram latency_ns[TRACK_OPERATIONS];
+} ThreadMetrics;
+
+typedef struct ThreadBuffer {
+    TrackRecord records[TRACKER_BUFFER_SIZE];
+    unsigned count;
+    uint64_t oldest;  // Time of the first record since the last publish, UINT64_MAX when empty
+    int busy;         // Held by the owner around every use of the records, and by tracker_flush_all
+    int registered;
+    uintptr_t stack_low, stack_high;  // For the reachability scan
+    ThreadMetrics *metrics;           // Kept out of TLS; NULL until the first recorded latency
+    struct ThreadBuffer *next, *previous;
+} ThreadBuffer;
+
+_Static_assert(TRACKER_SHARDS == 1 << SHARD_BITS, "SHARD_BITS must match TRACKER_SHARDS");
+
+static TrackerShard shards[TRACKER_SHARDS];
+static int initialized;
+
+// Every thread with a buffer, so that all of them can be flushed at exit
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static ThreadBuffer *registry;
+static pthread_key_t exit_key;
+static pthread_once_t exit_key_once = PTHREAD_ONCE_INIT;
+
+static __thread ThreadBuffer thread_buffer __attribute__((tls_model("initial-exec")));
+
+// Histograms of the threads that have exited, under registry_lock
+static ThreadMetrics retired_metrics;
+static int metrics_enabled;
+
+// Logical clock that only advances when an orphan free is recorded, so
+// allocations read it from a cache line that is almost never written
+static uint64_t orphan_clock = 1;
+
+// The top bits of the product; the table inside the shard uses lower ones
+static TrackerShard *shard_of(const void *ptr) {
+    return &shards[((uint64_t)(uintptr_t)ptr * 0x9E3779B97F4A7C15ull) >> (64 - SHARD_BITS)];
+}
+
+void tracker_init(void) {
+    pthread_mutex_lock(&registry_lock);
+    if (!initialized) {
+        for (int i = 0; i < TRACKER_SHARDS; i++) {
+            pthread_mutex_init(&shards[i].lock, NULL);
+            table_init(&shards[i].table);
+            table_init(&shards[i].orphans);
+            shards[i].orphan_limit = ORPHAN_LIMIT;
+        }
+        initialized = 1;
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+// A spinlock rather than a mutex: the owner is almost always the only
+// thread to take it, and then it costs one atomic exchange
+static void lock_buffer(ThreadBuffer *buffer) {
+    while (__atomic_exchange_n(&buffer->busy, 1, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&buffer->busy, __ATOMIC_RELAXED)) {
+            sched_yield();
+        }
+    }
+}
+
+static void unlock_buffer(ThreadBuffer *buffer) {
+    __atomic_store_n(&buffer->busy, 0, __ATOMIC_RELEASE);
+}
+
+static void apply_alloc(TrackerShard *shard, const TrackRecord *record) {
+    if (shard->orphans.live_count) {
+        size_t freed_at = table_lookup(&shard->orphans, record->ptr);
+        if (freed_at && record->time < freed_at) {
+            // Freed by another thread before this allocation was published
+            table_remove(&shard->orphans, record->ptr, NULL);
+            return;
+        }
+    }
+    table_insert(&shard->table, record->ptr, record->size, record->stack);
+}
+
+// Move a buffer into the shards, grouping the records by shard so that
+// each lock is taken once. The caller holds the buffer.
+static void publish(ThreadBuffer *buffer) {
+    if (buffer->count == 0) {
+        return;
+    }
+    unsigned starts[TRACKER_SHARDS + 1] = {0};
+    uint8_t shard_index[TRACKER_BUFFER_SIZE];
+    TrackRecord sorted[TRACKER_BUFFER_SIZE];
+    for (unsigned i = 0; i < buffer->count; i++) {
+        shard_index[i] = (uint8_t)(shard_of(buffer->records[i].ptr) - shards);
+        starts[shard_index[i] + 1]++;
+    }
+    for (int s = 0; s < TRACKER_SHARDS; s++) {
+        starts[s + 1] += starts[s];
+    }
+    unsigned next[TRACKER_SHARDS];
+    memcpy(next, starts, sizeof(next));
+    for (unsigned i = 0; i < buffer->count; i++) {
+        sorted[next[shard_index[i]]++] = buffer->records[i];
+    }
+
+    for (int s = 0; s < TRACKER_SHARDS; s++) {
+        if (starts[s] == starts[s + 1]) continue;
+        pthread_mutex_lock(&shards[s].lock);
+        for (unsigned i = starts[s]; i < starts[s + 1]; i++) {
+            apply_alloc(&shards[s], &sorted[i]);
+        }
+        pthread_mutex_unlock(&shards[s].lock);
+    }
+    buffer->count = 0;
+    __atomic_store_n(&buffer->oldest, UINT64_MAX, __ATOMIC_SEQ_CST);
+}
+
+static void unregister_thread(void *argument) {
+    ThreadBuffer *buffer = argument;
+    lock_buffer(buffer);
+    publish(buffer);
+    unlock_buffer(buffer);
+    pthread_mutex_lock(&registry_lock);
+    if (buffer->previous) {
+        buffer->previous->next = buffer->next;
+    } else {
+        registry = buffer->next;
+    }
+    if (buffer->next) {
+        buffer->next->previous = buffer->previous;
+    }
+    ThreadMetrics *metrics = buffer->metrics;
+    if (metrics) {
+        for (int i = 0; i < TRACK_OPERATIONS; i++) {
+            histogram_merge(&retired_metrics.latency_ns[i], &metrics->latency_ns[i]);
+        }
+        buffer->metrics = NULL;
+    }
+    pthread_mutex_unlock(&registry_lock);
+    // Off the registry, so no collector can be reading it any more
+    if (metrics) {
+        munmap(metrics, sizeof(ThreadMetrics));
+    }
+    buffer->registered = 0;
+}
+
+static void create_exit_key(void) {
+    pthread_key_create(&exit_key, unregister_thread);
+}
+
+// The key's destructor publishes whatever is left when the thread exits
+static void register_thread(ThreadBuffer *buffer) {
+    current_stack_bounds(&buffer->stack_low, &buffer->stack_high);
+    pthread_once(&exit_key_once, create_exit_key);
+    pthread_setspecific(exit_key, buffer);
+    buffer->oldest = UINT64_MAX;
+    pthread_mutex_lock(&registry_lock);
+    buffer->previous = NULL;
+    buffer->next = registry;
+    if (registry) {
+        registry->previous = buffer;
+    }
+    registry = buffer;
+    pthread_mutex_unlock(&registry_lock);
+    buffer->registered = 1;
+}
+
+void tracker_alloc(void *ptr, size_t size, uint32_t stack) {
+    ThreadBuffer *buffer = &thread_buffer;
+    if (!buffer->registered) {
+        register_thread(buffer);
+    }
+    lock_buffer(buffer);
+    uint64_t time = __atomic_load_n(&orphan_clock, __ATOMIC_SEQ_CST);
+    if (buffer->count == 0) {
+        __atomic_store_n(&buffer->oldest, time, __ATOMIC_SEQ_CST);
+    }
+    buffer->records[buffer->count++] = (TrackRecord){ptr, size, time, stack};
+    if (buffer->count == TRACKER_BUFFER_SIZE) {
+        publish(buffer);
+    }
+    unlock_buffer(buffer);
+}
+
+typedef struct {
+    AllocationTable *kept;
+    uint64_t cutoff;
+} ExpireContext;
+
+static void keep_recent_orphan(const MemoryBlock *orphan, void *context) {
+    ExpireContext *expire = context;
+    if ((uint64_t)orphan->size > expire->cutoff) {
+        table_insert(expire->kept, orphan->ptr, orphan->size, 0);
+    }
+}
+
+// Drop the orphans that no allocation can cancel any more. A record only
+// cancels an orphan freed after the record was made, and every record
+// still in a buffer was made no earlier than its buffer's oldest time, so
+// orphans freed at or before the oldest time of every buffer are frees of
+// blocks that were never tracked. An allocation that could still cancel
+// one stored its buffer's oldest time before the block could be passed to
+// the freeing thread, so the scan below cannot miss it. Whatever is left
+// doubles the limit, so that a thread sitting on old records makes the
+// table grow instead of rescanning it on every free.
+static void expire_orphans(TrackerShard *shard) {
+    uint64_t cutoff = __atomic_load_n(&orphan_clock, __ATOMIC_SEQ_CST);
+    pthread_mutex_lock(&registry_lock);
+    for (ThreadBuffer *buffer = registry; buffer; buffer = buffer->next) {
+        uint64_t oldest = __atomic_load_n(&buffer->oldest, __ATOMIC_SEQ_CST);
+        if (oldest < cutoff) cutoff = oldest;
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    pthread_mutex_lock(&shard->lock);
+    AllocationTable kept;
+    table_init(&kept);
+    ExpireContext expire = {&kept, cutoff};
+    table_for_each(&shard->orphans, keep_recent_orphan, &expire);
+    table_destroy(&shard->orphans);
+    shard->orphans = kept;
+    shard->orphan_limit = kept.live_count * 2 > ORPHAN_LIMIT ? kept.live_count * 2 : ORPHAN_LIMIT;
+    pthread_mutex_unlock(&shard->lock);
+}
+
+size_t tracker_free(void *ptr) {
+    ThreadBuffer *buffer = &thread_buffer;
+    lock_buffer(buffer);
+    // Newest first: most blocks are freed soon after they are allocated
+    for (unsigned i = buffer->count; i-- > 0;) {
+        if (buffer->records[i].ptr == ptr) {
+            size_t size = buffer->records[i].size;
+            buffer->records[i] = buffer->records[--buffer->count];
+            if (buffer->count == 0) {
+                __atomic_store_n(&buffer->oldest, UINT64_MAX, __ATOMIC_SEQ_CST);
+            }
+            unlock_buffer(buffer);
+            return size;
+        }
+    }
+    unlock_buffer(buffer);
+
+    size_t size = 0;
+    int expire = 0;
+    TrackerShard *shard = shard_of(ptr);
+    pthread_mutex_lock(&shard->lock);
+    if (!table_remove(&shard->table, ptr, &size)) {
+        uint64_t time = __atomic_add_fetch(&orphan_clock, 1, __ATOMIC_SEQ_CST);
+        table_insert(&shard->orphans, ptr, (size_t)time, 0);
+        expire = shard->orphans.live_count >= shard->orphan_limit;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    // Outside the shard lock: registry_lock is taken before shard locks
+    if (expire) {
+        expire_orphans(shard);
+    }
+    return size;
+}
+
+void tracker_flush(void) {
+    ThreadBuffer *buffer = &thread_buffer;
+    lock_buffer(buffer);
+    publish(buffer);
+    unlock_buffer(buffer);
+}
+
+void tracker_flush_all(void) {
+    pthread_mutex_lock(&registry_lock);
+    for (ThreadBuffer *buffer = registry; buffer; buffer = buffer->next) {
+        lock_buffer(buffer);
+        publish(buffer);
+        // Stale records would look like live pointers to a reachability scan
+        memset(buffer->records, 0, sizeof(buffer->records));
+        unlock_buffer(buffer);
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+static void copy_block(const MemoryBlock *block, void *context) {
+    table_insert(context, block->ptr, block->size, block->stack);
+}
+
+void tracker_collect(AllocationTable *into) {
+    for (int s = 0; s < TRACKER_SHARDS; s++) {
+        pthread_mutex_lock(&shards[s].lock);
+        table_for_each(&shards[s].table, copy_block, into);
+        pthread_mutex_unlock(&shards[s].lock);
+    }
+}
+
+void tracker_for_each_thread(void (*visit)(uintptr_t low, uintptr_t high, void *context), void *context) {
+    pthread_mutex_lock(&registry_lock);
+    for (ThreadBuffer *buffer = registry; buffer; buffer = buffer->next) {
+        if (buffer->stack_high) {
+            visit(buffer->stack_low, buffer->stack_high, context);
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+void tracker_enable_metrics(void) {
+    pthread_mutex_lock(&registry_lock);
+    if (!metrics_enabled) {
+        for (int i = 0; i < TRACK_OPERATIONS; i++) {
+            histogram_init(&retired_metrics.latency_ns[i]);
+        }
+        metrics_enabled = 1;
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+// Histograms come from mmap, like the tables, so that creating them never
+// re-enters malloc
+static ThreadMetrics *new_thread_metrics(void) {
+    void *memory = mmap(NULL, sizeof(ThreadMetrics), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return NULL;
+    }
+    ThreadMetrics *metrics = memory;
+    for (int i = 0; i < TRACK_OPERATIONS; i++) {
+        histogram_init(&metrics->latency_ns[i]);
+    }
+    return metrics;
+}
+
+void tracker_record_latency(TrackOperation operation, uint64_t nanoseconds) {
+    ThreadBuffer *buffer = &thread_buffer;
+    if (!metrics_enabled) {
+        return;
+    }
+    if (!buffer->registered) {
+        register_thread(buffer);
+    }
+    if (!buffer->metrics) {
+        ThreadMetrics *metrics = new_thread_metrics();
+        if (!metrics) {
+            return;
+        }
+        // Collectors read the pointer under registry_lock only
+        pthread_mutex_lock(&registry_lock);
+        buffer->metrics = metrics;
+        pthread_mutex_unlock(&registry_lock);
+    }
+    histogram_record(&buffer->metrics->latency_ns[operation], nanoseconds);
+}
+
+void tracker_collect_metrics(TrackerMetrics *metrics) {
+    memset(metrics, 0, sizeof(*metrics));
+    pthread_mutex_lock(&registry_lock);
+    for (int i = 0; i < TRACK_OPERATIONS; i++) {
+        metrics->latency_ns[i] = retired_metrics.latency_ns[i];
+    }
+    for (ThreadBuffer *buffer = registry; buffer; buffer = buffer->next) {
+        metrics->threads++;
+        if (buffer->metrics) {
+            for (int i = 0; i < TRACK_OPERATIONS; i++) {
+                histogram_merge(&metrics->latency_ns[i], &buffer->metrics->latency_ns[i]);
+            }
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+    for (int s = 0; s < TRACKER_SHARDS; s++) {
+        pthread_mutex_lock(&shards[s].lock);
+        metrics->live_blocks += shards[s].table.live_count;
+        metrics->live_bytes += shards[s].table.live_bytes;
+        metrics->published_allocations += shards[s].table.total_allocations;
+        metrics->published_frees += shards[s].table.total_frees;
+        pthread_mutex_unlock(&shards[s].lock);
+    }
+}
+
+// Buffers too, so that the child does not inherit one half-updated
+void tracker_lock_all(void) {
+    pthread_mutex_lock(&registry_lock);
+    for (ThreadBuffer *buffer = registry; buffer; buffer = buffer->next) {
+        lock_buffer(buffer);
+    }
+    for (int s = 0; s < TRACKER_SHARDS; s++) {
+        pthread_mutex_lock(&shards[s].lock);
+    }
+}
+
+void tracker_unlock_all(void) {
+    for (int s = TRACKER_SHARDS; s-- > 0;) {
+        pthread_mutex_unlock(&shards[s].lock);
+    }
+    for (ThreadBuffer *buffer = registry; buffer; buffer = buffer->next) {
+        unlock_buffer(buffer);
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+// In a forked child the locks may have been copied while held
+void tracker_reset_locks(void) {
+    pthread_mutex_init(&registry_lock, NULL);
+    for (ThreadBuffer *buffer = registry; buffer; buffer = buffer->next) {
+        buffer->busy = 0;
+    }
+    for (int s = 0; s < TRACKER_SHARDS; s++) {
+        pthread_mutex_init(&shards[s].lock, NULL);
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef ALLOCATION_TRACKER_H
+#define ALLOCATION_TRACKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "allocation_table.h"
+#include "metrics.h"
+
+// Allocation tracking for multithreaded programs. The global table is split
+// into TRACKER_SHARDS tables, each behind its own lock and picked by a hash
+// of the address, so threads touching different blocks rarely meet.
+//
+// Allocations are not published one by one: each thread appends them to a
+// private buffer and moves the whole buffer into the shards when it fills
+// up, taking each shard lock once per batch. A free first looks in the
+// calling thread's own buffer, which catches short-lived blocks without
+// touching any shared state; otherwise it is applied to its shard at once,
+// before the memory can be handed out again.
+//
+// A block freed by another thread before its owner published it leaves an
+// "orphan" free in the shard. Orphan frees advance a logical clock that
+// every allocation reads, so when the allocation is published later it can
+// tell whether it happened before that free (and cancel it) or is a later
+// reuse of the address (and insert it as a new block). Orphans are only
+// expired once every buffered allocation is newer than them.
+
+#define TRACKER_SHARDS 64
+#define TRACKER_BUFFER_SIZE 128
+
+typedef enum {
+    TRACK_ALLOC,
+    TRACK_FREE,
+    TRACK_OPERATIONS
+} TrackOperation;
+
+// Latency of the tracking operations of every thread, and the published
+// live totals of the shards
+typedef struct {
+    LogHistogram latency_ns[TRACK_OPERATIONS];
+    uint64_t threads;  // Threads currently registered
+    uint64_t live_blocks, live_bytes;
+    uint64_t published_allocations, published_frees;
+} TrackerMetrics;
+
+// Prepare the shards; safe to call more than once
+void tracker_init(void);
+// Record a new block and the stack depot id of its allocation site in the
+// calling thread's buffer
+void tracker_alloc(void *ptr, size_t size, uint32_t stack);
+// Forget a block. Returns the size it was tracked with, 0 if unknown.
+size_t tracker_free(void *ptr);
+// Publish the calling thread's buffer
+void tracker_flush(void);
+// Publish every registered thread's buffer. Each buffer is locked against
+// its owner while it is moved, so other threads may keep running; what
+// they allocate afterwards stays in their buffers.
+void tracker_flush_all(void);
+// Copy every live block into a table
+void tracker_collect(AllocationTable *into);
+// Call visit with the stack bounds of every registered thread
+void tracker_for_each_thread(void (*visit)(uintptr_t low, uintptr_t high, void *context), void *context);
+// Start keeping latency histograms. Each thread records into its own,
+// created on its first operation, and they are folded into a process-wide
+// total when it exits.
+void tracker_enable_metrics(void);
+// Record how long one operation of the calling thread took
+void tracker_record_latency(TrackOperation operation, uint64_t nanoseconds);
+// Sum the histograms of every thread. The histograms of running threads
+// are read while they may be recording, so a total can be a few operations
+// behind its buckets; nothing is stopped to collect them.
+void tracker_collect_metrics(TrackerMetrics *metrics);
+// Buffer and shard locking around fork, for pthread_atfork
+void tracker_lock_all(void);
+void tracker_unlock_all(void);
+void tracker_reset_locks(void);
+
+#endif // ALLOCATION_TRACKER_H
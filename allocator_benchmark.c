@@ -0,0 +1,424 @@
+// Replays synthetic allocation workloads through every allocator path of
+// the simulators and reports, per workload and allocator:
+//   ns_per_op      - wall time per allocation or free, sampling excluded
+//   peak_rss_kib   - high-water mark of the process while replaying, and
+//                    how far it rose above the resident size before the replay
+//   fragmentation  - external fragmentation, 1 - largest free / total free,
+//                    sampled at regular points: mean and worst
+//
+// Workloads draw sizes from a uniform, a bimodal or a heavy-tailed (Pareto)
+// distribution, with one allocation per tick or with bursts of allocations
+// separated by quiet ticks. Lifetimes are exponential, with a mean chosen to
+// keep about FILL_TARGET of the memory in use. Every allocator replays the
+// same operations, each in a forked child so that its RSS is its own.
+//
+// Output is one JSON object per line (or CSV) for regression tracking.
+//
+// Usage: allocator_benchmark [--allocations N] [--memory SIZE] [--seed N] [--format json|csv]
+
+#include "mem_allocate.h"
+#include "buddy_allocator.h"
+#include "frame_bitmap.h"
+#include "metrics.h"
+#include "size_parse.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define DEFAULT_ALLOCATIONS 1000000
+#define DEFAULT_MEMORY (16u << 20)  // Units
+#define FRAME_UNITS 64  // Units per frame of the frame bitmap; requests are rounded up to frames
+#define FILL_TARGET 0.8
+#define BURST_PERIOD 1024  // Ticks between bursts, each of BURST_PERIOD allocations
+#define SAMPLES 256        // Fragmentation samples per replay
+
+typedef enum { SIZES_UNIFORM, SIZES_BIMODAL, SIZES_HEAVY_TAILED } SizeDistribution;
+
+typedef struct {
+    const char *name;
+    SizeDistribution sizes;
+    int bursty;
+} Workload;
+
+static const Workload workloads[] = {
+    {"uniform", SIZES_UNIFORM, 0},
+    {"bimodal", SIZES_BIMODAL, 0},
+    {"heavy_tailed", SIZES_HEAVY_TAILED, 0},
+    {"bursty", SIZES_BIMODAL, 1},
+};
+
+typedef enum { PATH_FIRST_FIT, PATH_BEST_FIT, PATH_BUDDY, PATH_FRAMES, PATH_COUNT } AllocatorPath;
+
+static const char *path_names[PATH_COUNT] = {"first_fit", "best_fit", "buddy", "frame_bitmap"};
+
+// Operations refer to objects by index; an object is allocated once and
+// freed once, in that order
+typedef struct {
+    uint32_t object;
+    uint32_t is_free;
+} Operation;
+
+typedef struct {
+    uint64_t *sizes;  // Per object
+    Operation *operations;
+    size_t object_count, operation_count;
+} Trace;
+
+typedef struct {
+    long long tick;
+    uint32_t object;
+} Expiry;
+
+typedef struct {
+    size_t operations, failed;
+    double seconds;
+    size_t samples;
+    double fragmentation_sum, fragmentation_max;
+    uint64_t free_blocks_max;
+    uint64_t requested, granted;  // Over successful allocations
+    uint64_t baseline_rss;        // KiB resident when the replay started
+} ReplayResult;
+
+static uint64_t random_state;
+
+static uint64_t next_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+// Uniform in (0, 1]
+static double random_unit(void) {
+    return (double)((next_random() >> 11) + 1) * 0x1p-53;
+}
+
+static uint64_t draw_size(SizeDistribution sizes, uint64_t memory) {
+    switch (sizes) {
+        case SIZES_BIMODAL:
+            // Mostly small objects with an occasional large buffer
+            return next_random() % 10 ? 16 + next_random() % 113 : 8192 + next_random() % 24577;
+        case SIZES_HEAVY_TAILED: {
+            // Pareto with alpha 1.2 from 16 units, capped at 1/64 of memory
+            double size = 16.0 / pow(random_unit(), 1.0 / 1.2);
+            return size < (double)(memory / 64) ? (uint64_t)size : memory / 64;
+        }
+        default:
+            return 1 + next_random() % 4096;
+    }
+}
+
+static void expiry_push(Expiry *heap, size_t *count, Expiry expiry) {
+    size_t i = (*count)++;
+    while (i > 0 && heap[(i - 1) / 2].tick > expiry.tick) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = expiry;
+}
+
+static Expiry expiry_pop(Expiry *heap, size_t *count) {
+    Expiry top = heap[0], last = heap[--(*count)];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= *count) break;
+        if (child + 1 < *count && heap[child + 1].tick < heap[child].tick) child++;
+        if (heap[child].tick >= last.tick) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+static void *allocate_or_exit(size_t bytes) {
+    void *memory = malloc(bytes);
+    if (!memory) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        exit(1);
+    }
+    return memory;
+}
+
+// Turn a workload into a sequence of allocations and frees
+static void generate_trace(Trace *trace, const Workload *workload, size_t allocations, uint64_t memory) {
+    trace->object_count = allocations;
+    trace->sizes = allocate_or_exit(allocations * sizeof(uint64_t));
+    trace->operations = allocate_or_exit(2 * allocations * sizeof(Operation));
+    trace->operation_count = 0;
+    Expiry *heap = allocate_or_exit(allocations * sizeof(Expiry));
+    size_t live = 0;
+
+    double mean_size = 0;
+    for (size_t i = 0; i < allocations; i++) {
+        trace->sizes[i] = draw_size(workload->sizes, memory);
+        mean_size += (double)trace->sizes[i] / (double)allocations;
+    }
+    // One allocation per tick on average, so the mean lifetime is the mean
+    // number of live objects
+    double mean_lifetime = FILL_TARGET * (double)memory / mean_size;
+
+    size_t next = 0;
+    for (long long tick = 0; next < allocations; tick++) {
+        while (live && heap[0].tick <= tick) {
+            trace->operations[trace->operation_count++] = (Operation){expiry_pop(heap, &live).object, 1};
+        }
+        size_t arrivals = !workload->bursty ? 1 : tick % BURST_PERIOD == 0 ? BURST_PERIOD : 0;
+        for (; arrivals && next < allocations; arrivals--, next++) {
+            trace->operations[trace->operation_count++] = (Operation){(uint32_t)next, 0};
+            long long lifetime = (long long)(-mean_lifetime * log(random_unit())) + 1;
+            expiry_push(heap, &live, (Expiry){tick + lifetime, (uint32_t)next});
+        }
+    }
+    while (live) {
+        trace->operations[trace->operation_count++] = (Operation){expiry_pop(heap, &live).object, 1};
+    }
+    free(heap);
+}
+
+static void free_trace(Trace *trace) {
+    free(trace->sizes);
+    free(trace->operations);
+}
+
+// A field of /proc/self/status in KiB, 0 when it cannot be read
+static uint64_t status_kib(const char *field) {
+    FILE *status = fopen("/proc/self/status", "r");
+    char line[256];
+    uint64_t value = 0;
+    size_t length = strlen(field);
+    while (status && fgets(line, sizeof(line), status)) {
+        if (strncmp(line, field, length) == 0 && line[length] == ':') {
+            value = strtoull(line + length + 1, NULL, 10);
+            break;
+        }
+    }
+    if (status) fclose(status);
+    return value;
+}
+
+// Reset the RSS high-water mark to the current RSS (Linux 4.0 and later)
+static void reset_peak_rss(void) {
+    FILE *clear_refs = fopen("/proc/self/clear_refs", "w");
+    if (clear_refs) {
+        fputs("5", clear_refs);
+        fclose(clear_refs);
+    }
+}
+
+// Start measuring RSS once the replay's inputs and handles are resident
+static void start_rss_measurement(ReplayResult *result) {
+    result->baseline_rss = status_kib("VmRSS");
+    reset_peak_rss();
+}
+
+static void record_fragmentation(ReplayResult *result, uint64_t free_units, uint64_t largest, uint64_t free_blocks) {
+    double fragmentation = free_units ? 1.0 - (double)largest / (double)free_units : 0.0;
+    result->samples++;
+    result->fragmentation_sum += fragmentation;
+    if (fragmentation > result->fragmentation_max) result->fragmentation_max = fragmentation;
+    if (free_blocks > result->free_blocks_max) result->free_blocks_max = free_blocks;
+}
+
+// Replay through the memory map with one of the placement strategies
+static void replay_memory_list(const Trace *trace, AllocatorPath path, uint64_t memory_size, ReplayResult *result) {
+    MemoryList memory;
+    initialize_memory(&memory, memory_size);
+    if (path == PATH_BUDDY) {
+        buddy_enable(&memory);
+    }
+    Process *processes = calloc(trace->object_count, sizeof(Process));
+    if (!processes) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < trace->object_count; i++) {
+        snprintf(processes[i].code, sizeof(processes[i].code), "B%u", (unsigned)(i % 100000000));
+        processes[i].memory_required = trace->sizes[i];
+        processes[i].allocation_status = 'N';
+    }
+    start_rss_measurement(result);
+
+    size_t sample_every = trace->operation_count / SAMPLES + 1;
+    double started = metrics_now_seconds();
+    for (size_t i = 0; i < trace->operation_count; i++) {
+        Process *process = &processes[trace->operations[i].object];
+        if (trace->operations[i].is_free) {
+            complete_process(&memory, process);
+        } else {
+            BlockId block = path == PATH_BUDDY      ? allocate_buddy(&memory, process)
+                            : path == PATH_BEST_FIT ? allocate_best_fit(&memory, process)
+                                                    : allocate_first_fit(&memory, process);
+            if (block == NO_BLOCK) {
+                result->failed++;
+            } else {
+                process->allocation_status = 'Y';
+                result->requested += process->memory_required;
+                result->granted += memory.size[block];
+            }
+        }
+        if (i % sample_every == 0) {
+            result->seconds += metrics_now_seconds() - started;
+            record_fragmentation(result, memory.free_size, largest_free_block(&memory),
+                                 (uint64_t)memory.free_blocks);
+            started = metrics_now_seconds();
+        }
+    }
+    result->seconds += metrics_now_seconds() - started;
+    result->operations = trace->operation_count;
+    free(processes);
+    free_memory(&memory);
+}
+
+static uint64_t frames_for(uint64_t size) {
+    return (size + FRAME_UNITS - 1) / FRAME_UNITS;
+}
+
+// Replay through the paging simulator's frame bitmap, which hands out whole
+// frames of FRAME_UNITS units
+static void replay_frames(const Trace *trace, uint64_t memory_size, ReplayResult *result) {
+    uint64_t frame_count = memory_size / FRAME_UNITS;
+    FrameBitmap frames;
+    uint64_t *first_frames = malloc(trace->object_count * sizeof(uint64_t));
+    if (!first_frames || !frames_init(&frames, frame_count)) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        exit(1);
+    }
+    memset(first_frames, 0xff, trace->object_count * sizeof(uint64_t));
+    start_rss_measurement(result);
+
+    size_t sample_every = trace->operation_count / SAMPLES + 1;
+    double started = metrics_now_seconds();
+    for (size_t i = 0; i < trace->operation_count; i++) {
+        uint32_t object = trace->operations[i].object;
+        if (trace->operations[i].is_free) {
+            if (first_frames[object] != NO_FRAME) {
+                frame_free_run(&frames, first_frames[object], frames_for(trace->sizes[object]));
+            }
+        } else {
+            first_frames[object] = frame_alloc_run(&frames, frames_for(trace->sizes[object]));
+            if (first_frames[object] == NO_FRAME) {
+                result->failed++;
+            } else {
+                result->requested += trace->sizes[object];
+                result->granted += frames_for(trace->sizes[object]) * FRAME_UNITS;
+            }
+        }
+        if (i % sample_every == 0) {
+            result->seconds += metrics_now_seconds() - started;
+            // Walk the free runs; not part of the measured time
+            uint64_t largest = 0, runs = 0;
+            for (uint64_t frame = frame_next_free(&frames, 0); frame != NO_FRAME;) {
+                uint64_t end = frame_next_used(&frames, frame);
+                if (end - frame > largest) largest = end - frame;
+                runs++;
+                frame = end < frame_count ? frame_next_free(&frames, end) : NO_FRAME;
+            }
+            record_fragmentation(result, frames_free(&frames) * FRAME_UNITS, largest * FRAME_UNITS, runs);
+            started = metrics_now_seconds();
+        }
+    }
+    result->seconds += metrics_now_seconds() - started;
+    result->operations = trace->operation_count;
+    free(first_frames);
+    frames_destroy(&frames);
+}
+
+static void print_result(const Workload *workload, AllocatorPath path, const ReplayResult *result,
+                         uint64_t memory_size, uint64_t peak_rss, int json) {
+    double ns_per_op = result->operations ? result->seconds * 1e9 / (double)result->operations : 0.0;
+    double fragmentation_mean = result->samples ? result->fragmentation_sum / (double)result->samples : 0.0;
+    double internal = result->granted ? 1.0 - (double)result->requested / (double)result->granted : 0.0;
+    uint64_t rss_growth = peak_rss > result->baseline_rss ? peak_rss - result->baseline_rss : 0;
+    if (json) {
+        printf("{\"workload\": \"%s\", \"allocator\": \"%s\", \"memory\": %" PRIu64 ", \"operations\": %zu"
+               ", \"failed_allocations\": %zu, \"ns_per_op\": %.2f, \"peak_rss_kib\": %" PRIu64
+               ", \"rss_growth_kib\": %" PRIu64 ", \"external_fragmentation_mean\": %.4f"
+               ", \"external_fragmentation_max\": %.4f, \"internal_fragmentation\": %.4f"
+               ", \"free_blocks_max\": %" PRIu64 "}\n",
+               workload->name, path_names[path], memory_size, result->operations, result->failed, ns_per_op,
+               peak_rss, rss_growth, fragmentation_mean, result->fragmentation_max, internal,
+               result->free_blocks_max);
+    } else {
+        printf("%s,%s,%" PRIu64 ",%zu,%zu,%.2f,%" PRIu64 ",%" PRIu64 ",%.4f,%.4f,%.4f,%" PRIu64 "\n",
+               workload->name, path_names[path], memory_size, result->operations, result->failed, ns_per_op,
+               peak_rss, rss_growth, fragmentation_mean, result->fragmentation_max, internal,
+               result->free_blocks_max);
+    }
+    fflush(stdout);
+}
+
+// Run one workload through one allocator in a child process
+static int run_case(const Workload *workload, AllocatorPath path, size_t allocations, uint64_t memory_size,
+                    uint64_t seed, int json) {
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (child == 0) {
+        // The same seed gives every allocator the same operations
+        random_state = seed;
+        Trace trace;
+        generate_trace(&trace, workload, allocations, memory_size);
+        ReplayResult result = {0};
+        if (path == PATH_FRAMES) {
+            replay_frames(&trace, memory_size, &result);
+        } else {
+            replay_memory_list(&trace, path, memory_size, &result);
+        }
+        print_result(workload, path, &result, memory_size, status_kib("VmHWM"), json);
+        free_trace(&trace);
+        _exit(0);
+    }
+    int status;
+    if (waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "%s/%s: benchmark child failed\n", workload->name, path_names[path]);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    size_t allocations = DEFAULT_ALLOCATIONS;
+    uint64_t memory_size = DEFAULT_MEMORY, seed = 0x9E3779B97F4A7C15ull;
+    int json = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--allocations") == 0 && i + 1 < argc) {
+            allocations = (size_t)parse_size(argv[++i]);
+        } else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc) {
+            memory_size = parse_size(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc &&
+                   (strcmp(argv[i + 1], "json") == 0 || strcmp(argv[i + 1], "csv") == 0)) {
+            json = strcmp(argv[++i], "json") == 0;
+        } else {
+            fprintf(stderr, "Usage: %s [--allocations N] [--memory SIZE] [--seed N] [--format json|csv]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (allocations == 0 || allocations > UINT32_MAX || memory_size < 64 * FRAME_UNITS || seed == 0) {
+        fprintf(stderr, "Error: allocations, memory and seed must be positive, with memory at least 4K\n");
+        return 1;
+    }
+
+    if (!json) {
+        printf("workload,allocator,memory,operations,failed_allocations,ns_per_op,peak_rss_kib,rss_growth_kib,"
+               "external_fragmentation_mean,external_fragmentation_max,internal_fragmentation,free_blocks_max\n");
+    }
+    int failed = 0;
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+        for (int path = 0; path < PATH_COUNT; path++) {
+            failed |= run_case(&workloads[w], (AllocatorPath)path, allocations, memory_size, seed, json) < 0;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,83 @@
+#include "allocator_metrics.h"
+#include <string.h>
+#include <inttypes.h>
+
+void allocator_metrics_init(AllocatorMetrics *metrics, FILE *output, uint64_t every) {
+    memset(metrics, 0, sizeof(*metrics));
+    histogram_init(&metrics->allocate_ns);
+    histogram_init(&metrics->free_ns);
+    histogram_init(&metrics->blocks_scanned);
+    metrics->every = every;
+    metrics->output = output;
+    metrics->started_ns = metrics_now_ns();
+}
+
+// Snapshot once every `every` operations
+static void count_operation(MemoryList *memory) {
+    AllocatorMetrics *metrics = memory->metrics;
+    if (++metrics->operations == metrics->every) {
+        metrics->operations = 0;
+        allocator_metrics_snapshot(memory);
+    }
+}
+
+void allocator_metrics_allocation(MemoryList *memory, uint64_t started_ns, uint32_t scanned, BlockId block) {
+    AllocatorMetrics *metrics = memory->metrics;
+    histogram_record(&metrics->allocate_ns, metrics_now_ns() - started_ns);
+    histogram_record(&metrics->blocks_scanned, scanned);
+    if (block == NO_BLOCK) {
+        metrics->failures++;
+    } else {
+        metrics->allocations++;
+    }
+    count_operation(memory);
+}
+
+void allocator_metrics_free(MemoryList *memory, uint64_t started_ns) {
+    AllocatorMetrics *metrics = memory->metrics;
+    histogram_record(&metrics->free_ns, metrics_now_ns() - started_ns);
+    metrics->frees++;
+    count_operation(memory);
+}
+
+// External fragmentation: the share of free memory outside the largest
+// free block, 0 when all free memory is in one piece
+static double external_fragmentation(const MemoryList *memory, uint64_t largest) {
+    return memory->free_size ? 1.0 - (double)largest / (double)memory->free_size : 0.0;
+}
+
+void allocator_metrics_snapshot(const MemoryList *memory) {
+    AllocatorMetrics *metrics = memory->metrics;
+    if (!metrics->output) {
+        return;
+    }
+    uint64_t largest = largest_free_block(memory);
+    SnapshotWriter writer;
+    snapshot_begin(&writer, metrics->output, "mem_allocate",
+                   (double)(metrics_now_ns() - metrics->started_ns) / 1e9);
+    snapshot_count(&writer, "snapshot", metrics->snapshots++);
+    snapshot_count(&writer, "allocations", metrics->allocations);
+    snapshot_count(&writer, "failures", metrics->failures);
+    snapshot_count(&writer, "frees", metrics->frees);
+    snapshot_count(&writer, "live_processes", (uint64_t)memory->total_processes);
+    snapshot_count(&writer, "free_blocks", (uint64_t)memory->free_blocks);
+    snapshot_count(&writer, "free_size", memory->free_size);
+    snapshot_count(&writer, "largest_free_block", largest);
+    snapshot_ratio(&writer, "external_fragmentation", external_fragmentation(memory, largest));
+    snapshot_histogram(&writer, "allocate_ns", &metrics->allocate_ns);
+    snapshot_histogram(&writer, "free_ns", &metrics->free_ns);
+    snapshot_histogram(&writer, "blocks_scanned", &metrics->blocks_scanned);
+    snapshot_end(&writer);
+}
+
+void print_allocator_metrics(const AllocatorMetrics *metrics) {
+    printf("\nAllocator Metrics:\n");
+    printf("  Allocations          : %" PRIu64 " placed, %" PRIu64 " failed\n", metrics->allocations,
+           metrics->failures);
+    print_histogram_summary(stdout, "Allocate latency", &metrics->allocate_ns, "ns");
+    print_histogram_summary(stdout, "Free latency", &metrics->free_ns, "ns");
+    print_histogram_summary(stdout, "Blocks scanned", &metrics->blocks_scanned, "blocks");
+    if (metrics->output) {
+        printf("  Snapshots written    : %" PRIu64 "\n", metrics->snapshots);
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef ALLOCATOR_METRICS_H
+#define ALLOCATOR_METRICS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "mem_allocate.h"
+#include "metrics.h"
+
+// Instrumentation of a MemoryList. While memory->metrics is set, every
+// allocation and release records its latency, and every allocation the
+// number of free blocks its search visited (tree nodes for the fit
+// strategies, one free-list head for the buddy system). Every `every`
+// operations a snapshot of the histograms and of the fragmentation of the
+// memory map is appended to the output file.
+//
+// free_memory() clears the pointer, so attach the metrics after
+// buddy_enable().
+
+typedef struct AllocatorMetrics {
+    LogHistogram allocate_ns, free_ns, blocks_scanned;
+    uint64_t allocations, failures, frees;
+    uint64_t operations, every;  // Snapshot every `every` operations, 0 for none
+    uint64_t started_ns, snapshots;
+    FILE *output;                // NULL to only keep the totals
+} AllocatorMetrics;
+
+void allocator_metrics_init(AllocatorMetrics *metrics, FILE *output, uint64_t every);
+// Record an allocation that started at started_ns and returned block
+void allocator_metrics_allocation(MemoryList *memory, uint64_t started_ns, uint32_t scanned, BlockId block);
+// Record a release that started at started_ns
+void allocator_metrics_free(MemoryList *memory, uint64_t started_ns);
+// Append a snapshot of the metrics and the current memory map
+void allocator_metrics_snapshot(const MemoryList *memory);
+void print_allocator_metrics(const AllocatorMetrics *metrics);
+
+#endif // ALLOCATOR_METRICS_H
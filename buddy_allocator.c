@@ -0,0 +1,216 @@
+#include "buddy_allocator.h"
+#include "free_block_index.h"
+#include "allocator_metrics.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+// Order of a power-of-two size
+static uint32_t order_of(uint64_t size) {
+    return 63 - (uint32_t)__builtin_clzll(size);
+}
+
+// Smallest order whose blocks hold size units
+static uint32_t order_for(uint64_t size) {
+    return size <= 1 ? 0 : 64 - (uint32_t)__builtin_clzll(size - 1);
+}
+
+// Keep the per-block arrays as large as the memory map
+static void reserve_links(MemoryList *memory) {
+    BuddyAllocator *buddy = memory->buddy;
+    if (buddy->capacity >= memory->capacity) {
+        return;
+    }
+    uint32_t capacity = memory->capacity;
+    BlockId *free_next = realloc(buddy->free_next, capacity * sizeof(BlockId));
+    BlockId *free_previous = realloc(buddy->free_previous, capacity * sizeof(BlockId));
+    uint64_t *requested = realloc(buddy->requested, capacity * sizeof(uint64_t));
+    if (!free_next || !free_previous || !requested) {
+        fprintf(stderr, "Memory allocation failed for buddy allocator.\n");
+        exit(1);
+    }
+    buddy->free_next = free_next;
+    buddy->free_previous = free_previous;
+    buddy->requested = requested;
+    buddy->capacity = capacity;
+}
+
+static void push_free(MemoryList *memory, BlockId block) {
+    BuddyAllocator *buddy = memory->buddy;
+    uint32_t order = order_of(memory->size[block]);
+    BlockId head = buddy->free_heads[order];
+    buddy->free_next[block] = head;
+    buddy->free_previous[block] = NO_BLOCK;
+    if (head != NO_BLOCK) {
+        buddy->free_previous[head] = block;
+    }
+    buddy->free_heads[order] = block;
+    buddy->nonempty |= 1ull << order;
+    memory->free_blocks++;
+    memory->free_size += memory->size[block];
+}
+
+static void remove_free(MemoryList *memory, BlockId block) {
+    BuddyAllocator *buddy = memory->buddy;
+    uint32_t order = order_of(memory->size[block]);
+    BlockId next = buddy->free_next[block], previous = buddy->free_previous[block];
+    if (previous != NO_BLOCK) {
+        buddy->free_next[previous] = next;
+    } else {
+        buddy->free_heads[order] = next;
+        if (next == NO_BLOCK) buddy->nonempty &= ~(1ull << order);
+    }
+    if (next != NO_BLOCK) {
+        buddy->free_previous[next] = previous;
+    }
+    memory->free_blocks--;
+    memory->free_size -= memory->size[block];
+}
+
+// Create a free block right after another one in address order
+static BlockId insert_block_after(MemoryList *memory, BlockId block, uint64_t start, uint64_t size) {
+    BlockId created = new_block(memory);
+    reserve_links(memory);
+    memory->start_address[created] = start;
+    memory->size[created] = size;
+    memory->block_status[created] = 'f';
+    memory->process_id[created] = NO_PROCESS;
+    memory->previous[created] = block;
+    memory->next[created] = NO_BLOCK;
+    if (block != NO_BLOCK) {
+        memory->next[created] = memory->next[block];
+        if (memory->next[block] != NO_BLOCK) {
+            memory->previous[memory->next[block]] = created;
+        }
+        memory->next[block] = created;
+    }
+    return created;
+}
+
+void buddy_enable(MemoryList *memory) {
+    uint64_t total_size = memory->total_size;
+    free_memory(memory);
+    initialize_memory(memory, total_size);
+
+    memory->buddy = calloc(1, sizeof(BuddyAllocator));
+    if (!memory->buddy) {
+        fprintf(stderr, "Memory allocation failed for buddy allocator.\n");
+        exit(1);
+    }
+    for (int order = 0; order < BUDDY_MAX_ORDERS; order++) {
+        memory->buddy->free_heads[order] = NO_BLOCK;
+    }
+    reserve_links(memory);
+
+    // Cut the single free block into aligned power-of-two blocks, largest
+    // first, so that each one starts at a multiple of its own size
+    BlockId block = memory->head;
+    free_index_remove(memory, block);
+    uint64_t address = 0;
+    for (int order = 63; order >= 0; order--) {
+        uint64_t size = 1ull << order;
+        if (!(total_size & size)) continue;
+        if (address == 0) {
+            memory->size[block] = size;
+        } else {
+            block = insert_block_after(memory, block, address, size);
+        }
+        if (memory->buddy->largest_block == 0) memory->buddy->largest_block = size;
+        push_free(memory, block);
+        address += size;
+    }
+}
+
+void buddy_destroy(BuddyAllocator *buddy) {
+    free(buddy->free_next);
+    free(buddy->free_previous);
+    free(buddy->requested);
+    free(buddy);
+}
+
+BlockId allocate_buddy(MemoryList *memory, Process *process) {
+    uint64_t started = memory->metrics ? metrics_now_ns() : 0;
+    BuddyAllocator *buddy = memory->buddy;
+    uint32_t order = order_for(process->memory_required);
+    if (order >= BUDDY_MAX_ORDERS || !(buddy->nonempty >> order)) {
+        if (memory->metrics) {
+            allocator_metrics_allocation(memory, started, 0, NO_BLOCK);
+        }
+        return NO_BLOCK;
+    }
+    uint32_t found = order + (uint32_t)__builtin_ctzll(buddy->nonempty >> order);
+    BlockId block = buddy->free_heads[found];
+    remove_free(memory, block);
+
+    // Split down to the requested order, freeing the upper halves
+    while (found > order) {
+        found--;
+        uint64_t half = 1ull << found;
+        memory->size[block] = half;
+        push_free(memory, insert_block_after(memory, block, memory->start_address[block] + half, half));
+        buddy->splits++;
+    }
+    claim_block(memory, block, process);
+    buddy->requested[block] = process->memory_required;
+    buddy->requested_bytes += process->memory_required;
+    buddy->allocated_bytes += memory->size[block];
+    // The free-order mask leads straight to the one block taken
+    if (memory->metrics) {
+        allocator_metrics_allocation(memory, started, 1, block);
+    }
+    return block;
+}
+
+BlockId buddy_release(MemoryList *memory, BlockId block) {
+    BuddyAllocator *buddy = memory->buddy;
+    if (memory->block_status[block] != 'a') {
+        return block;
+    }
+    buddy->requested_bytes -= buddy->requested[block];
+    buddy->allocated_bytes -= memory->size[block];
+    vacate_block(memory, block);
+
+    for (;;) {
+        uint64_t start = memory->start_address[block], size = memory->size[block];
+        uint64_t buddy_start = start ^ size;
+        BlockId other = buddy_start > start ? memory->next[block] : memory->previous[block];
+        if (other == NO_BLOCK || memory->block_status[other] != 'f' ||
+            memory->start_address[other] != buddy_start || memory->size[other] != size) {
+            break;
+        }
+        remove_free(memory, other);
+        if (buddy_start < start) {
+            memory->size[other] = size << 1;
+            unlink_block(memory, block);
+            block = other;
+        } else {
+            memory->size[block] = size << 1;
+            unlink_block(memory, other);
+        }
+        buddy->merges++;
+    }
+    push_free(memory, block);
+    return block;
+}
+
+uint64_t buddy_largest_free(const MemoryList *memory) {
+    uint64_t nonempty = memory->buddy->nonempty;
+    return nonempty ? 1ull << order_of(nonempty) : 0;
+}
+
+void print_buddy_usage(const MemoryList *memory) {
+    const BuddyAllocator *buddy = memory->buddy;
+    uint64_t waste = buddy->allocated_bytes - buddy->requested_bytes;
+    printf("  %-14s %8" PRIu64 " requested / %8" PRIu64 " allocated, internal fragmentation %5.1f%%\n",
+           "Buddy blocks", buddy->requested_bytes, buddy->allocated_bytes,
+           buddy->allocated_bytes ? 100.0 * (double)waste / (double)buddy->allocated_bytes : 0.0);
+    printf("  %-14s %8" PRIu64 " splits, %8" PRIu64 " merges\n", "", buddy->splits, buddy->merges);
+    for (uint32_t order = 0; order < BUDDY_MAX_ORDERS; order++) {
+        if (!(buddy->nonempty & (1ull << order))) continue;
+        uint32_t count = 0;
+        for (BlockId block = buddy->free_heads[order]; block != NO_BLOCK; block = buddy->free_next[block]) {
+            count++;
+        }
+        printf("  %-14s order %2u (%" PRIu64 "): %u free\n", "", order, (uint64_t)1 << order, count);
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef BUDDY_ALLOCATOR_H
+#define BUDDY_ALLOCATOR_H
+
+#include <stdint.h>
+#include "mem_allocate.h"
+
+// Binary buddy allocation over the blocks of a MemoryList. Every block has
+// a power-of-two size and is aligned to it, so the buddy of the block at
+// address a with size s starts at a ^ s and is always its list neighbour.
+// Free blocks sit in one list per order; a bit mask of non-empty orders
+// finds the smallest usable order with a single count-trailing-zeros.
+// Memory that is not a power of two is covered by several top-level
+// blocks, one per set bit of the total size.
+
+#define BUDDY_MAX_ORDERS 64
+
+typedef struct BuddyAllocator {
+    BlockId free_heads[BUDDY_MAX_ORDERS];  // Free list of each order
+    uint64_t nonempty;                     // Bit k set when order k has a free block
+    BlockId *free_next, *free_previous;    // Free list links, indexed by BlockId
+    uint64_t *requested;                   // Size asked for by the owner of each allocated block
+    uint32_t capacity;
+    uint64_t largest_block;                // Largest top-level block, the biggest possible allocation
+    // Accounting
+    uint64_t requested_bytes, allocated_bytes;  // Live totals; the difference is internal fragmentation
+    uint64_t splits, merges;
+} BuddyAllocator;
+
+// Switch an empty memory map to buddy allocation. The map is rebuilt from
+// scratch, so no process may hold memory.
+void buddy_enable(MemoryList *memory);
+void buddy_destroy(BuddyAllocator *buddy);
+// Place a process in the smallest power-of-two block that holds it,
+// splitting larger blocks as needed. Returns NO_BLOCK when none is free.
+BlockId allocate_buddy(MemoryList *memory, Process *process);
+// Free a block and merge it with its buddy for as long as the buddy is free
+BlockId buddy_release(MemoryList *memory, BlockId block);
+uint64_t buddy_largest_free(const MemoryList *memory);
+void print_buddy_usage(const MemoryList *memory);
+
+#endif // BUDDY_ALLOCATOR_H
@@ -0,0 +1,170 @@
+#include "compaction.h"
+#include "free_block_index.h"
+#include "metrics.h"
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+static double begin_pass(CompactionStats *stats) {
+    stats->passes++;
+    stats->low = UINT64_MAX;
+    stats->high = 0;
+    return metrics_now_seconds();
+}
+
+static void end_pass(CompactionStats *stats, double started) {
+    double pause = metrics_now_seconds() - started;
+    stats->pause_seconds += pause;
+    if (pause > stats->longest_pause) stats->longest_pause = pause;
+}
+
+// Lowest free block, NO_BLOCK when memory is full
+static BlockId lowest_hole(const MemoryList *memory) {
+    return free_index_first_fit(memory, 0, NULL);
+}
+
+// Move an allocated block down over the free block right before it. The
+// free block ends up after it, merged with any free block that follows,
+// and is returned.
+static BlockId slide_down(MemoryList *memory, BlockId block, CompactionStats *stats) {
+    BlockId hole = memory->previous[block];
+    BlockId before = memory->previous[hole], after = memory->next[block];
+
+    free_index_remove(memory, hole);
+    memory->start_address[block] = memory->start_address[hole];
+    memory->start_address[hole] = memory->start_address[block] + memory->size[block];
+
+    memory->previous[block] = before;
+    if (before != NO_BLOCK) {
+        memory->next[before] = block;
+    } else {
+        memory->head = block;
+    }
+    memory->next[block] = hole;
+    memory->previous[hole] = block;
+    memory->next[hole] = after;
+    if (after != NO_BLOCK) {
+        memory->previous[after] = hole;
+        if (memory->block_status[after] == 'f') {
+            free_index_remove(memory, after);
+            memory->size[hole] += memory->size[after];
+            unlink_block(memory, after);
+        }
+    }
+    free_index_insert(memory, hole);
+
+    stats->blocks_moved++;
+    stats->bytes_moved += memory->size[block];
+    if (memory->start_address[block] < stats->low) stats->low = memory->start_address[block];
+    uint64_t end = memory->start_address[hole] + memory->size[hole];
+    if (end > stats->high) stats->high = end;
+    return hole;
+}
+
+void compact_full(MemoryList *memory, CompactionStats *stats) {
+    double started = begin_pass(stats);
+    BlockId hole = lowest_hole(memory);
+    while (hole != NO_BLOCK && memory->next[hole] != NO_BLOCK) {
+        hole = slide_down(memory, memory->next[hole], stats);
+    }
+    end_pass(stats, started);
+}
+
+int compact_targeted(MemoryList *memory, uint64_t memory_required, CompactionStats *stats) {
+    if (free_index_max_free(memory) >= memory_required) {
+        return 1;
+    }
+    if (memory->free_size < memory_required) {
+        return 0;
+    }
+    double started = begin_pass(stats);
+
+    // Two pointers over the list: for every right end keep the shortest
+    // window that still holds memory_required free units, and remember the
+    // one with the least allocated memory inside
+    BlockId left = memory->head, best = NO_BLOCK;
+    uint64_t free_units = 0, used_units = 0, best_used = UINT64_MAX;
+    for (BlockId right = memory->head; right != NO_BLOCK; right = memory->next[right]) {
+        if (memory->block_status[right] == 'f') {
+            free_units += memory->size[right];
+        } else {
+            used_units += memory->size[right];
+        }
+        while (left != right) {
+            if (memory->block_status[left] != 'f') {
+                used_units -= memory->size[left];
+            } else if (free_units - memory->size[left] >= memory_required) {
+                free_units -= memory->size[left];
+            } else {
+                break;
+            }
+            left = memory->next[left];
+        }
+        if (free_units >= memory_required && used_units < best_used) {
+            best_used = used_units;
+            best = left;
+        }
+    }
+
+    // Bubble the first hole of the window up until it is large enough
+    BlockId hole = best;
+    while (memory->block_status[hole] != 'f') {
+        hole = memory->next[hole];
+    }
+    while (memory->size[hole] < memory_required && memory->next[hole] != NO_BLOCK) {
+        hole = slide_down(memory, memory->next[hole], stats);
+    }
+    end_pass(stats, started);
+    return memory->size[hole] >= memory_required;
+}
+
+int compact_incremental(MemoryList *memory, uint64_t budget, CompactionStats *stats) {
+    double started = begin_pass(stats);
+    uint64_t moved = 0;
+    BlockId hole = lowest_hole(memory);
+    while (hole != NO_BLOCK && memory->next[hole] != NO_BLOCK) {
+        BlockId block = memory->next[hole];
+        if (moved && moved + memory->size[block] > budget) {
+            break;
+        }
+        moved += memory->size[block];
+        hole = slide_down(memory, block, stats);
+    }
+    end_pass(stats, started);
+    return hole != NO_BLOCK && memory->next[hole] != NO_BLOCK;
+}
+
+int compact_for_request(MemoryList *memory, const CompactionPolicy *policy, uint64_t memory_required,
+                        CompactionStats *stats) {
+    if (!policy || memory->buddy || memory->free_size < memory_required) {
+        return 0;
+    }
+    switch (policy->mode) {
+        case COMPACT_NONE:
+            return 0;
+        case COMPACT_FULL:
+            compact_full(memory, stats);
+            break;
+        case COMPACT_TARGETED:
+            return compact_targeted(memory, memory_required, stats);
+        case COMPACT_INCREMENTAL:
+            compact_incremental(memory, policy->budget, stats);
+            break;
+    }
+    return check_memory_availability(memory, memory_required);
+}
+
+int parse_compaction_mode(const char *name) {
+    const char *names[] = {"none", "full", "targeted", "incremental"};
+    for (int mode = COMPACT_NONE; mode <= COMPACT_INCREMENTAL; mode++) {
+        if (strcmp(name, names[mode]) == 0) return mode;
+    }
+    return -1;
+}
+
+void print_compaction_stats(const CompactionStats *stats) {
+    printf("  Compaction passes    : %" PRIu64 ", %" PRIu64 " block(s) / %" PRIu64 " units moved\n",
+           stats->passes, stats->blocks_moved, stats->bytes_moved);
+    printf("  Compaction pause     : %.6f s total, %.6f s longest\n", stats->pause_seconds,
+           stats->longest_pause);
+}
@@ -0,0 +1,50 @@
+#ifndef COMPACTION_H
+#define COMPACTION_H
+
+#include <stdint.h>
+#include "mem_allocate.h"
+
+// Relocation of allocated blocks to merge scattered free space. Every move
+// swaps an allocated block with the free block right before it: the
+// allocated block slides down by the free size and the free block moves up
+// to merge with whatever free space follows. Block ids do not change, so
+// processes keep pointing at their blocks. Only the fit strategies can be
+// compacted; buddy blocks must stay at their aligned addresses.
+
+typedef enum {
+    COMPACT_NONE,         // Never relocate; allocations wait instead
+    COMPACT_FULL,         // Slide everything down, leaving one free block at the top
+    COMPACT_TARGETED,     // Only clear the cheapest region that makes room for the request
+    COMPACT_INCREMENTAL   // Move at most budget units per simulation tick
+} CompactionMode;
+
+typedef struct {
+    CompactionMode mode;
+    uint64_t budget;  // Units moved per step in COMPACT_INCREMENTAL
+} CompactionPolicy;
+
+typedef struct {
+    uint64_t passes, blocks_moved, bytes_moved;
+    double pause_seconds;       // Wall time spent relocating
+    double longest_pause;
+    uint64_t low, high;         // Address range touched by the last pass
+} CompactionStats;
+
+// Slide every allocated block down to remove all holes
+void compact_full(MemoryList *memory, CompactionStats *stats);
+// Relocate the blocks of the window of memory that holds at least
+// memory_required free units while containing the fewest allocated units.
+// Returns 1 if a free block of memory_required units exists afterwards.
+int compact_targeted(MemoryList *memory, uint64_t memory_required, CompactionStats *stats);
+// Continue compacting from the lowest hole, moving at most budget units
+// (or one block when a single block is larger). Returns 1 while holes remain.
+int compact_incremental(MemoryList *memory, uint64_t budget, CompactionStats *stats);
+// Apply a policy after an allocation of memory_required units failed.
+// Returns 1 if the allocation can now succeed.
+int compact_for_request(MemoryList *memory, const CompactionPolicy *policy, uint64_t memory_required,
+                        CompactionStats *stats);
+// Parse "none", "full", "targeted" or "incremental"; returns -1 when unknown
+int parse_compaction_mode(const char *name);
+void print_compaction_stats(const CompactionStats *stats);
+
+#endif // COMPACTION_H
@@ -0,0 +1,141 @@
+#include "event_log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define SPILL_READ_CHUNK 1024
+
+static const char *kind_labels[] = {"New", "Waiting", "Completed", "Selected", "Ready"};
+
+int event_log_init(EventLog *log, uint32_t capacity, const char *spill_filename) {
+    memset(log, 0, sizeof(*log));
+    uint32_t rounded = 1;
+    while (rounded < capacity) rounded <<= 1;
+    log->capacity = rounded;
+    log->records = malloc((size_t)rounded * sizeof(EventRecord));
+    if (!log->records) {
+        fprintf(stderr, "Memory allocation failed for event log.\n");
+        exit(1);
+    }
+    if (spill_filename) {
+        log->spill = fopen(spill_filename, "w+b");
+        if (!log->spill) {
+            perror(spill_filename);
+            free(log->records);
+            log->records = NULL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void event_log_destroy(EventLog *log) {
+    if (log->spill) {
+        fclose(log->spill);
+    }
+    free(log->records);
+    memset(log, 0, sizeof(*log));
+}
+
+void event_log_record(EventLog *log, int64_t timestamp, int kind, const char *process, uint64_t address) {
+    if (log->spill && log->written - log->spilled == log->capacity) {
+        // The ring holds exactly one full lap in order; move it to the file
+        if (fwrite(log->records, sizeof(EventRecord), log->capacity, log->spill) == log->capacity) {
+            log->spilled += log->capacity;
+        } else {
+            // The file no longer holds a usable history; keep the ring only
+            perror("event log spill");
+            fprintf(stderr, "Spilling stopped; only the last %u events are kept.\n", log->capacity);
+            fclose(log->spill);
+            log->spill = NULL;
+            log->spilled = 0;
+        }
+    }
+    EventRecord *record = &log->records[log->written & (log->capacity - 1)];
+    record->timestamp = timestamp;
+    record->address = address;
+    record->kind = (uint8_t)kind;
+    strncpy(record->process, process, PROCESS_CODE_SIZE - 1);
+    record->process[PROCESS_CODE_SIZE - 1] = '\0';
+    log->written++;
+}
+
+// Oldest record still held in the ring
+static uint64_t first_in_ring(const EventLog *log) {
+    if (log->spill) return log->spilled;
+    return log->written > log->capacity ? log->written - log->capacity : 0;
+}
+
+// Call visit on every retained record, oldest first
+static void for_each_record(EventLog *log, void (*visit)(const EventRecord *, void *), void *context) {
+    if (log->spill && log->spilled) {
+        EventRecord chunk[SPILL_READ_CHUNK];
+        size_t count;
+        fflush(log->spill);
+        rewind(log->spill);
+        while ((count = fread(chunk, sizeof(EventRecord), SPILL_READ_CHUNK, log->spill)) > 0) {
+            for (size_t i = 0; i < count; i++) visit(&chunk[i], context);
+        }
+        fseek(log->spill, 0, SEEK_END);
+    }
+    for (uint64_t i = first_in_ring(log); i < log->written; i++) {
+        visit(&log->records[i & (log->capacity - 1)], context);
+    }
+}
+
+static void print_record(const EventRecord *record, void *context) {
+    int64_t *last_timestamp = context;
+    if (*last_timestamp != record->timestamp) {
+        printf("\nTime %" PRId64 ":\n", record->timestamp);
+        *last_timestamp = record->timestamp;
+    }
+    const char *label = record->kind <= LOG_READY ? kind_labels[record->kind] : "?";
+    if (record->address != EVENT_LOG_NO_ADDRESS) {
+        printf("  %-10s %s@%" PRIu64 "\n", label, record->process, record->address);
+    } else {
+        printf("  %-10s %s\n", label, record->process);
+    }
+}
+
+// Print the log, one block per timestamp
+void print_comments(EventLog *log) {
+    if (log->written == 0) {
+        printf("\nNo comments recorded.\n");
+        return;
+    }
+    uint64_t dropped = first_in_ring(log) - log->spilled;
+    if (dropped) {
+        printf("\n(%" PRIu64 " older event(s) overwritten)\n", dropped);
+    }
+    int64_t last_timestamp = INT64_MIN;
+    for_each_record(log, print_record, &last_timestamp);
+}
+
+static void export_record(const EventRecord *record, void *context) {
+    FILE *output = context;
+    const char *label = record->kind <= LOG_READY ? kind_labels[record->kind] : "?";
+    if (record->address != EVENT_LOG_NO_ADDRESS) {
+        fprintf(output, "%" PRId64 ",%s,%s,%" PRIu64 "\n", record->timestamp, label, record->process,
+                record->address);
+    } else {
+        fprintf(output, "%" PRId64 ",%s,%s,\n", record->timestamp, label, record->process);
+    }
+}
+
+int event_log_export_csv(EventLog *log, const char *filename) {
+    FILE *output = fopen(filename, "w");
+    if (!output) {
+        perror(filename);
+        return -1;
+    }
+    fprintf(output, "time,event,process,address\n");
+    for_each_record(log, export_record, output);
+    int failed = ferror(output);
+    fclose(output);
+    return failed ? -1 : 0;
+}
+
+void print_event_log_usage(const EventLog *log) {
+    printf("  %-14s %8" PRIu64 " logged, %8" PRIu64 " spilled, ring of %u x %zu B\n", "Event log",
+           log->written, log->spilled, log->capacity, sizeof(EventRecord));
+}
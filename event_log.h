@@ -0,0 +1,45 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "process_names.h"
+
+// Fixed-capacity log of simulation events stored as compact binary
+// records. Nothing is formatted until print_comments or an export asks for
+// it. Without a spill file the oldest records are overwritten once the ring
+// is full; with one, each full ring is appended to the file so the whole
+// run is kept while RAM use stays bounded.
+
+#define EVENT_LOG_DEFAULT_CAPACITY (1u << 16)
+#define EVENT_LOG_NO_ADDRESS UINT64_MAX
+
+// Kinds of records, matching the old comment categories
+enum { LOG_NEW, LOG_WAITING, LOG_COMPLETED, LOG_SELECTED, LOG_READY };
+
+typedef struct {
+    int64_t timestamp;
+    uint64_t address;  // EVENT_LOG_NO_ADDRESS when the event has none
+    char process[PROCESS_CODE_SIZE];
+    uint8_t kind;
+} EventRecord;
+
+typedef struct {
+    EventRecord *records;
+    uint32_t capacity;   // Power of two
+    uint64_t written;    // Records logged so far
+    uint64_t spilled;    // Records moved to the spill file
+    FILE *spill;
+} EventLog;
+
+// Returns 0 on success, -1 if the spill file could not be created
+int event_log_init(EventLog *log, uint32_t capacity, const char *spill_filename);
+void event_log_destroy(EventLog *log);
+void event_log_record(EventLog *log, int64_t timestamp, int kind, const char *process, uint64_t address);
+// Print every retained record grouped by timestamp
+void print_comments(EventLog *log);
+// Write every retained record as CSV
+int event_log_export_csv(EventLog *log, const char *filename);
+void print_event_log_usage(const EventLog *log);
+
+#endif // EVENT_LOG_H
@@ -0,0 +1,144 @@
+#include "frame_bitmap.h"
+#include "memory_utils.h"
+#include <stdlib.h>
+
+static uint64_t low_mask(uint64_t bits) {
+    return bits >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << bits) - 1;
+}
+
+static void update_summary(FrameBitmap *frames, uint64_t word) {
+    uint64_t bit = (uint64_t)1 << (word % 64);
+    if (frames->words[word]) {
+        frames->summary[word / 64] |= bit;
+    } else {
+        frames->summary[word / 64] &= ~bit;
+    }
+}
+
+int frames_init(FrameBitmap *frames, uint64_t frame_count) {
+    frames->frame_count = frame_count;
+    frames->word_count = (frame_count + 63) / 64;
+    frames->summary_count = (frames->word_count + 63) / 64;
+    frames->words = malloc((frames->word_count ? frames->word_count : 1) * sizeof(uint64_t));
+    frames->summary = calloc(frames->summary_count ? frames->summary_count : 1, sizeof(uint64_t));
+    if (!frames->words || !frames->summary) {
+        frames_destroy(frames);
+        return 0;
+    }
+    for (uint64_t word = 0; word < frames->word_count; word++) {
+        // Bits past the last frame stay clear, so they are never handed out
+        frames->words[word] = low_mask(frame_count - word * 64);
+        update_summary(frames, word);
+    }
+    frames->free_count = frame_count;
+    frames->next_word = 0;
+    return 1;
+}
+
+void frames_destroy(FrameBitmap *frames) {
+    free(frames->words);
+    free(frames->summary);
+    frames->words = frames->summary = NULL;
+    frames->frame_count = frames->word_count = frames->summary_count = frames->free_count = 0;
+}
+
+// Set (free) or clear (in use) the bits of a run, a word at a time
+static void mark_run(FrameBitmap *frames, uint64_t first, uint64_t count, int free) {
+    if (free) {
+        frames->free_count += count;
+    } else {
+        frames->free_count -= count;
+    }
+    while (count) {
+        uint64_t word = first / 64, offset = first % 64;
+        uint64_t span = 64 - offset < count ? 64 - offset : count;
+        uint64_t mask = low_mask(span) << offset;
+        if (free) {
+            frames->words[word] |= mask;
+        } else {
+            frames->words[word] &= ~mask;
+        }
+        update_summary(frames, word);
+        first += span;
+        count -= span;
+    }
+}
+
+// First word at or after a word that has a free frame, word_count if none
+static uint64_t next_nonempty_word(const FrameBitmap *frames, uint64_t word) {
+    uint64_t index = word / 64;
+    if (index >= frames->summary_count) {
+        return frames->word_count;
+    }
+    uint64_t bits = frames->summary[index] & ~low_mask(word % 64);
+    while (!bits) {
+        if (++index == frames->summary_count) {
+            return frames->word_count;
+        }
+        bits = frames->summary[index];
+    }
+    return index * 64 + (uint64_t)__builtin_ctzll(bits);
+}
+
+uint64_t frame_next_free(const FrameBitmap *frames, uint64_t from) {
+    if (from >= frames->frame_count) {
+        return NO_FRAME;
+    }
+    uint64_t word = from / 64;
+    uint64_t bits = frames->words[word] & ~low_mask(from % 64);
+    if (!bits) {
+        word = next_nonempty_word(frames, word + 1);
+        if (word == frames->word_count) {
+            return NO_FRAME;
+        }
+        bits = frames->words[word];
+    }
+    return word * 64 + (uint64_t)__builtin_ctzll(bits);
+}
+
+uint64_t frame_next_used(const FrameBitmap *frames, uint64_t from) {
+    if (from >= frames->frame_count) {
+        return frames->frame_count;
+    }
+    uint64_t word = from / 64;
+    uint64_t bits = ~frames->words[word] & ~low_mask(from % 64);
+    while (!bits) {
+        if (++word == frames->word_count) {
+            return frames->frame_count;
+        }
+        bits = ~frames->words[word];
+    }
+    uint64_t frame = word * 64 + (uint64_t)__builtin_ctzll(bits);
+    return frame < frames->frame_count ? frame : frames->frame_count;
+}
+
+// Next fit: carry on from the last word a frame came from
+uint64_t frame_alloc(FrameBitmap *frames) {
+    if (frames->free_count == 0) {
+        return NO_FRAME;
+    }
+    uint64_t frame = frame_next_free(frames, frames->next_word * 64);
+    if (frame == NO_FRAME) {
+        frame = frame_next_free(frames, 0);
+    }
+    mark_run(frames, frame, 1, 0);
+    frames->next_word = frame / 64;
+    return frame;
+}
+
+uint64_t frame_alloc_run(FrameBitmap *frames, uint64_t count) {
+    if (count == 0 || count > frames->free_count) {
+        return NO_FRAME;
+    }
+    // Bits past the last frame are clear, so no run reaches beyond it
+    uint64_t start = bitmap_find_run(frames->words, frames->word_count, count);
+    if (start == SIMD_NO_INDEX) {
+        return NO_FRAME;
+    }
+    mark_run(frames, start, count, 0);
+    return start;
+}
+
+void frame_free_run(FrameBitmap *frames, uint64_t first, uint64_t count) {
+    mark_run(frames, first, count, 1);
+}
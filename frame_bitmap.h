@@ -0,0 +1,49 @@
+#ifndef FRAME_BITMAP_H
+#define FRAME_BITMAP_H
+
+#include <stdint.h>
+
+// Physical frame allocator: one bit per frame, set while the frame is free,
+// plus a summary bit per 64-frame word that is set while the word has any
+// free frame. A free frame is found by scanning summary words and taking
+// the lowest set bit twice, so even a mostly full map of hundreds of
+// millions of frames is crossed in a few thousand word reads. Runs of free
+// frames are found by the vector kernels in memory_utils.asm. The number
+// of free frames is kept up to date, so asking for it is O(1).
+
+typedef struct {
+    uint64_t *words;     // Bit f % 64 of words[f / 64] is set while frame f is free
+    uint64_t *summary;   // Bit w % 64 of summary[w / 64] is set while words[w] != 0
+    uint64_t frame_count;
+    uint64_t word_count, summary_count;
+    uint64_t free_count;
+    uint64_t next_word;  // Where the next single-frame search starts
+} FrameBitmap;
+
+#define NO_FRAME UINT64_MAX
+
+// Start with every frame free. Returns 0 if memory ran out.
+int frames_init(FrameBitmap *frames, uint64_t frame_count);
+void frames_destroy(FrameBitmap *frames);
+
+static inline uint64_t frames_free(const FrameBitmap *frames) {
+    return frames->free_count;
+}
+
+static inline int frame_is_free(const FrameBitmap *frames, uint64_t frame) {
+    return (int)(frames->words[frame / 64] >> (frame % 64) & 1);
+}
+
+// Take one free frame, NO_FRAME if there is none
+uint64_t frame_alloc(FrameBitmap *frames);
+// Take the lowest run of count contiguous free frames and return its first
+// frame, NO_FRAME if there is no such run
+uint64_t frame_alloc_run(FrameBitmap *frames, uint64_t count);
+// Return count frames starting at first, which must all be in use
+void frame_free_run(FrameBitmap *frames, uint64_t first, uint64_t count);
+// First free frame at or after a frame, NO_FRAME if there is none
+uint64_t frame_next_free(const FrameBitmap *frames, uint64_t from);
+// First frame in use at or after a frame, frame_count if there is none
+uint64_t frame_next_used(const FrameBitmap *frames, uint64_t from);
+
+#endif // FRAME_BITMAP_H
@@ -0,0 +1,230 @@
+#include "free_block_index.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+// One of the two trees together with the arrays its keys live in
+typedef struct {
+    FreeIndexLink *links;
+    const uint64_t *start_address, *size;
+    int by_size;  // The address tree also maintains max_free
+} TreeContext;
+
+static TreeContext size_tree(MemoryList *memory) {
+    return (TreeContext){memory->by_size.links, memory->start_address, memory->size, 1};
+}
+
+static TreeContext address_tree(MemoryList *memory) {
+    return (TreeContext){memory->by_address.links, memory->start_address, memory->size, 0};
+}
+
+static int height_of(const TreeContext *t, BlockId block) {
+    return block == NO_BLOCK ? 0 : (int)t->links[block].height;
+}
+
+static uint64_t max_free_of(const FreeIndexLink *links, BlockId block) {
+    return block == NO_BLOCK ? 0 : links[block].max_free;
+}
+
+// Order by (size, start_address) or by start_address alone
+static int compare_blocks(const TreeContext *t, BlockId a, BlockId b) {
+    if (t->by_size && t->size[a] != t->size[b]) {
+        return t->size[a] < t->size[b] ? -1 : 1;
+    }
+    if (t->start_address[a] != t->start_address[b]) {
+        return t->start_address[a] < t->start_address[b] ? -1 : 1;
+    }
+    return 0;
+}
+
+// Recompute height and subtree maximum from the children
+static void update_node(const TreeContext *t, BlockId block) {
+    FreeIndexLink *link = &t->links[block];
+    int left_height = height_of(t, link->left);
+    int right_height = height_of(t, link->right);
+
+    link->height = (uint32_t)(1 + (left_height > right_height ? left_height : right_height));
+    if (!t->by_size) {
+        uint64_t max_free = t->size[block];
+        if (max_free_of(t->links, link->left) > max_free) max_free = t->links[link->left].max_free;
+        if (max_free_of(t->links, link->right) > max_free) max_free = t->links[link->right].max_free;
+        link->max_free = max_free;
+    }
+}
+
+static BlockId rotate_right(const TreeContext *t, BlockId block) {
+    BlockId pivot = t->links[block].left;
+    t->links[block].left = t->links[pivot].right;
+    t->links[pivot].right = block;
+    update_node(t, block);
+    update_node(t, pivot);
+    return pivot;
+}
+
+static BlockId rotate_left(const TreeContext *t, BlockId block) {
+    BlockId pivot = t->links[block].right;
+    t->links[block].right = t->links[pivot].left;
+    t->links[pivot].left = block;
+    update_node(t, block);
+    update_node(t, pivot);
+    return pivot;
+}
+
+// Restore the AVL invariant at this node after one of its subtrees changed
+static BlockId rebalance(const TreeContext *t, BlockId block) {
+    update_node(t, block);
+    int balance = height_of(t, t->links[block].left) - height_of(t, t->links[block].right);
+
+    if (balance > 1) {
+        BlockId left = t->links[block].left;
+        if (height_of(t, t->links[left].left) < height_of(t, t->links[left].right)) {
+            t->links[block].left = rotate_left(t, left);
+        }
+        return rotate_right(t, block);
+    }
+    if (balance < -1) {
+        BlockId right = t->links[block].right;
+        if (height_of(t, t->links[right].right) < height_of(t, t->links[right].left)) {
+            t->links[block].right = rotate_right(t, right);
+        }
+        return rotate_left(t, block);
+    }
+    return block;
+}
+
+static BlockId insert_node(const TreeContext *t, BlockId root, BlockId block) {
+    if (root == NO_BLOCK) {
+        t->links[block].left = t->links[block].right = NO_BLOCK;
+        update_node(t, block);
+        return block;
+    }
+    if (compare_blocks(t, block, root) < 0) {
+        t->links[root].left = insert_node(t, t->links[root].left, block);
+    } else {
+        t->links[root].right = insert_node(t, t->links[root].right, block);
+    }
+    return rebalance(t, root);
+}
+
+// Detach the leftmost node of a subtree, returning the new subtree root
+static BlockId remove_leftmost(const TreeContext *t, BlockId root, BlockId *leftmost) {
+    if (t->links[root].left == NO_BLOCK) {
+        *leftmost = root;
+        return t->links[root].right;
+    }
+    t->links[root].left = remove_leftmost(t, t->links[root].left, leftmost);
+    return rebalance(t, root);
+}
+
+static BlockId remove_node(const TreeContext *t, BlockId root, BlockId block) {
+    if (root == NO_BLOCK) {
+        return NO_BLOCK;
+    }
+    if (root == block) {
+        if (t->links[root].left == NO_BLOCK) return t->links[root].right;
+        if (t->links[root].right == NO_BLOCK) return t->links[root].left;
+
+        BlockId successor = NO_BLOCK;
+        BlockId right = remove_leftmost(t, t->links[root].right, &successor);
+        t->links[successor].left = t->links[root].left;
+        t->links[successor].right = right;
+        return rebalance(t, successor);
+    }
+    if (compare_blocks(t, block, root) < 0) {
+        t->links[root].left = remove_node(t, t->links[root].left, block);
+    } else {
+        t->links[root].right = remove_node(t, t->links[root].right, block);
+    }
+    return rebalance(t, root);
+}
+
+static void *grow(void *array, uint32_t capacity, size_t element_size) {
+    void *grown = realloc(array, (size_t)capacity * element_size);
+    if (!grown) {
+        fprintf(stderr, "Memory allocation failed for free block index.\n");
+        exit(1);
+    }
+    return grown;
+}
+
+void free_index_reserve(MemoryList *memory, uint32_t capacity) {
+    memory->by_size.links = grow(memory->by_size.links, capacity, sizeof(FreeIndexLink));
+    memory->by_address.links = grow(memory->by_address.links, capacity, sizeof(FreeIndexLink));
+}
+
+// Add a free block to both trees
+void free_index_insert(MemoryList *memory, BlockId block) {
+    TreeContext by_size = size_tree(memory), by_address = address_tree(memory);
+    memory->by_size.root = insert_node(&by_size, memory->by_size.root, block);
+    memory->by_address.root = insert_node(&by_address, memory->by_address.root, block);
+    memory->free_blocks++;
+    memory->free_size += memory->size[block];
+}
+
+// Remove a free block from both trees
+void free_index_remove(MemoryList *memory, BlockId block) {
+    TreeContext by_size = size_tree(memory), by_address = address_tree(memory);
+    memory->by_size.root = remove_node(&by_size, memory->by_size.root, block);
+    memory->by_address.root = remove_node(&by_address, memory->by_address.root, block);
+    memory->free_blocks--;
+    memory->free_size -= memory->size[block];
+}
+
+// Lower bound on (memory_required, 0) in the size tree
+BlockId free_index_best_fit(const MemoryList *memory, uint64_t memory_required, uint32_t *scanned) {
+    BlockId current = memory->by_size.root;
+    BlockId best_fit = NO_BLOCK;
+    uint32_t visited = 0;
+    while (current != NO_BLOCK) {
+        visited++;
+        if (memory->size[current] >= memory_required) {
+            best_fit = current;
+            current = memory->by_size.links[current].left;
+        } else {
+            current = memory->by_size.links[current].right;
+        }
+    }
+    if (scanned) *scanned = visited;
+    return best_fit;
+}
+
+// Descend the address tree, preferring the left subtree whenever its
+// maximum free size is large enough
+BlockId free_index_first_fit(const MemoryList *memory, uint64_t memory_required, uint32_t *scanned) {
+    const FreeIndexLink *links = memory->by_address.links;
+    BlockId current = memory->by_address.root;
+    uint32_t visited = 0;
+    while (current != NO_BLOCK) {
+        visited++;
+        BlockId left = links[current].left;
+        if (left != NO_BLOCK && links[left].max_free >= memory_required) {
+            current = left;
+        } else if (memory->size[current] >= memory_required) {
+            break;
+        } else {
+            current = links[current].right;
+            if (current != NO_BLOCK && links[current].max_free < memory_required) {
+                current = NO_BLOCK;
+            }
+        }
+    }
+    if (scanned) *scanned = visited;
+    return current;
+}
+
+BlockId free_index_floor(const MemoryList *memory, uint64_t address) {
+    const FreeIndexLink *links = memory->by_address.links;
+    BlockId current = memory->by_address.root, floor = NO_BLOCK;
+    while (current != NO_BLOCK) {
+        if (memory->start_address[current] <= address) {
+            floor = current;
+            current = links[current].right;
+        } else {
+            current = links[current].left;
+        }
+    }
+    return floor;
+}
+
+uint64_t free_index_max_free(const MemoryList *memory) {
+    return max_free_of(memory->by_address.links, memory->by_address.root);
+}
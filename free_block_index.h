@@ -0,0 +1,25 @@
+#ifndef FREE_BLOCK_INDEX_H
+#define FREE_BLOCK_INDEX_H
+
+#include "mem_allocate.h"
+
+// Size- and address-ordered AVL trees over the free blocks of a MemoryList.
+// A block must be removed before its size or start address changes and
+// inserted again afterwards, so the tree keys never go stale.
+
+// Size the tree link arrays for capacity block ids
+void free_index_reserve(MemoryList *memory, uint32_t capacity);
+void free_index_insert(MemoryList *memory, BlockId block);
+void free_index_remove(MemoryList *memory, BlockId block);
+
+// Smallest free block with size >= memory_required (lowest address on ties).
+// The number of tree nodes visited is stored in *scanned unless it is NULL.
+BlockId free_index_best_fit(const MemoryList *memory, uint64_t memory_required, uint32_t *scanned);
+// Lowest-addressed free block with size >= memory_required
+BlockId free_index_first_fit(const MemoryList *memory, uint64_t memory_required, uint32_t *scanned);
+// Highest-addressed free block starting at or below address
+BlockId free_index_floor(const MemoryList *memory, uint64_t address);
+// Size of the largest free block, 0 when memory is full
+uint64_t free_index_max_free(const MemoryList *memory);
+
+#endif // FREE_BLOCK_INDEX_H
@@ -0,0 +1,221 @@
+// Compares two heap snapshots written by the leak detector and lists the
+// allocation sites whose live bytes grew the most between them. Sites are
+// matched by their frames as module+offset, so snapshots of different runs
+// of the same program can be compared as well as two of one process.
+//
+// Usage: heap_diff OLD.heap NEW.heap [top_sites]
+
+#include "heap_snapshot.h"
+#include "heap_sampler.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_TOP_SITES 20
+
+typedef struct {
+    char *key;                  // Frames as "module+0xOFFSET;..."
+    const HeapSnapshot *owner;  // Snapshot whose frames are printed
+    uint32_t stack;
+    double bytes[2], count[2];  // Old and new
+} Site;
+
+typedef struct {
+    Site *items;
+    size_t count, capacity;
+} SiteList;
+
+static void *checked_malloc(size_t size) {
+    void *memory = malloc(size ? size : 1);
+    if (!memory) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(1);
+    }
+    return memory;
+}
+
+// Return addresses point after the call; step back into it
+static char *site_key(const HeapSnapshot *snapshot, uint32_t stack) {
+    const uint64_t *frames;
+    unsigned depth = heap_snapshot_stack(snapshot, stack, &frames);
+    size_t capacity = 64, length = 0;
+    char *key = checked_malloc(capacity);
+    key[0] = '\0';
+    for (unsigned i = 0; i < depth; i++) {
+        uint64_t address = frames[i] - 1;
+        const SnapshotModule *module = heap_snapshot_module(snapshot, address);
+        const char *name = module ? snapshot->names + module->name : "?";
+        size_t needed = strlen(name) + 32;
+        if (length + needed > capacity) {
+            capacity = (length + needed) * 2;
+            char *grown = realloc(key, capacity);
+            if (!grown) {
+                fprintf(stderr, "Error: out of memory\n");
+                exit(1);
+            }
+            key = grown;
+        }
+        length += (size_t)sprintf(key + length, "%s+0x%" PRIx64 ";", name, module ? address - module->low : address);
+    }
+    return key;
+}
+
+// Live bytes and blocks per stack id, estimated when the snapshot was sampled
+static void add_snapshot(SiteList *sites, const HeapSnapshot *snapshot, int side) {
+    size_t stacks = snapshot->header->stack_count + 1;
+    double *bytes = calloc(stacks, sizeof(double)), *count = calloc(stacks, sizeof(double));
+    if (!bytes || !count) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(1);
+    }
+    sampler_init(snapshot->header->sample_interval);
+    for (uint64_t i = 0; i < snapshot->header->block_count; i++) {
+        const SnapshotBlock *block = &snapshot->blocks[i];
+        uint32_t stack = block->stack < stacks ? block->stack : 0;
+        double weight = sample_weight(block->size);
+        bytes[stack] += weight * (double)block->size;
+        count[stack] += weight;
+    }
+    for (size_t stack = 0; stack < stacks; stack++) {
+        if (count[stack] == 0) continue;
+        if (sites->count == sites->capacity) {
+            sites->capacity = sites->capacity ? sites->capacity * 2 : 256;
+            Site *grown = realloc(sites->items, sites->capacity * sizeof(Site));
+            if (!grown) {
+                fprintf(stderr, "Error: out of memory\n");
+                exit(1);
+            }
+            sites->items = grown;
+        }
+        Site *site = &sites->items[sites->count++];
+        *site = (Site){site_key(snapshot, (uint32_t)stack), snapshot, (uint32_t)stack, {0, 0}, {0, 0}};
+        site->bytes[side] = bytes[stack];
+        site->count[side] = count[stack];
+    }
+    free(bytes);
+    free(count);
+}
+
+static int compare_keys(const void *a, const void *b) {
+    return strcmp(((const Site *)a)->key, ((const Site *)b)->key);
+}
+
+// Largest growth first
+static int compare_growth(const void *a, const void *b) {
+    const Site *first = a, *second = b;
+    double growth_first = first->bytes[1] - first->bytes[0], growth_second = second->bytes[1] - second->bytes[0];
+    return growth_first < growth_second ? 1 : growth_first > growth_second ? -1 : 0;
+}
+
+// Fold the entries of both snapshots for the same frames into one site
+static void merge_sites(SiteList *sites) {
+    qsort(sites->items, sites->count, sizeof(Site), compare_keys);
+    size_t kept = 0;
+    for (size_t i = 0; i < sites->count; i++) {
+        Site *site = &sites->items[i];
+        if (kept > 0 && strcmp(sites->items[kept - 1].key, site->key) == 0) {
+            Site *into = &sites->items[kept - 1];
+            for (int side = 0; side < 2; side++) {
+                into->bytes[side] += site->bytes[side];
+                into->count[side] += site->count[side];
+            }
+            if (site->bytes[1] > 0) {  // Prefer the newer snapshot's frames
+                into->owner = site->owner;
+                into->stack = site->stack;
+            }
+            free(site->key);
+        } else {
+            sites->items[kept++] = *site;
+        }
+    }
+    sites->count = kept;
+}
+
+static void print_frames(const HeapSnapshot *snapshot, uint32_t stack) {
+    const uint64_t *frames;
+    unsigned depth = heap_snapshot_stack(snapshot, stack, &frames);
+    if (depth == 0) {
+        printf("    (no stack)\n");
+    }
+    for (unsigned i = 0; i < depth; i++) {
+        uint64_t address = frames[i] - 1;
+        const SnapshotModule *module = heap_snapshot_module(snapshot, address);
+        if (module) {
+            printf("    #%u 0x%" PRIx64 " (%s+0x%" PRIx64 ")\n", i, address, snapshot->names + module->name,
+                   address - module->low);
+        } else {
+            printf("    #%u 0x%" PRIx64 "\n", i, address);
+        }
+    }
+}
+
+static void print_summary(const char *label, const char *path, const HeapSnapshot *snapshot) {
+    uint64_t bytes = 0;
+    for (uint64_t i = 0; i < snapshot->header->block_count; i++) {
+        bytes += snapshot->blocks[i].size;
+    }
+    printf("%s: %s (pid %" PRIu64 ", time %" PRIu64 ", %" PRIu64 " blocks, %" PRIu64 " bytes recorded", label, path,
+           snapshot->header->pid, snapshot->header->time, snapshot->header->block_count, bytes);
+    if (snapshot->header->sample_interval) {
+        printf(", sampled every %" PRIu64 " bytes", snapshot->header->sample_interval);
+    }
+    printf(")\n");
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3 || argc > 4) {
+        fprintf(stderr, "Usage: %s OLD.heap NEW.heap [top_sites]\n", argv[0]);
+        return 1;
+    }
+    long top_sites = argc > 3 ? atol(argv[3]) : DEFAULT_TOP_SITES;
+    if (top_sites <= 0) {
+        fprintf(stderr, "Error: top_sites must be positive\n");
+        return 1;
+    }
+    HeapSnapshot snapshots[2];
+    if (heap_snapshot_open(argv[1], &snapshots[0]) != 0) {
+        return 1;
+    }
+    if (heap_snapshot_open(argv[2], &snapshots[1]) != 0) {
+        heap_snapshot_close(&snapshots[0]);
+        return 1;
+    }
+    print_summary("Old", argv[1], &snapshots[0]);
+    print_summary("New", argv[2], &snapshots[1]);
+
+    SiteList sites = {NULL, 0, 0};
+    add_snapshot(&sites, &snapshots[0], 0);
+    add_snapshot(&sites, &snapshots[1], 1);
+    merge_sites(&sites);
+    qsort(sites.items, sites.count, sizeof(Site), compare_growth);
+
+    double total[2] = {0, 0};
+    for (size_t i = 0; i < sites.count; i++) {
+        total[0] += sites.items[i].bytes[0];
+        total[1] += sites.items[i].bytes[1];
+    }
+    printf("Live bytes: %.0f -> %.0f (%+.0f)\n", total[0], total[1], total[1] - total[0]);
+
+    printf("\n--- Growth by Allocation Site ---\n");
+    size_t shown = 0;
+    for (size_t i = 0; i < sites.count && shown < (size_t)top_sites; i++) {
+        const Site *site = &sites.items[i];
+        if (site->bytes[1] <= site->bytes[0]) break;
+        printf("#%zu: %+.0f bytes, %+.0f block(s) (%.0f -> %.0f bytes in %.0f -> %.0f block(s))\n", ++shown,
+               site->bytes[1] - site->bytes[0], site->count[1] - site->count[0], site->bytes[0], site->bytes[1],
+               site->count[0], site->count[1]);
+        print_frames(site->owner, site->stack);
+    }
+    if (shown == 0) {
+        printf("No allocation site grew.\n");
+    }
+
+    for (size_t i = 0; i < sites.count; i++) {
+        free(sites.items[i].key);
+    }
+    free(sites.items);
+    heap_snapshot_close(&snapshots[0]);
+    heap_snapshot_close(&snapshots[1]);
+    return 0;
+}
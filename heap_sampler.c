@@ -0,0 +1,85 @@
+#include "heap_sampler.h"
+#include <math.h>
+#include <time.h>
+
+#define FILTER_BITS 16
+
+size_t sampler_interval;
+__thread int64_t sampler_bytes_left __attribute__((tls_model("initial-exec")));
+
+// Per-thread xorshift state; 0 until the thread's first sample point is drawn
+static __thread uint64_t random_state __attribute__((tls_model("initial-exec")));
+
+// Live sampled blocks per address hash. Collisions only let an unsampled
+// free through to the tracker, which then finds nothing.
+static uint32_t filter[1 << FILTER_BITS];
+
+void sampler_init(size_t mean_interval) {
+    sampler_interval = mean_interval;
+}
+
+static uint64_t next_random(void) {
+    uint64_t x = random_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    random_state = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+// Exponentially distributed distance to the next sample point
+static int64_t next_interval(void) {
+    double uniform = (double)((next_random() >> 11) + 1) * 0x1p-53;  // (0, 1]
+    double interval = -log(uniform) * (double)sampler_interval;
+    if (interval < 1) return 1;
+    if (interval > (double)(INT64_MAX / 2)) return INT64_MAX / 2;
+    return (int64_t)interval;
+}
+
+int sampler_take(size_t size) {
+    if (!sampler_interval) {
+        sampler_bytes_left = 0;
+        return 1;
+    }
+    if (!random_state) {
+        // First allocation of the thread: place its first sample point
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        random_state = ((uint64_t)(uintptr_t)&random_state ^ (uint64_t)now.tv_nsec) | 1;
+        sampler_bytes_left = next_interval() - (int64_t)size;
+        if (sampler_bytes_left > 0) {
+            return 0;
+        }
+    }
+    // A point fell inside this block. The process is memoryless, so the
+    // next point is a fresh draw from the end of the block.
+    sampler_bytes_left = next_interval();
+    return 1;
+}
+
+static uint32_t *filter_slot(const void *ptr) {
+    return &filter[((uint64_t)(uintptr_t)ptr * 0x9E3779B97F4A7C15ull) >> (64 - FILTER_BITS)];
+}
+
+void sampler_mark(const void *ptr) {
+    if (sampler_interval) {
+        __atomic_add_fetch(filter_slot(ptr), 1, __ATOMIC_RELAXED);
+    }
+}
+
+void sampler_unmark(const void *ptr) {
+    if (sampler_interval) {
+        __atomic_sub_fetch(filter_slot(ptr), 1, __ATOMIC_RELAXED);
+    }
+}
+
+int sampler_may_hold(const void *ptr) {
+    return !sampler_interval || __atomic_load_n(filter_slot(ptr), __ATOMIC_RELAXED) != 0;
+}
+
+double sample_weight(size_t size) {
+    if (!sampler_interval || size == 0) {
+        return 1.0;
+    }
+    return 1.0 / -expm1(-(double)size / (double)sampler_interval);
+}
@@ -0,0 +1,45 @@
+#ifndef HEAP_SAMPLER_H
+#define HEAP_SAMPLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Poisson sampling of allocations by byte count. Sample points are spread
+// over the stream of allocated bytes at exponentially distributed intervals
+// with a configurable mean, and an allocation is sampled when a point falls
+// inside it, which happens with probability 1 - exp(-size / mean). Counting
+// every sampled block as 1 / that probability blocks of its size gives
+// unbiased estimates of live bytes and block counts per site.
+//
+// Each thread keeps the number of bytes left before its next sample point,
+// so an allocation that is not sampled costs one subtraction and a branch.
+// Frees are screened by a counting filter over address hashes, which rules
+// out almost every unsampled block without touching the tracker.
+
+// Mean bytes between sample points; 0 tracks every allocation
+extern size_t sampler_interval;
+extern __thread int64_t sampler_bytes_left __attribute__((tls_model("initial-exec")));
+
+// Set the mean interval before any thread allocates
+void sampler_init(size_t mean_interval);
+// Slow path of sample_allocation, taken when a sample point is reached
+int sampler_take(size_t size);
+
+// Whether to record an allocation of this size; always 1 when every
+// allocation is tracked
+static inline int sample_allocation(size_t size) {
+    if ((sampler_bytes_left -= (int64_t)size) > 0) {
+        return 0;
+    }
+    return sampler_take(size);
+}
+
+// Note that a sampled block is live, and that it was freed again
+void sampler_mark(const void *ptr);
+void sampler_unmark(const void *ptr);
+// 0 when a block being freed was certainly not sampled
+int sampler_may_hold(const void *ptr);
+// Number of allocations a recorded block of this size stands for
+double sample_weight(size_t size);
+
+#endif // HEAP_SAMPLER_H
@@ -0,0 +1,245 @@
+#define _GNU_SOURCE
+#include "heap_snapshot.h"
+#include "stack_depot.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <link.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+typedef struct {
+    FILE *file;
+    uint64_t names_size;  // Bytes of names written or counted so far
+    uint64_t count;
+    int write_names;      // 0: records, 1: names
+} ModuleWriter;
+
+static uint64_t align8(uint64_t offset) {
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+static void pad_to(FILE *file, uint64_t offset) {
+    static const char zeros[8];
+    long position = ftell(file);
+    if (position >= 0 && (uint64_t)position < offset) {
+        fwrite(zeros, 1, offset - (uint64_t)position, file);
+    }
+}
+
+// The main program reports an empty name; /proc/self/exe stands in for it
+static const char *module_name(const struct dl_phdr_info *info, char *executable, size_t size) {
+    if (info->dlpi_name && info->dlpi_name[0]) {
+        return info->dlpi_name;
+    }
+    ssize_t length = readlink("/proc/self/exe", executable, size - 1);
+    executable[length > 0 ? length : 0] = '\0';
+    return executable;
+}
+
+// Called twice: once to write the module records (or just count them when
+// file is NULL), once to write their names in the same order
+static int visit_module(struct dl_phdr_info *info, size_t size, void *context) {
+    (void)size;
+    ModuleWriter *writer = context;
+    SnapshotModule module = {UINT64_MAX, 0, writer->names_size};
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        if (info->dlpi_phdr[i].p_type != PT_LOAD) continue;
+        uint64_t low = info->dlpi_addr + info->dlpi_phdr[i].p_vaddr;
+        uint64_t high = low + info->dlpi_phdr[i].p_memsz;
+        if (low < module.low) module.low = low;
+        if (high > module.high) module.high = high;
+    }
+    if (module.high == 0) {
+        return 0;  // Nothing loaded
+    }
+    char executable[512];
+    const char *name = module_name(info, executable, sizeof(executable));
+    size_t length = strlen(name) + 1;
+    if (writer->file) {
+        if (writer->write_names) {
+            fwrite(name, 1, length, writer->file);
+        } else {
+            fwrite(&module, sizeof(module), 1, writer->file);
+        }
+    }
+    writer->names_size += length;
+    writer->count++;
+    return 0;
+}
+
+static void write_block(const MemoryBlock *block, void *context) {
+    SnapshotBlock record = {(uint64_t)(uintptr_t)block->ptr, block->size, block->stack, 0};
+    fwrite(&record, sizeof(record), 1, context);
+}
+
+int heap_snapshot_write(const char *path, const AllocationTable *blocks, size_t sample_interval) {
+    char temporary[4096];
+    if (snprintf(temporary, sizeof(temporary), "%s.tmp", path) >= (int)sizeof(temporary)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    FILE *file = fopen(temporary, "wb");
+    if (!file) {
+        return -1;
+    }
+
+    // Blocks only name stacks that existed when they were collected
+    uint32_t stack_count = depot_size();
+    uint64_t frame_count = 0;
+    for (uint32_t id = 1; id <= stack_count; id++) {
+        const uintptr_t *frames;
+        frame_count += depot_get(id, &frames);
+    }
+    ModuleWriter counter = {NULL, 0, 0, 0};
+    dl_iterate_phdr(visit_module, &counter);
+
+    SnapshotHeader header = {.version = SNAPSHOT_VERSION, .header_size = sizeof(SnapshotHeader)};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.pid = (uint64_t)getpid();
+    header.time = (uint64_t)time(NULL);
+    header.sample_interval = sample_interval;
+    header.block_count = blocks->live_count;
+    header.blocks_offset = align8(sizeof(SnapshotHeader));
+    header.stack_count = stack_count;
+    header.stack_starts_offset = header.blocks_offset + header.block_count * sizeof(SnapshotBlock);
+    header.frame_count = frame_count;
+    header.frames_offset = header.stack_starts_offset + ((uint64_t)stack_count + 1) * sizeof(uint64_t);
+    header.module_count = counter.count;
+    header.modules_offset = header.frames_offset + frame_count * sizeof(uint64_t);
+    header.names_size = counter.names_size;
+    header.names_offset = header.modules_offset + counter.count * sizeof(SnapshotModule);
+
+    fwrite(&header, sizeof(header), 1, file);
+    pad_to(file, header.blocks_offset);
+    table_for_each(blocks, write_block, file);
+
+    uint64_t start = 0;
+    fwrite(&start, sizeof(start), 1, file);  // Id 0
+    for (uint32_t id = 1; id <= stack_count; id++) {
+        const uintptr_t *frames;
+        start += depot_get(id, &frames);
+        fwrite(&start, sizeof(start), 1, file);
+    }
+    for (uint32_t id = 1; id <= stack_count; id++) {
+        const uintptr_t *frames;
+        unsigned depth = depot_get(id, &frames);
+        for (unsigned i = 0; i < depth; i++) {
+            uint64_t frame = frames[i];
+            fwrite(&frame, sizeof(frame), 1, file);
+        }
+    }
+
+    // Modules loaded or unloaded since counting would break the layout
+    ModuleWriter records = {file, 0, 0, 0}, names = {file, 0, 0, 1};
+    dl_iterate_phdr(visit_module, &records);
+    dl_iterate_phdr(visit_module, &names);
+    int consistent = records.count == counter.count && names.names_size == counter.names_size;
+
+    int failed = ferror(file) || !consistent;
+    if (fclose(file) != 0) {
+        failed = 1;
+    }
+    if (failed || rename(temporary, path) != 0) {
+        int saved_errno = consistent ? errno : EAGAIN;
+        unlink(temporary);
+        errno = saved_errno;
+        return -1;
+    }
+    return 0;
+}
+
+// Whether count records of a given size fit in the file at an offset
+static int section_fits(const HeapSnapshot *snapshot, uint64_t offset, uint64_t count, uint64_t size) {
+    return offset % 8 == 0 && offset <= snapshot->length && count <= (snapshot->length - offset) / size;
+}
+
+int heap_snapshot_open(const char *path, HeapSnapshot *snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open snapshot %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(SnapshotHeader)) {
+        fprintf(stderr, "%s is not a heap snapshot\n", path);
+        close(fd);
+        return -1;
+    }
+    snapshot->length = (size_t)status.st_size;
+    snapshot->mapping = mmap(NULL, snapshot->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (snapshot->mapping == MAP_FAILED) {
+        fprintf(stderr, "Cannot map snapshot %s: %s\n", path, strerror(errno));
+        snapshot->mapping = NULL;
+        return -1;
+    }
+
+    const SnapshotHeader *header = snapshot->header = snapshot->mapping;
+    const char *base = snapshot->mapping;
+    const char *problem = NULL;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0) {
+        problem = "is not a heap snapshot";
+    } else if (header->version != SNAPSHOT_VERSION || header->header_size != sizeof(SnapshotHeader)) {
+        problem = "has an unsupported snapshot version";
+    } else if (!section_fits(snapshot, header->blocks_offset, header->block_count, sizeof(SnapshotBlock)) ||
+               header->stack_count >= UINT32_MAX ||
+               !section_fits(snapshot, header->stack_starts_offset, header->stack_count + 1, sizeof(uint64_t)) ||
+               !section_fits(snapshot, header->frames_offset, header->frame_count, sizeof(uint64_t)) ||
+               !section_fits(snapshot, header->modules_offset, header->module_count, sizeof(SnapshotModule)) ||
+               !section_fits(snapshot, header->names_offset, header->names_size, 1) ||
+               (header->names_size && base[header->names_offset + header->names_size - 1] != '\0')) {
+        problem = "is truncated or corrupt";
+    }
+    if (!problem) {
+        snapshot->blocks = (const SnapshotBlock *)(base + header->blocks_offset);
+        snapshot->stack_starts = (const uint64_t *)(base + header->stack_starts_offset);
+        snapshot->frames = (const uint64_t *)(base + header->frames_offset);
+        snapshot->modules = (const SnapshotModule *)(base + header->modules_offset);
+        snapshot->names = base + header->names_offset;
+        if (snapshot->stack_starts[header->stack_count] > header->frame_count) {
+            problem = "is truncated or corrupt";
+        }
+        for (uint64_t i = 0; !problem && i < header->module_count; i++) {
+            if (snapshot->modules[i].name >= header->names_size) problem = "is truncated or corrupt";
+        }
+    }
+    if (problem) {
+        fprintf(stderr, "%s %s\n", path, problem);
+        heap_snapshot_close(snapshot);
+        return -1;
+    }
+    return 0;
+}
+
+void heap_snapshot_close(HeapSnapshot *snapshot) {
+    if (snapshot->mapping) {
+        munmap(snapshot->mapping, snapshot->length);
+    }
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+unsigned heap_snapshot_stack(const HeapSnapshot *snapshot, uint32_t id, const uint64_t **frames) {
+    if (id == NO_STACK || id > snapshot->header->stack_count) {
+        return 0;
+    }
+    uint64_t start = snapshot->stack_starts[id - 1], end = snapshot->stack_starts[id];
+    if (start > end || end > snapshot->header->frame_count) {
+        return 0;
+    }
+    *frames = snapshot->frames + start;
+    return (unsigned)(end - start);
+}
+
+const SnapshotModule *heap_snapshot_module(const HeapSnapshot *snapshot, uint64_t address) {
+    for (uint64_t i = 0; i < snapshot->header->module_count; i++) {
+        if (address >= snapshot->modules[i].low && address < snapshot->modules[i].high) {
+            return &snapshot->modules[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,75 @@
+#ifndef HEAP_SNAPSHOT_H
+#define HEAP_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "allocation_table.h"
+
+// Binary dump of the tracking state: every tracked block, the stack depot
+// and the modules the stack addresses belong to. Every section is an array
+// of fixed-size records at an 8-byte aligned offset named in the header, so
+// a reader maps the file and uses the arrays in place. Snapshots are
+// written to a temporary name and renamed, so a reader never sees a
+// partial file.
+//
+// Layout: SnapshotHeader, SnapshotBlock[block_count],
+// uint64_t stack_starts[stack_count + 1] (frames of stack id i are
+// frames[stack_starts[i - 1] .. stack_starts[i]); id 0 has none),
+// uint64_t frames[frame_count], SnapshotModule[module_count], then the
+// module names as NUL-terminated strings.
+
+#define SNAPSHOT_MAGIC "HEAPSNAP"
+#define SNAPSHOT_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t pid;
+    uint64_t time;             // Seconds since the epoch
+    uint64_t sample_interval;  // 0 when every allocation was tracked
+    uint64_t block_count, blocks_offset;
+    uint64_t stack_count, stack_starts_offset;
+    uint64_t frame_count, frames_offset;
+    uint64_t module_count, modules_offset;
+    uint64_t names_size, names_offset;
+} SnapshotHeader;
+
+typedef struct {
+    uint64_t address;
+    uint64_t size;
+    uint32_t stack;
+    uint32_t reserved;
+} SnapshotBlock;
+
+// Address range of a loaded module and the offset of its path in the names
+typedef struct {
+    uint64_t low, high;
+    uint64_t name;
+} SnapshotModule;
+
+// A snapshot mapped for reading; all pointers point into the mapping
+typedef struct {
+    void *mapping;
+    size_t length;
+    const SnapshotHeader *header;
+    const SnapshotBlock *blocks;
+    const uint64_t *stack_starts;
+    const uint64_t *frames;
+    const SnapshotModule *modules;
+    const char *names;
+} HeapSnapshot;
+
+// Write the blocks of a table and the current stack depot. Returns 0 on
+// success, -1 with errno set otherwise.
+int heap_snapshot_write(const char *path, const AllocationTable *blocks, size_t sample_interval);
+// Map a snapshot and check its header and section bounds. Returns 0 on
+// success; on failure prints the reason to stderr and returns -1.
+int heap_snapshot_open(const char *path, HeapSnapshot *snapshot);
+void heap_snapshot_close(HeapSnapshot *snapshot);
+// Frames of a stack id; returns the depth, 0 for an unknown id
+unsigned heap_snapshot_stack(const HeapSnapshot *snapshot, uint32_t id, const uint64_t **frames);
+// Module containing an address, NULL if none does
+const SnapshotModule *heap_snapshot_module(const HeapSnapshot *snapshot, uint64_t address);
+
+#endif // HEAP_SNAPSHOT_H
@@ -0,0 +1,424 @@
+// LD_PRELOAD front end of the leak detector. Build it as a shared library
+// together with mem_leak_detector.c (compiled with -DLEAK_DETECTOR_PRELOAD),
+// allocation_table.c, allocation_tracker.c, stack_depot.c, heap_sampler.c
+// and leak_scan.c, then run any program with
+//
+//     LD_PRELOAD=./libleakdetector.so ./program
+//
+// The allocation functions below replace the C library's for the whole
+// process. Each one forwards to the real implementation found with
+// dlsym(RTLD_NEXT) and records the result with the sharded tracker. The
+// report is written to stderr at exit, or to the file named by
+// LEAK_DETECTOR_OUTPUT, which is rewritten by each process as it exits.
+//
+// Setting LEAK_DETECTOR_SAMPLE_INTERVAL to a byte count (with an optional
+// K, M or G suffix) records only a Poisson sample of the allocations, one
+// per that many bytes on average, and reports estimated totals instead.
+//
+// LEAK_DETECTOR_SNAPSHOT=PREFIX writes a binary heap snapshot to
+// PREFIX.PID.N.heap at exit, and every LEAK_DETECTOR_SNAPSHOT_SECONDS seconds
+// from a background thread if that is set; heap_diff compares two of them.
+// Periodic snapshots leave out the last few allocations still buffered by
+// each thread, rather than stopping the threads to collect them.
+//
+// LEAK_DETECTOR_METRICS=PREFIX times every tracked allocation and free and
+// appends JSON lines with their latency histograms and the live block
+// totals to PREFIX.PID.jsonl at exit, and every
+// LEAK_DETECTOR_METRICS_SECONDS seconds if that is set.
+//
+// Without sampling, a reachability scan at exit sorts the remaining blocks
+// into definitely lost, indirectly lost and still reachable, using
+// LEAK_DETECTOR_SCAN_THREADS threads (default: the online CPUs, at most 8;
+// 0 skips the scan and reports every remaining block).
+//
+// Two kinds of recursion have to be broken:
+//  - dlsym itself calls calloc before the real functions are known; those
+//    requests are served from a small static arena and never freed.
+//  - Anything the detector does (stdio, pthread_atfork) may call malloc
+//    again; a per-thread flag makes such nested calls go straight to the
+//    real allocator untracked. The tables themselves live in mmap'd memory.
+
+#define _GNU_SOURCE
+#include "mem_leak_detector.h"
+#include "allocation_tracker.h"
+#include "stack_depot.h"
+#include "heap_sampler.h"
+#include "leak_scan.h"
+#include "heap_snapshot.h"
+#include "size_parse.h"
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BOOTSTRAP_ARENA_SIZE (64 * 1024)
+#define BOOTSTRAP_ALIGNMENT 16
+
+static void *(*real_malloc)(size_t);
+static void *(*real_calloc)(size_t, size_t);
+static void *(*real_realloc)(void *, size_t);
+static void (*real_free)(void *);
+static int (*real_posix_memalign)(void **, size_t, size_t);
+static void *(*real_aligned_alloc)(size_t, size_t);
+
+static _Alignas(BOOTSTRAP_ALIGNMENT) char bootstrap_arena[BOOTSTRAP_ARENA_SIZE];
+static size_t bootstrap_used;
+static int resolving;
+
+// Initial-exec TLS is reached without calling __tls_get_addr, which could
+// allocate on first use
+static __thread int in_hook __attribute__((tls_model("initial-exec")));
+
+// Copy of stderr taken at startup; some programs close stderr before exit
+static int report_fd = -1;
+
+static const char *snapshot_prefix;
+static unsigned snapshot_sequence;
+
+static const char *metrics_prefix;
+static FILE *metrics_output;
+static pid_t metrics_pid;  // Process metrics_output was opened by
+static uint64_t metrics_start_ns, metrics_snapshots;
+static pthread_mutex_t metrics_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *bootstrap_alloc(size_t size) {
+    size_t rounded = (size + BOOTSTRAP_ALIGNMENT - 1) & ~(size_t)(BOOTSTRAP_ALIGNMENT - 1);
+    size_t offset = __atomic_fetch_add(&bootstrap_used, rounded, __ATOMIC_RELAXED);
+    if (offset + rounded > BOOTSTRAP_ARENA_SIZE) {
+        return NULL;
+    }
+    return bootstrap_arena + offset;
+}
+
+static int is_bootstrap(const void *ptr) {
+    const char *address = ptr;
+    return address >= bootstrap_arena && address < bootstrap_arena + BOOTSTRAP_ARENA_SIZE;
+}
+
+// Mean sampling interval from the environment; 0 (track everything) when
+// unset or invalid
+static size_t read_sample_interval(void) {
+    const char *value = getenv("LEAK_DETECTOR_SAMPLE_INTERVAL");
+    if (!value || !*value) {
+        return 0;
+    }
+    uint64_t interval = parse_size(value);
+    if (interval == 0 || interval > SIZE_MAX) {
+        fprintf(stderr, "leak detector: ignoring invalid LEAK_DETECTOR_SAMPLE_INTERVAL '%s'\n", value);
+        return 0;
+    }
+    return (size_t)interval;
+}
+
+static void resolve_real_functions(void) {
+    resolving = 1;
+    real_malloc = dlsym(RTLD_NEXT, "malloc");
+    real_calloc = dlsym(RTLD_NEXT, "calloc");
+    real_realloc = dlsym(RTLD_NEXT, "realloc");
+    real_free = dlsym(RTLD_NEXT, "free");
+    real_posix_memalign = dlsym(RTLD_NEXT, "posix_memalign");
+    real_aligned_alloc = dlsym(RTLD_NEXT, "aligned_alloc");
+    resolving = 0;
+
+    in_hook = 1;
+    sampler_init(read_sample_interval());
+    tracker_init();
+    pthread_atfork(tracker_lock_all, tracker_unlock_all, tracker_reset_locks);
+    in_hook = 0;
+}
+
+// The caller has in_hook set
+static void write_snapshot(const AllocationTable *blocks) {
+    char path[4096];
+    unsigned sequence = __atomic_fetch_add(&snapshot_sequence, 1, __ATOMIC_RELAXED);
+    snprintf(path, sizeof(path), "%s.%ld.%u.heap", snapshot_prefix, (long)getpid(), sequence);
+    if (heap_snapshot_write(path, blocks, sampler_interval) != 0) {
+        fprintf(stderr, "leak detector: cannot write snapshot %s: %s\n", path, strerror(errno));
+    }
+}
+
+// The caller has in_hook set
+static void open_metrics(void) {
+    char path[4096];
+    metrics_pid = getpid();
+    metrics_snapshots = 0;
+    snprintf(path, sizeof(path), "%s.%ld.jsonl", metrics_prefix, (long)metrics_pid);
+    metrics_output = fopen(path, "w");
+    if (!metrics_output) {
+        fprintf(stderr, "leak detector: cannot write metrics %s: %s\n", path, strerror(errno));
+    }
+}
+
+// The caller has in_hook set
+static void write_metrics(void) {
+    if (getpid() != metrics_pid) {
+        // A forked child, alone with a copy of the lock, starts a file of its own
+        pthread_mutex_init(&metrics_lock, NULL);
+        if (metrics_output) {
+            fclose(metrics_output);
+        }
+        open_metrics();
+    }
+    if (!metrics_output) {
+        return;
+    }
+    TrackerMetrics metrics;
+    tracker_collect_metrics(&metrics);
+    SnapshotWriter writer;
+    pthread_mutex_lock(&metrics_lock);
+    snapshot_begin(&writer, metrics_output, "leak_detector", (double)(metrics_now_ns() - metrics_start_ns) / 1e9);
+    snapshot_count(&writer, "pid", (uint64_t)metrics_pid);
+    snapshot_count(&writer, "snapshot", metrics_snapshots++);
+    snapshot_count(&writer, "threads", metrics.threads);
+    snapshot_count(&writer, "sample_interval", sampler_interval);
+    snapshot_count(&writer, "live_blocks", metrics.live_blocks);
+    snapshot_count(&writer, "live_bytes", metrics.live_bytes);
+    snapshot_count(&writer, "published_allocations", metrics.published_allocations);
+    snapshot_count(&writer, "published_frees", metrics.published_frees);
+    snapshot_histogram(&writer, "track_ns", &metrics.latency_ns[TRACK_ALLOC]);
+    snapshot_histogram(&writer, "untrack_ns", &metrics.latency_ns[TRACK_FREE]);
+    snapshot_end(&writer);
+    pthread_mutex_unlock(&metrics_lock);
+}
+
+static void *write_metrics_periodically(void *argument) {
+    unsigned seconds = (unsigned)(uintptr_t)argument;
+    in_hook = 1;
+    for (;;) {
+        sleep(seconds);
+        write_metrics();
+    }
+    return NULL;
+}
+
+// Start a detached background thread; the caller has in_hook set
+static void start_thread(void *(*body)(void *), unsigned seconds, const char *purpose) {
+    pthread_attr_t attributes;
+    pthread_t thread;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attributes, body, (void *)(uintptr_t)seconds) != 0) {
+        fprintf(stderr, "leak detector: cannot start the %s thread\n", purpose);
+    }
+    pthread_attr_destroy(&attributes);
+}
+
+static void *snapshot_periodically(void *argument) {
+    unsigned seconds = (unsigned)(uintptr_t)argument;
+    in_hook = 1;  // Nothing this thread allocates is the program's
+    for (;;) {
+        sleep(seconds);
+        AllocationTable blocks;
+        table_init(&blocks);
+        tracker_collect(&blocks);
+        write_snapshot(&blocks);
+        table_destroy(&blocks);
+    }
+    return NULL;
+}
+
+// Run before main so that the real functions are known before any thread
+// starts; the allocation functions still resolve lazily for constructors
+// of other libraries that run earlier
+__attribute__((constructor)) static void initialize_detector(void) {
+    if (!real_malloc) {
+        resolve_real_functions();
+    }
+    report_fd = dup(STDERR_FILENO);
+
+    in_hook = 1;
+    snapshot_prefix = getenv("LEAK_DETECTOR_SNAPSHOT");
+    const char *seconds = getenv("LEAK_DETECTOR_SNAPSHOT_SECONDS");
+    if (snapshot_prefix && seconds && atoi(seconds) > 0) {
+        start_thread(snapshot_periodically, (unsigned)atoi(seconds), "snapshot");
+    }
+    metrics_prefix = getenv("LEAK_DETECTOR_METRICS");
+    if (metrics_prefix) {
+        tracker_enable_metrics();
+        metrics_start_ns = metrics_now_ns();
+        open_metrics();
+        seconds = getenv("LEAK_DETECTOR_METRICS_SECONDS");
+        if (seconds && atoi(seconds) > 0) {
+            start_thread(write_metrics_periodically, (unsigned)atoi(seconds), "metrics");
+        }
+    }
+    in_hook = 0;
+}
+
+// frame is the wrapper's own frame, so the stack starts at its caller
+static void record(void *ptr, size_t size, void *frame) {
+    in_hook = 1;
+    uint64_t started = metrics_prefix ? metrics_now_ns() : 0;
+    sampler_mark(ptr);
+    tracker_alloc(ptr, size, depot_capture(frame));
+    if (metrics_prefix) {
+        tracker_record_latency(TRACK_ALLOC, metrics_now_ns() - started);
+    }
+    in_hook = 0;
+}
+
+static void track(void *ptr, size_t size, void *frame) {
+    if (!ptr || in_hook || !sample_allocation(size)) return;
+    record(ptr, size, frame);
+}
+
+// Returns the size the block was tracked with, 0 if it was not tracked
+static size_t untrack(void *ptr) {
+    if (!ptr || in_hook || !sampler_may_hold(ptr)) return 0;
+    in_hook = 1;
+    uint64_t started = metrics_prefix ? metrics_now_ns() : 0;
+    size_t size = tracker_free(ptr);
+    if (size) {
+        sampler_unmark(ptr);
+    }
+    if (metrics_prefix) {
+        tracker_record_latency(TRACK_FREE, metrics_now_ns() - started);
+    }
+    in_hook = 0;
+    return size;
+}
+
+void *malloc(size_t size) {
+    if (!real_malloc) {
+        if (resolving) return bootstrap_alloc(size);
+        resolve_real_functions();
+    }
+    void *ptr = real_malloc(size);
+    track(ptr, size, __builtin_frame_address(0));
+    return ptr;
+}
+
+void *calloc(size_t count, size_t size) {
+    if (!real_calloc) {
+        // The arena is static storage and therefore already zeroed
+        if (resolving) return count && size > SIZE_MAX / count ? NULL : bootstrap_alloc(count * size);
+        resolve_real_functions();
+    }
+    void *ptr = real_calloc(count, size);
+    track(ptr, count * size, __builtin_frame_address(0));
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size) {
+    if (!real_realloc) {
+        if (resolving) return bootstrap_alloc(size);
+        resolve_real_functions();
+    }
+    if (is_bootstrap(ptr)) {
+        // Move a bootstrap block to the real heap; its old size is not
+        // known, so copy as much as the arena can hold
+        void *moved = malloc(size);
+        size_t available = (size_t)(bootstrap_arena + BOOTSTRAP_ARENA_SIZE - (char *)ptr);
+        if (moved) memcpy(moved, ptr, size < available ? size : available);
+        return moved;
+    }
+    // Forget the old address before the real realloc can hand it to another thread
+    size_t old_size = untrack(ptr);
+    void *resized = real_realloc(ptr, size);
+    if (resized) {
+        track(resized, size, __builtin_frame_address(0));
+    } else if (ptr && size && old_size) {
+        record(ptr, old_size, __builtin_frame_address(0));  // Failed; the old block is still live
+    }
+    return resized;
+}
+
+void free(void *ptr) {
+    if (!ptr || is_bootstrap(ptr)) {
+        return;
+    }
+    if (!real_free) {
+        resolve_real_functions();
+    }
+    untrack(ptr);
+    real_free(ptr);
+}
+
+int posix_memalign(void **result, size_t alignment, size_t size) {
+    if (!real_posix_memalign) {
+        resolve_real_functions();
+    }
+    int status = real_posix_memalign(result, alignment, size);
+    if (status == 0) {
+        track(*result, size, __builtin_frame_address(0));
+    }
+    return status;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    if (!real_aligned_alloc) {
+        resolve_real_functions();
+    }
+    void *ptr = real_aligned_alloc(alignment, size);
+    track(ptr, size, __builtin_frame_address(0));
+    return ptr;
+}
+
+// Marking threads for the reachability scan, 0 to skip it
+static int scan_threads(void) {
+    const char *value = getenv("LEAK_DETECTOR_SCAN_THREADS");
+    if (value && *value) {
+        return atoi(value) > 0 ? atoi(value) : 0;
+    }
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return online < 1 ? 1 : online > 8 ? 8 : (int)online;
+}
+
+// A sample says nothing about the unsampled blocks pointers pass through,
+// so sampled runs are reported without a scan
+static void report_leaks(FILE *output) {
+    int threads = sampler_interval ? 0 : scan_threads();
+    if (threads == 0) {
+        report_memory_leaks(output, 0);
+        return;
+    }
+    AllocationTable definitely_lost, indirectly_lost, reachable;
+    table_init(&definitely_lost);
+    table_init(&indirectly_lost);
+    table_init(&reachable);
+    ScanStats stats = scan_reachability(&allocated_memory, &definitely_lost, &indirectly_lost, &reachable, threads);
+    if (stats.skipped) {
+        fprintf(output, "Reachability scan skipped: other threads are running and memory cannot be read safely\n");
+        report_memory_leaks(output, 0);
+    } else {
+        fprintf(output, "Scanned %zu KiB of roots with %d thread(s) in %.1f ms\n", stats.root_bytes / 1024,
+                stats.threads, stats.seconds * 1e3);
+        if (stats.other_threads > 0) {
+            fprintf(output, "Other threads still running: %d, registers scanned for %d\n", stats.other_threads,
+                    stats.registers_saved);
+        }
+        report_classified_leaks(output, &definitely_lost, &indirectly_lost, &reachable);
+    }
+    table_destroy(&definitely_lost);
+    table_destroy(&indirectly_lost);
+    table_destroy(&reachable);
+}
+
+__attribute__((destructor)) static void report_at_exit(void) {
+    int saved_errno = errno;
+    in_hook = 1;
+    const char *filename = getenv("LEAK_DETECTOR_OUTPUT");
+    FILE *output = filename ? fopen(filename, "w") : report_fd >= 0 ? fdopen(report_fd, "w") : NULL;
+    if (!output) {
+        output = stderr;
+    }
+    // Gather every shard into the detector's own table for the report
+    tracker_flush_all();
+    table_init(&allocated_memory);
+    tracker_collect(&allocated_memory);
+    fprintf(output, "\nLeak report for process %ld\n", (long)getpid());
+    report_leaks(output);
+    if (snapshot_prefix) {
+        write_snapshot(&allocated_memory);
+    }
+    if (metrics_prefix) {
+        write_metrics();
+    }
+    table_destroy(&allocated_memory);
+    if (output != stderr) {
+        fclose(output);
+    }
+    in_hook = 0;
+    errno = saved_errno;
+}
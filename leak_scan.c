@@ -0,0 +1,576 @@
+#define _GNU_SOURCE
+#include "leak_scan.h"
+#include "allocation_tracker.h"
+#include "stack_depot.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <link.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+#define SCAN_CHUNK (64 * 1024)
+#define MAX_RANGES 65536
+#define MAX_SCAN_THREADS 64
+#define MAX_OTHER_THREADS 1024
+#define REGISTER_SIGNAL SIGPWR  // Unused by most programs; the Boehm collector's choice on Linux
+#define REGISTER_WAIT_MS 100
+
+enum { UNREACHED, REACHABLE, LOST, INDIRECT };
+
+typedef struct {
+    uintptr_t low, high;
+} Range;
+
+typedef struct {
+    Range *items;
+    size_t count;
+} RangeList;
+
+// Tracked blocks sorted by address. bucket_first[b] is the number of blocks
+// starting below bucket b, so the blocks starting inside it are
+// bucket_first[b] .. bucket_first[b + 1] - 1.
+typedef struct {
+    MemoryBlock *blocks;
+    uint8_t *state;
+    size_t count;
+    uintptr_t low, high;  // Span of all blocks
+    unsigned shift;       // log2 of the bytes covered by a bucket
+    uint32_t *bucket_first;
+    size_t buckets;
+} BlockIndex;
+
+// Reads memory for the scan. With other threads running, a block can be
+// freed and its pages unmapped between taking the block list and reading
+// it, so the words are copied with process_vm_readv, which fails where a
+// plain load would fault. buffer is NULL to read in place.
+typedef struct {
+    uintptr_t *buffer;  // SCAN_CHUNK bytes
+    pid_t pid;
+    uintptr_t page_size;
+} WordReader;
+
+typedef struct {
+    BlockIndex *index;
+    Range *chunks;
+    size_t chunk_count;
+    size_t next_chunk;
+} MarkJob;
+
+typedef struct {
+    MarkJob *job;
+    WordReader reader;
+    uint32_t *stack;  // Blocks reached but not scanned yet
+    size_t top;
+} MarkWorker;
+
+// Registers of another thread, written by its REGISTER_SIGNAL handler
+typedef struct {
+    pid_t tid;
+    int requested;  // Signalled and not answered yet
+    int saved;
+    mcontext_t registers;
+} ThreadRegisters;
+
+// Never unmapped: a thread may take the signal after the scan gave up on it
+static ThreadRegisters *register_slots;
+static size_t register_slot_count;
+// The program's handler, restored once every request has been answered
+static struct sigaction previous_action;
+static int collecting;   // Answers are still wanted in the slots
+static int outstanding;  // Requests not answered yet
+
+// Scratch arrays come straight from mmap: the scan runs inside the
+// allocator hooks and must not disturb the heap it is looking at
+static void *reserve(size_t bytes) {
+    void *memory = mmap(NULL, bytes ? bytes : 1, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return memory == MAP_FAILED ? NULL : memory;
+}
+
+static void release(void *memory, size_t bytes) {
+    if (memory) munmap(memory, bytes ? bytes : 1);
+}
+
+static void add_range(RangeList *list, uintptr_t low, uintptr_t high) {
+    if (low < high && list->count < MAX_RANGES) {
+        list->items[list->count++] = (Range){low, high};
+    }
+}
+
+static uintptr_t block_end(const MemoryBlock *block) {
+    return (uintptr_t)block->ptr + (block->size ? block->size : 1);
+}
+
+static void copy_block(const MemoryBlock *block, void *context) {
+    BlockIndex *index = context;
+    index->blocks[index->count++] = *block;
+}
+
+static void insert_block(const MemoryBlock *block, void *context) {
+    table_insert(context, block->ptr, block->size, block->stack);
+}
+
+static int compare_blocks(const void *a, const void *b) {
+    uintptr_t first = (uintptr_t)((const MemoryBlock *)a)->ptr, second = (uintptr_t)((const MemoryBlock *)b)->ptr;
+    return first < second ? -1 : first > second;
+}
+
+static int build_index(BlockIndex *index, const AllocationTable *table) {
+    memset(index, 0, sizeof(*index));
+    index->blocks = reserve(table->live_count * sizeof(MemoryBlock));
+    index->state = reserve(table->live_count);
+    if (!index->blocks || !index->state) {
+        return 0;
+    }
+    table_for_each(table, copy_block, index);
+    qsort(index->blocks, index->count, sizeof(MemoryBlock), compare_blocks);
+    if (index->count == 0) {
+        return 1;
+    }
+
+    index->low = (uintptr_t)index->blocks[0].ptr;
+    for (size_t i = 0; i < index->count; i++) {
+        uintptr_t end = block_end(&index->blocks[i]);
+        if (end > index->high) index->high = end;
+    }
+    // About one block per bucket
+    while (index->shift < 63 && ((index->high - index->low) >> index->shift) > index->count) {
+        index->shift++;
+    }
+    index->buckets = ((index->high - index->low) >> index->shift) + 1;
+    index->bucket_first = reserve((index->buckets + 1) * sizeof(uint32_t));
+    if (!index->bucket_first) {
+        return 0;
+    }
+    size_t block = 0;
+    for (size_t bucket = 0; bucket <= index->buckets; bucket++) {
+        uintptr_t bucket_low = index->low + ((uintptr_t)bucket << index->shift);
+        while (block < index->count && (uintptr_t)index->blocks[block].ptr < bucket_low) {
+            block++;
+        }
+        index->bucket_first[bucket] = (uint32_t)block;
+    }
+    return 1;
+}
+
+static void destroy_index(BlockIndex *index, size_t capacity) {
+    release(index->blocks, capacity * sizeof(MemoryBlock));
+    release(index->state, capacity);
+    release(index->bucket_first, (index->buckets + 1) * sizeof(uint32_t));
+}
+
+// Index of the block containing an address, -1 if there is none
+static long find_block(const BlockIndex *index, uintptr_t address) {
+    if (address < index->low || address >= index->high) {
+        return -1;
+    }
+    size_t bucket = (address - index->low) >> index->shift;
+    size_t low = index->bucket_first[bucket], high = index->bucket_first[bucket + 1];
+    if (low > 0) {
+        low--;  // The block covering the address may start in an earlier bucket
+    }
+    long found = -1;
+    while (low < high) {  // Last block starting at or below the address
+        size_t middle = low + (high - low) / 2;
+        if ((uintptr_t)index->blocks[middle].ptr <= address) {
+            found = (long)middle;
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return found >= 0 && address < block_end(&index->blocks[found]) ? found : -1;
+}
+
+// The next run of readable words of [*low, high), a chunk at a time when
+// copying; pages that cannot be read are skipped. Advances *low past the
+// run and returns its length, 0 at the end of the range.
+static size_t next_words(const WordReader *reader, uintptr_t *low, uintptr_t high, const uintptr_t **words) {
+    *low = (*low + sizeof(uintptr_t) - 1) & ~(uintptr_t)(sizeof(uintptr_t) - 1);
+    while (*low < high && high - *low >= sizeof(uintptr_t)) {
+        size_t bytes = (high - *low) & ~(sizeof(uintptr_t) - 1);
+        if (!reader->buffer) {
+            *words = (const uintptr_t *)*low;
+            *low += bytes;
+            return bytes / sizeof(uintptr_t);
+        }
+        if (bytes > SCAN_CHUNK) bytes = SCAN_CHUNK;
+        struct iovec local = {reader->buffer, bytes}, remote = {(void *)*low, bytes};
+        ssize_t copied = process_vm_readv(reader->pid, &local, 1, &remote, 1, 0);
+        if (copied < (ssize_t)sizeof(uintptr_t)) {
+            *low = (*low | (reader->page_size - 1)) + 1;
+            continue;
+        }
+        *words = reader->buffer;
+        *low += (size_t)copied & ~(sizeof(uintptr_t) - 1);
+        return (size_t)copied / sizeof(uintptr_t);
+    }
+    return 0;
+}
+
+static void mark_range(MarkWorker *worker, uintptr_t low, uintptr_t high) {
+    BlockIndex *index = worker->job->index;
+    const uintptr_t *words;
+    size_t count;
+    while ((count = next_words(&worker->reader, &low, high, &words)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            long block = find_block(index, words[i]);
+            uint8_t expected = UNREACHED;
+            // Whichever thread claims a block scans it
+            if (block >= 0 && __atomic_load_n(&index->state[block], __ATOMIC_RELAXED) == UNREACHED &&
+                __atomic_compare_exchange_n(&index->state[block], &expected, REACHABLE, 0, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                worker->stack[worker->top++] = (uint32_t)block;
+            }
+        }
+    }
+}
+
+static void *mark_chunks(void *argument) {
+    MarkWorker *worker = argument;
+    MarkJob *job = worker->job;
+    size_t chunk;
+    while ((chunk = __atomic_fetch_add(&job->next_chunk, 1, __ATOMIC_RELAXED)) < job->chunk_count) {
+        mark_range(worker, job->chunks[chunk].low, job->chunks[chunk].high);
+        while (worker->top) {
+            const MemoryBlock *block = &job->index->blocks[worker->stack[--worker->top]];
+            mark_range(worker, (uintptr_t)block->ptr, (uintptr_t)block->ptr + block->size);
+        }
+    }
+    return NULL;
+}
+
+// Group the unreached blocks into definitely lost leaders and the blocks
+// they lead to. A leader reached later from another one is demoted, which
+// leaves one leader per lost structure, cycles included.
+static void classify_lost(BlockIndex *index, uint32_t *stack, const WordReader *reader) {
+    for (size_t leader = 0; leader < index->count; leader++) {
+        if (index->state[leader] != UNREACHED) continue;
+        index->state[leader] = LOST;
+        size_t top = 0;
+        stack[top++] = (uint32_t)leader;
+        while (top) {
+            const MemoryBlock *block = &index->blocks[stack[--top]];
+            uintptr_t low = (uintptr_t)block->ptr, high = low + block->size;
+            const uintptr_t *words;
+            size_t count;
+            while ((count = next_words(reader, &low, high, &words)) > 0) {
+                for (size_t i = 0; i < count; i++) {
+                    long target = find_block(index, words[i]);
+                    if (target < 0 || (size_t)target == leader) continue;
+                    if (index->state[target] == UNREACHED) {
+                        index->state[target] = INDIRECT;
+                        stack[top++] = (uint32_t)target;
+                    } else if (index->state[target] == LOST) {
+                        index->state[target] = INDIRECT;  // Its own blocks are already indirect
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Writable segments and this thread's TLS block of every loaded module
+static int add_module_roots(struct dl_phdr_info *info, size_t size, void *context) {
+    (void)size;
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr) *header = &info->dlpi_phdr[i];
+        if (header->p_type == PT_LOAD && (header->p_flags & PF_W)) {
+            uintptr_t low = info->dlpi_addr + header->p_vaddr;
+            add_range(context, low, low + header->p_memsz);
+        } else if (header->p_type == PT_TLS && info->dlpi_tls_data) {
+            uintptr_t low = (uintptr_t)info->dlpi_tls_data;
+            add_range(context, low, low + header->p_memsz);
+        }
+    }
+    return 0;
+}
+
+// The caller's callee-saved registers land in the jump buffer. It is never
+// jumped to; keeping setjmp out of the scan itself spares its locals.
+static __attribute__((noinline)) void save_registers(jmp_buf registers) {
+    setjmp(registers);
+}
+
+typedef struct {
+    RangeList *roots;
+    uintptr_t own_stack_pointer;
+} ThreadRoots;
+
+// Other threads' stacks are scanned whole; the caller's from its stack pointer
+static void add_thread_roots(uintptr_t low, uintptr_t high, void *context) {
+    ThreadRoots *threads = context;
+    if (threads->own_stack_pointer < low || threads->own_stack_pointer >= high) {
+        add_range(threads->roots, low, high);
+    }
+}
+
+static void restore_previous_action(void) {
+    sigaction(REGISTER_SIGNAL, &previous_action, NULL);
+}
+
+// A REGISTER_SIGNAL the scan did not send goes where it would have gone
+// without the scan
+static void forward_signal(int signal, siginfo_t *info, void *context) {
+    if (previous_action.sa_flags & SA_SIGINFO) {
+        previous_action.sa_sigaction(signal, info, context);
+    } else if (previous_action.sa_handler == SIG_DFL) {
+        restore_previous_action();
+        raise(signal);  // Delivered with the default action on return
+    } else if (previous_action.sa_handler != SIG_IGN) {
+        previous_action.sa_handler(signal);
+    }
+}
+
+// Late answers, from threads that had the signal blocked while the scan
+// waited, are only counted; the last one puts the program's handler back
+static void save_thread_registers(int signal, siginfo_t *info, void *context) {
+    pid_t tid = gettid();
+    size_t count = __atomic_load_n(&register_slot_count, __ATOMIC_ACQUIRE);
+    for (size_t i = 0; i < count; i++) {
+        if (register_slots[i].tid == tid && __atomic_exchange_n(&register_slots[i].requested, 0, __ATOMIC_SEQ_CST)) {
+            if (__atomic_load_n(&collecting, __ATOMIC_SEQ_CST)) {
+                register_slots[i].registers = ((const ucontext_t *)context)->uc_mcontext;
+                __atomic_store_n(&register_slots[i].saved, 1, __ATOMIC_RELEASE);
+            }
+            if (__atomic_sub_fetch(&outstanding, 1, __ATOMIC_SEQ_CST) == 0 &&
+                !__atomic_load_n(&collecting, __ATOMIC_SEQ_CST)) {
+                restore_previous_action();
+            }
+            return;
+        }
+    }
+    forward_signal(signal, info, context);
+}
+
+// Other threads of the process from /proc/self/task into register_slots;
+// -1 when it cannot be read
+static int list_other_threads(void) {
+    int fd = open("/proc/self/task", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    pid_t self = gettid();
+    int count = 0;
+    char buffer[4096];
+    ssize_t length;
+    while ((length = getdents64(fd, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t offset = 0; offset < length;) {
+            const struct dirent64 *entry = (const struct dirent64 *)(buffer + offset);
+            offset += entry->d_reclen;
+            pid_t tid = (pid_t)atoi(entry->d_name);
+            if (tid > 0 && tid != self && count < MAX_OTHER_THREADS) {
+                register_slots[count++] = (ThreadRegisters){.tid = tid};
+            }
+        }
+    }
+    close(fd);
+    return count;
+}
+
+// Ask every other thread for its registers with REGISTER_SIGNAL and add
+// the ones that answer within REGISTER_WAIT_MS to the roots. The threads
+// keep running: stopping them could leave one holding a lock of the C
+// library that the scan then needs. The program's own handler is put back
+// as soon as no answer is pending, and until then gets every signal the
+// scan did not send. Returns the number of other threads, or -1 when they
+// cannot be listed.
+static int add_other_registers(RangeList *roots, int *saved) {
+    *saved = 0;
+    if (!register_slots) {
+        register_slots = reserve(MAX_OTHER_THREADS * sizeof(ThreadRegisters));
+        if (!register_slots) {
+            return -1;
+        }
+    }
+    __atomic_store_n(&register_slot_count, 0, __ATOMIC_RELEASE);
+    int count = list_other_threads();
+    if (count <= 0) {
+        return count;
+    }
+    __atomic_store_n(&register_slot_count, (size_t)count, __ATOMIC_RELEASE);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = save_thread_registers;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigfillset(&action.sa_mask);
+    __atomic_store_n(&collecting, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&outstanding, __ATOMIC_SEQ_CST) == 0) {
+        sigaction(REGISTER_SIGNAL, &action, &previous_action);
+    }
+    pid_t pid = getpid();
+    int waiting = 0;
+    for (int i = 0; i < count; i++) {
+        __atomic_add_fetch(&outstanding, 1, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&register_slots[i].requested, 1, __ATOMIC_SEQ_CST);
+        if (tgkill(pid, register_slots[i].tid, REGISTER_SIGNAL) == 0) {
+            waiting++;
+        } else if (__atomic_exchange_n(&register_slots[i].requested, 0, __ATOMIC_SEQ_CST)) {
+            __atomic_sub_fetch(&outstanding, 1, __ATOMIC_SEQ_CST);  // Exited
+        }
+    }
+    for (int waited = 0; waited < REGISTER_WAIT_MS; waited++) {
+        int answered = 0;
+        for (int i = 0; i < count; i++) {
+            answered += __atomic_load_n(&register_slots[i].saved, __ATOMIC_ACQUIRE);
+        }
+        if (answered == waiting) break;
+        nanosleep(&(struct timespec){0, 1000000}, NULL);
+    }
+    __atomic_store_n(&collecting, 0, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < count; i++) {
+        if (__atomic_load_n(&register_slots[i].saved, __ATOMIC_ACQUIRE)) {
+            add_range(roots, (uintptr_t)&register_slots[i].registers, (uintptr_t)(&register_slots[i].registers + 1));
+            (*saved)++;
+        } else if (tgkill(pid, register_slots[i].tid, 0) != 0 &&
+                   __atomic_exchange_n(&register_slots[i].requested, 0, __ATOMIC_SEQ_CST)) {
+            __atomic_sub_fetch(&outstanding, 1, __ATOMIC_SEQ_CST);  // Exited before answering
+        }
+    }
+    if (__atomic_load_n(&outstanding, __ATOMIC_SEQ_CST) == 0) {
+        restore_previous_action();
+    }
+    return count;
+}
+
+// Readable mappings from /proc/self/maps, in address order
+static void read_mappings(RangeList *mappings) {
+    int fd = open("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    char buffer[8192];
+    size_t used = 0;
+    ssize_t length;
+    while ((length = read(fd, buffer + used, sizeof(buffer) - 1 - used)) > 0) {
+        used += (size_t)length;
+        buffer[used] = '\0';
+        char *line = buffer, *newline;
+        while ((newline = strchr(line, '\n')) != NULL) {
+            char *end;
+            uintptr_t low = strtoull(line, &end, 16), high = 0;
+            if (*end == '-') high = strtoull(end + 1, &end, 16);
+            if (*end == ' ' && end[1] == 'r') add_range(mappings, low, high);
+            line = newline + 1;
+        }
+        used -= (size_t)(line - buffer);
+        memmove(buffer, line, used);
+    }
+    close(fd);
+}
+
+// Cut the parts of the roots that are actually mapped into chunks
+static size_t make_chunks(const RangeList *roots, const RangeList *mappings, Range *chunks, size_t *bytes) {
+    size_t count = 0;
+    for (size_t r = 0; r < roots->count; r++) {
+        for (size_t m = 0; m < mappings->count; m++) {
+            uintptr_t low = roots->items[r].low > mappings->items[m].low ? roots->items[r].low : mappings->items[m].low;
+            uintptr_t high =
+                roots->items[r].high < mappings->items[m].high ? roots->items[r].high : mappings->items[m].high;
+            for (; low < high; low += SCAN_CHUNK) {
+                if (chunks) chunks[count] = (Range){low, high - low > SCAN_CHUNK ? low + SCAN_CHUNK : high};
+                if (bytes) *bytes += high - low > SCAN_CHUNK ? SCAN_CHUNK : high - low;
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+ScanStats scan_reachability(const AllocationTable *blocks, AllocationTable *definitely_lost,
+                            AllocationTable *indirectly_lost, AllocationTable *reachable, int threads) {
+    ScanStats stats = {0, 1, 0, 0, 0, 0};
+    struct timespec started, finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    int workers_wanted = threads < 1 ? 1 : threads > MAX_SCAN_THREADS ? MAX_SCAN_THREADS : threads;
+
+    size_t capacity = blocks->live_count;
+    BlockIndex index;
+    RangeList roots = {reserve(MAX_RANGES * sizeof(Range)), 0};
+    RangeList mappings = {reserve(MAX_RANGES * sizeof(Range)), 0};
+    uint32_t *stacks = reserve((size_t)workers_wanted * capacity * sizeof(uint32_t));
+    uintptr_t *copies = NULL;
+    if (!build_index(&index, blocks) || !roots.items || !mappings.items || !stacks) {
+        // Without scratch space nothing can be proven reachable
+        table_for_each(blocks, insert_block, definitely_lost);
+        goto done;
+    }
+
+    // Other threads may free what is being scanned: read through copies
+    WordReader reader = {NULL, getpid(), (uintptr_t)sysconf(_SC_PAGESIZE)};
+    stats.other_threads = add_other_registers(&roots, &stats.registers_saved);
+    if (stats.other_threads != 0) {
+        copies = reserve((size_t)workers_wanted * SCAN_CHUNK);
+        struct iovec local = {&reader.page_size, sizeof(uintptr_t)}, remote = local;
+        if (!copies || process_vm_readv(reader.pid, &local, 1, &remote, 1, 0) != (ssize_t)sizeof(uintptr_t)) {
+            stats.skipped = 1;
+            goto done;
+        }
+        reader.buffer = copies;
+    }
+
+    jmp_buf registers;
+    save_registers(registers);
+    add_range(&roots, (uintptr_t)&registers, (uintptr_t)(&registers + 1));
+    uintptr_t stack_pointer = (uintptr_t)__builtin_frame_address(0), stack_low, stack_high;
+    current_stack_bounds(&stack_low, &stack_high);
+    add_range(&roots, stack_pointer, stack_high);
+    dl_iterate_phdr(add_module_roots, &roots);
+    ThreadRoots thread_roots = {&roots, stack_pointer};
+    tracker_for_each_thread(add_thread_roots, &thread_roots);
+    read_mappings(&mappings);
+
+    MarkJob job = {&index, NULL, make_chunks(&roots, &mappings, NULL, NULL), 0};
+    job.chunks = reserve(job.chunk_count * sizeof(Range));
+    if (job.chunks) {
+        make_chunks(&roots, &mappings, job.chunks, &stats.root_bytes);
+        MarkWorker workers[MAX_SCAN_THREADS];
+        pthread_t ids[MAX_SCAN_THREADS];
+        int worker_count = (size_t)workers_wanted > job.chunk_count ? (int)(job.chunk_count ? job.chunk_count : 1)
+                                                                    : workers_wanted;
+        int started_threads = 1;
+        for (int t = 0; t < worker_count; t++) {
+            WordReader own = reader;
+            if (own.buffer) own.buffer += (size_t)t * SCAN_CHUNK / sizeof(uintptr_t);
+            workers[t] = (MarkWorker){&job, own, stacks + (size_t)t * capacity, 0};
+        }
+        for (int t = 1; t < worker_count; t++) {
+            if (pthread_create(&ids[t], NULL, mark_chunks, &workers[t]) != 0) break;
+            started_threads++;
+        }
+        mark_chunks(&workers[0]);
+        for (int t = 1; t < started_threads; t++) {
+            pthread_join(ids[t], NULL);
+        }
+        stats.threads = started_threads;
+        release(job.chunks, job.chunk_count * sizeof(Range));
+    }
+    classify_lost(&index, stacks, &reader);
+
+    for (size_t i = 0; i < index.count; i++) {
+        const MemoryBlock *block = &index.blocks[i];
+        AllocationTable *into = index.state[i] == REACHABLE ? reachable
+                                : index.state[i] == INDIRECT ? indirectly_lost
+                                                             : definitely_lost;
+        table_insert(into, block->ptr, block->size, block->stack);
+    }
+
+done:
+    destroy_index(&index, capacity);
+    release(roots.items, MAX_RANGES * sizeof(Range));
+    release(mappings.items, MAX_RANGES * sizeof(Range));
+    release(stacks, (size_t)workers_wanted * capacity * sizeof(uint32_t));
+    if (copies) release(copies, (size_t)workers_wanted * SCAN_CHUNK);
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    stats.seconds = (double)(finished.tv_sec - started.tv_sec) + (double)(finished.tv_nsec - started.tv_nsec) / 1e9;
+    return stats;
+}
@@ -0,0 +1,47 @@
+#ifndef LEAK_SCAN_H
+#define LEAK_SCAN_H
+
+#include <stddef.h>
+#include "allocation_table.h"
+
+// Conservative reachability scan over the tracked blocks, in the manner of
+// a mark phase. The roots are the writable segments (data and bss) and TLS
+// blocks of every loaded module, the registers of every thread, the calling
+// thread's stack and the stacks of the threads registered with the tracker.
+// Every
+// pointer-sized word in a root or in a reached block that falls inside a
+// tracked block marks that block reachable.
+//
+// Blocks are looked up in a sorted array with a bucket index on top, so a
+// word that is not a heap pointer is usually rejected by one range check,
+// and one that is needs a short binary search. Root ranges are cut into
+// chunks that a pool of threads marks in parallel.
+//
+// Blocks that are not reached are then split the way Valgrind does: a
+// block that no other lost block points to is definitely lost, and every
+// block reached only through it is indirectly lost.
+//
+// Other threads are not stopped. Each is sent SIGPWR, whose handler copies
+// its registers into the roots, and while any are running all memory is
+// read with process_vm_readv, so that a block freed and unmapped during
+// the scan is skipped rather than faulted on. A thread that does not take
+// the signal within 100 ms keeps its registers to itself; scanning the
+// whole of the other threads' stacks errs the other way. The program's own
+// SIGPWR handler is passed every signal the scan did not send, and is put
+// back once the last thread has answered.
+
+typedef struct {
+    size_t root_bytes;    // Bytes of roots scanned
+    int threads;          // Threads that took part in marking
+    double seconds;
+    int other_threads;    // Threads of the process besides the caller, -1 if unknown
+    int registers_saved;  // Of those, the ones whose registers were scanned
+    int skipped;          // Other threads ran and process_vm_readv was unavailable; nothing was classified
+} ScanStats;
+
+// Sort the blocks of a table into three initialized tables. threads is the
+// number of marking threads, including the caller.
+ScanStats scan_reachability(const AllocationTable *blocks, AllocationTable *definitely_lost,
+                            AllocationTable *indirectly_lost, AllocationTable *reachable, int threads);
+
+#endif // LEAK_SCAN_H
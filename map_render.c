@@ -0,0 +1,196 @@
+#include "map_render.h"
+#include "free_block_index.h"
+#include "metrics.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <inttypes.h>
+
+#define RENDER_BUFFER_SIZE (1 << 20)
+#define RENDER_MAX_LINE 256
+
+static void clear_dirty(MapRenderer *renderer) {
+    renderer->dirty_start = UINT64_MAX;
+    renderer->dirty_end = 0;
+    renderer->dirty_block = NO_BLOCK;
+}
+
+void renderer_init(MapRenderer *renderer, RenderMode mode, FILE *output) {
+    memset(renderer, 0, sizeof(*renderer));
+    renderer->mode = mode;
+    renderer->output = output;
+    renderer->capacity = RENDER_BUFFER_SIZE;
+    renderer->buffer = malloc(renderer->capacity);
+    if (!renderer->buffer) {
+        fprintf(stderr, "Memory allocation failed for render buffer.\n");
+        exit(1);
+    }
+    clear_dirty(renderer);
+}
+
+void renderer_destroy(MapRenderer *renderer) {
+    renderer_flush(renderer);
+    free(renderer->buffer);
+    renderer->buffer = NULL;
+}
+
+void renderer_flush(MapRenderer *renderer) {
+    if (renderer->used) {
+        fwrite(renderer->buffer, 1, renderer->used, renderer->output);
+        renderer->used = 0;
+    }
+    fflush(renderer->output);
+}
+
+static void append(MapRenderer *renderer, const char *format, ...) {
+    if (renderer->capacity - renderer->used < RENDER_MAX_LINE) {
+        fwrite(renderer->buffer, 1, renderer->used, renderer->output);
+        renderer->used = 0;
+    }
+    size_t available = renderer->capacity - renderer->used;
+    va_list arguments;
+    va_start(arguments, format);
+    int length = vsnprintf(renderer->buffer + renderer->used, available, format, arguments);
+    va_end(arguments);
+    if (length > 0) {
+        renderer->used += (size_t)length < available ? (size_t)length : available - 1;
+    }
+}
+
+static void append_row(MapRenderer *renderer, const MemoryList *memory, BlockId block) {
+    append(renderer, "║ %-5" PRIu64 " ║ %-7" PRIu64 " ║ %-14c ║ %-10s ║\n", memory->start_address[block],
+           memory->size[block], memory->block_status[block], block_process_code(memory, block));
+}
+
+static void append_table_top(MapRenderer *renderer) {
+    append(renderer, "╔═══════╦═════════╦════════════════╦════════════╗\n");
+    append(renderer, "║ Start ║   Size  ║ Block Status   ║ Process ID ║\n");
+    append(renderer, "╠═══════╬═════════╬════════════════╬════════════╣\n");
+}
+
+static void append_table_bottom(MapRenderer *renderer) {
+    append(renderer, "╚═══════╩═════════╩════════════════╩════════════╝\n");
+}
+
+static void render_summary(MapRenderer *renderer, const MemoryList *memory) {
+    uint64_t largest = largest_free_block(memory);
+    double fragmentation = memory->free_size ? 1.0 - (double)largest / (double)memory->free_size : 0.0;
+    append(renderer,
+           "Memory: %u blocks, %d allocated, %d free | free %" PRIu64 " of %" PRIu64
+           " | largest free %" PRIu64 " | fragmentation %.3f\n",
+           memory->block_count, memory->total_processes, memory->free_blocks, memory->free_size,
+           memory->total_size, largest, fragmentation);
+}
+
+static void render_full(MapRenderer *renderer, const MemoryList *memory) {
+    append(renderer, "\nMemory Map:\n");
+    append_table_top(renderer);
+    for (BlockId current = memory->head; current != NO_BLOCK; current = memory->next[current]) {
+        append_row(renderer, memory, current);
+    }
+    append_table_bottom(renderer);
+}
+
+// A block in the list at or just before dirty_start: the marked block if
+// it has not been merged away or moved past it since, otherwise the free
+// block found through the address index (fit strategies only), otherwise
+// the head
+static BlockId first_dirty_block(const MapRenderer *renderer, const MemoryList *memory) {
+    BlockId block = renderer->dirty_block;
+    if (block != NO_BLOCK && block < memory->used_ids && memory->block_status[block] != 'u' &&
+        memory->start_address[block] <= renderer->dirty_start) {
+        return block;
+    }
+    block = free_index_floor(memory, renderer->dirty_start);
+    return block != NO_BLOCK ? block : memory->head;
+}
+
+// Print only the rows that overlap the dirty range, starting the walk as
+// close to it as the marks allow
+static void render_changes(MapRenderer *renderer, const MemoryList *memory) {
+    if (renderer->dirty_start >= renderer->dirty_end) {
+        return;
+    }
+    append(renderer, "\nChanged Region [%" PRIu64 ", %" PRIu64 "):\n", renderer->dirty_start,
+           renderer->dirty_end);
+    append_table_top(renderer);
+    BlockId current = first_dirty_block(renderer, memory);
+    for (; current != NO_BLOCK; current = memory->next[current]) {
+        uint64_t start = memory->start_address[current];
+        if (start >= renderer->dirty_end) break;
+        if (start + memory->size[current] > renderer->dirty_start) {
+            append_row(renderer, memory, current);
+        }
+    }
+    append_table_bottom(renderer);
+}
+
+void renderer_mark_dirty(MapRenderer *renderer, uint64_t start, uint64_t size) {
+    if (start < renderer->dirty_start) {
+        renderer->dirty_start = start;
+        renderer->dirty_block = NO_BLOCK;
+    }
+    if (start + size > renderer->dirty_end) renderer->dirty_end = start + size;
+}
+
+void renderer_mark_block(MapRenderer *renderer, const MemoryList *memory, BlockId block) {
+    uint64_t start = memory->start_address[block];
+    renderer_mark_dirty(renderer, start, memory->size[block]);
+    if (renderer->dirty_start == start) {
+        renderer->dirty_block = block;
+    }
+}
+
+void renderer_render(MapRenderer *renderer, const MemoryList *memory) {
+    switch (renderer->mode) {
+        case RENDER_QUIET:
+            break;
+        case RENDER_SUMMARY:
+            render_summary(renderer, memory);
+            break;
+        case RENDER_CHANGES:
+            render_changes(renderer, memory);
+            break;
+        case RENDER_FULL:
+            render_full(renderer, memory);
+            break;
+    }
+    clear_dirty(renderer);
+    renderer->pending_events = 0;
+    renderer->renders++;
+}
+
+void renderer_event(MapRenderer *renderer, const MemoryList *memory) {
+    if (renderer->mode == RENDER_QUIET) {
+        return;
+    }
+    renderer->pending_events++;
+    if (renderer->every_events && renderer->pending_events < renderer->every_events) {
+        renderer->skipped++;
+        return;
+    }
+    if (renderer->every_seconds > 0) {
+        double now = metrics_now_seconds();
+        if (now - renderer->last_render < renderer->every_seconds) {
+            renderer->skipped++;
+            return;
+        }
+        renderer->last_render = now;
+    }
+    renderer_render(renderer, memory);
+}
+
+void renderer_finish(MapRenderer *renderer, const MemoryList *memory) {
+    if (renderer->mode != RENDER_QUIET && renderer->pending_events) {
+        renderer_render(renderer, memory);
+    }
+    renderer_flush(renderer);
+}
+
+int parse_render_mode(const char *name) {
+    const char *names[] = {"quiet", "summary", "changes", "full"};
+    for (int mode = RENDER_QUIET; mode <= RENDER_FULL; mode++) {
+        if (strcmp(name, names[mode]) == 0) return mode;
+    }
+    return -1;
+}
@@ -0,0 +1,53 @@
+#ifndef MAP_RENDER_H
+#define MAP_RENDER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "mem_allocate.h"
+
+// Buffered memory-map output. Rows are formatted into a large buffer that
+// is written with a single fwrite when full or flushed, and renders can be
+// throttled so long allocation runs do not reprint the whole map each time.
+
+typedef enum {
+    RENDER_QUIET,    // Print nothing
+    RENDER_SUMMARY,  // One line of totals per render
+    RENDER_CHANGES,  // Only the rows touched since the previous render
+    RENDER_FULL      // The whole map table
+} RenderMode;
+
+typedef struct {
+    RenderMode mode;
+    FILE *output;
+    char *buffer;
+    size_t used, capacity;
+    // Address range changed since the last render
+    uint64_t dirty_start, dirty_end;
+    BlockId dirty_block;  // Block that started at dirty_start when marked, NO_BLOCK if unknown
+    // Throttling: render at most once per every_events changes and once per
+    // every_seconds of wall time; 0 disables the respective limit
+    uint64_t every_events;
+    double every_seconds;
+    uint64_t pending_events;
+    double last_render;
+    uint64_t renders, skipped;
+} MapRenderer;
+
+void renderer_init(MapRenderer *renderer, RenderMode mode, FILE *output);
+void renderer_destroy(MapRenderer *renderer);
+// Note that [start, start + size) changed
+void renderer_mark_dirty(MapRenderer *renderer, uint64_t start, uint64_t size);
+// Note that a block changed; remembering it lets a changes render start
+// there instead of walking the map from its head
+void renderer_mark_block(MapRenderer *renderer, const MemoryList *memory, BlockId block);
+// Count one change and render if the throttle allows it
+void renderer_event(MapRenderer *renderer, const MemoryList *memory);
+// Render now regardless of throttling
+void renderer_render(MapRenderer *renderer, const MemoryList *memory);
+// Render anything still pending and write out the buffer
+void renderer_finish(MapRenderer *renderer, const MemoryList *memory);
+void renderer_flush(MapRenderer *renderer);
+// Parse "quiet", "summary", "changes" or "full"; returns -1 when unknown
+int parse_render_mode(const char *name);
+
+#endif // MAP_RENDER_H
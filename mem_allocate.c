@@ -1,30 +1,117 @@
 #include "mem_allocate.h"
+#include "free_block_index.h"
+#include "simulation.h"
+#include "trace_loader.h"
+#include "event_log.h"
+#include "map_render.h"
+#include "buddy_allocator.h"
+#include "compaction.h"
+#include "sweep_runner.h"
+#include "allocator_metrics.h"
+#include "size_parse.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <inttypes.h>
+#include <limits.h>
 
-// Initialize the memory list with the given total memory size
-void initialize_memory(MemoryList *memory, int total_memory_size) {
-    memory->head = NULL;
-    memory->total_processes = 0;
+// Grow every per-block array to hold capacity block ids
+static void reserve_blocks(MemoryList *memory, uint32_t capacity) {
+    void *arrays[] = {
+        realloc(memory->start_address, capacity * sizeof(uint64_t)),
+        realloc(memory->size, capacity * sizeof(uint64_t)),
+        realloc(memory->block_status, capacity * sizeof(char)),
+        realloc(memory->next, capacity * sizeof(BlockId)),
+        realloc(memory->previous, capacity * sizeof(BlockId)),
+        realloc(memory->process_id, capacity * sizeof(uint32_t)),
+    };
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+        if (!arrays[i]) {
+            fprintf(stderr, "Memory allocation failed for memory map.\n");
+            exit(1);
+        }
+    }
+    memory->start_address = arrays[0];
+    memory->size = arrays[1];
+    memory->block_status = arrays[2];
+    memory->next = arrays[3];
+    memory->previous = arrays[4];
+    memory->process_id = arrays[5];
+    free_index_reserve(memory, capacity);
+    memory->capacity = capacity;
+}
 
-    // Create a single memory block that represents the whole memory
-    MemoryBlock *block = (MemoryBlock *)malloc(sizeof(MemoryBlock));
-    if (block == NULL) {
-        fprintf(stderr, "Memory allocation failed for memory block.\n");
-        exit(1);
+// Take an unused block id, reusing released ones first
+BlockId new_block(MemoryList *memory) {
+    BlockId block = memory->recycled;
+    if (block != NO_BLOCK) {
+        memory->recycled = memory->next[block];
+    } else {
+        if (memory->used_ids == memory->capacity) {
+            reserve_blocks(memory, memory->capacity ? memory->capacity * 2 : 256);
+        }
+        block = memory->used_ids++;
     }
+    memory->block_count++;
+    return block;
+}
 
-    block->start_address = 0;
-    block->size = total_memory_size;
-    block->block_status = 'f';  // 'f' for Free
-    block->process_status = 'N';  // 'N' for None (no process allocated)
-    block->process_code[0] = '\0';  // No process code
-    block->next = NULL;
-    block->previous = NULL;
+// Initialize the memory list with the given total memory size
+void initialize_memory(MemoryList *memory, uint64_t total_memory_size) {
+    memset(memory, 0, sizeof(*memory));
+    memory->head = memory->recycled = NO_BLOCK;
+    memory->by_size.root = memory->by_address.root = NO_BLOCK;
+    memory->total_size = total_memory_size;
+    names_init(&memory->names);
+
+    // Create a single memory block that represents the whole memory
+    BlockId block = new_block(memory);
+    memory->start_address[block] = 0;
+    memory->size[block] = total_memory_size;
+    memory->block_status[block] = 'f';  // 'f' for Free
+    memory->process_id[block] = NO_PROCESS;  // No process allocated
+    memory->next[block] = NO_BLOCK;
+    memory->previous[block] = NO_BLOCK;
 
     // Set the memory list head to the created block
     memory->head = block;
+    free_index_insert(memory, block);
+}
+
+// Release the whole memory map at once
+void free_memory(MemoryList *memory) {
+    free(memory->start_address);
+    free(memory->size);
+    free(memory->block_status);
+    free(memory->next);
+    free(memory->previous);
+    free(memory->process_id);
+    free(memory->by_size.links);
+    free(memory->by_address.links);
+    if (memory->buddy) {
+        buddy_destroy(memory->buddy);
+    }
+    names_destroy(&memory->names);
+    memset(memory, 0, sizeof(*memory));
+    memory->head = memory->recycled = NO_BLOCK;
+    memory->by_size.root = memory->by_address.root = NO_BLOCK;
+}
+
+// Code of the process holding a block, "" for free blocks
+const char *block_process_code(const MemoryList *memory, BlockId block) {
+    return names_lookup(&memory->names, memory->process_id[block]);
+}
+
+// Report how much of the block arrays is in use
+void print_memory_usage(const MemoryList *memory) {
+    size_t bytes_per_block = 2 * sizeof(uint64_t) + sizeof(char) + 2 * sizeof(BlockId) +
+                             sizeof(uint32_t) + 2 * sizeof(FreeIndexLink);
+    printf("  %-14s %8u in use / %8u capacity (%5.1f%%), %u free, %zu B per block\n",
+           "Memory map", memory->block_count, memory->capacity,
+           memory->capacity ? 100.0 * memory->block_count / memory->capacity : 0.0,
+           (unsigned)memory->free_blocks, bytes_per_block);
+    printf("  %-14s %8u live codes / %8u ids\n", "Process names", memory->names.live,
+           memory->names.used_ids);
 }
 
 // Initialize the process list
@@ -33,123 +120,338 @@ void initialize_processes(ProcessList *process_list) {
     process_list->tail = NULL;
     process_list->total_to_allocate = 0;
     process_list->total_waiting = 0;
+    pool_init(&process_list->process_pool, "Process", sizeof(Process));
+}
+
+// Release every process of the list at once
+void free_processes(ProcessList *process_list) {
+    pool_destroy(&process_list->process_pool);
+    process_list->head = NULL;
+    process_list->tail = NULL;
+    process_list->total_to_allocate = 0;
+    process_list->total_waiting = 0;
+}
+
+// Size of the largest free block
+uint64_t largest_free_block(const MemoryList *memory) {
+    return memory->buddy ? buddy_largest_free(memory) : free_index_max_free(memory);
+}
+
+// Largest request that could ever be satisfied, even with all memory free
+uint64_t largest_possible_allocation(const MemoryList *memory) {
+    return memory->buddy ? memory->buddy->largest_block : memory->total_size;
 }
 
 // Function to check memory availability (added definition)
-int check_memory_availability(MemoryList *memory, int memory_required) {
-    MemoryBlock *current = memory->head;
-    while (current) {
-        if (current->block_status == 'f' && current->size >= memory_required) {
-            return 1;  // Memory is available
+int check_memory_availability(MemoryList *memory, uint64_t memory_required) {
+    return largest_free_block(memory) >= memory_required;
+}
+
+// Hand a block to a process
+void claim_block(MemoryList *memory, BlockId block, Process *process) {
+    memory->block_status[block] = 'a';  // 'a' for allocated
+    memory->process_id[block] = names_acquire(&memory->names, process->code);
+    memory->total_processes++;
+    process->block = block;
+}
+
+// Take a block back from its process
+void vacate_block(MemoryList *memory, BlockId block) {
+    memory->block_status[block] = 'f';
+    names_release(&memory->names, memory->process_id[block]);
+    memory->process_id[block] = NO_PROCESS;
+    memory->total_processes--;
+}
+
+// Take a free block out of the index and hand its first memory_required
+// units to the process, leaving any excess as a new free block after it
+static void assign_block(MemoryList *memory, BlockId block, Process *process) {
+    free_index_remove(memory, block);
+    if (memory->size[block] > process->memory_required) {
+        BlockId remainder = new_block(memory);
+        BlockId next = memory->next[block];
+        memory->start_address[remainder] = memory->start_address[block] + process->memory_required;
+        memory->size[remainder] = memory->size[block] - process->memory_required;
+        memory->block_status[remainder] = 'f';
+        memory->process_id[remainder] = NO_PROCESS;
+        memory->next[remainder] = next;
+        memory->previous[remainder] = block;
+        if (next != NO_BLOCK) {
+            memory->previous[next] = remainder;
         }
-        current = current->next;
+        memory->next[block] = remainder;
+        memory->size[block] = process->memory_required;
+        free_index_insert(memory, remainder);
+    }
+    claim_block(memory, block, process);
+}
+
+// Place a process with the First-Fit strategy without printing anything.
+// Returns the allocated block, or NO_BLOCK when no free block is large enough.
+BlockId allocate_first_fit(MemoryList *memory, Process *process) {
+    uint64_t started = memory->metrics ? metrics_now_ns() : 0;
+    uint32_t scanned;
+    BlockId first_fit = free_index_first_fit(memory, process->memory_required, &scanned);
+    if (first_fit != NO_BLOCK) {
+        assign_block(memory, first_fit, process);
+    }
+    if (memory->metrics) {
+        allocator_metrics_allocation(memory, started, scanned, first_fit);
+    }
+    return first_fit;
+}
+
+// Place a process with the Best-Fit strategy without printing anything
+BlockId allocate_best_fit(MemoryList *memory, Process *process) {
+    uint64_t started = memory->metrics ? metrics_now_ns() : 0;
+    uint32_t scanned;
+    BlockId best_fit = free_index_best_fit(memory, process->memory_required, &scanned);
+    if (best_fit != NO_BLOCK) {
+        assign_block(memory, best_fit, process);
+    }
+    if (memory->metrics) {
+        allocator_metrics_allocation(memory, started, scanned, best_fit);
     }
-    return 0;  // No suitable memory block found
+    return best_fit;
 }
 
 // Function to allocate memory using First-Fit strategy
-void implement_first_fit(MemoryList *memory, Process *process) {
-    MemoryBlock *current = memory->head;
-    while (current) {
-        if (current->block_status == 'f' && current->size >= process->memory_required) {
-            // Split block if excess memory is available
-            if (current->size > process->memory_required) {
-                MemoryBlock *new_block = malloc(sizeof(MemoryBlock));
-                if (!new_block) {
-                    printf("Error: Memory allocation failed!\n");
-                    return;
-                }
-                *new_block = (MemoryBlock){'f', '\0', "", current->start_address + process->memory_required,
-                                           current->size - process->memory_required, current->next, current};
-                if (current->next) {
-                    current->next->previous = new_block;
-                }
-                current->next = new_block;
-                current->size = process->memory_required;
-            }
-            // Assign process to current block
-            current->block_status = 'a';  // 'a' for allocated
-            strcpy(current->process_code, process->code);
-            memory->total_processes++;
-            printf("Process %s allocated at address %d\n", process->code, current->start_address);
-            return;
-        }
-        current = current->next;
+int implement_first_fit(MemoryList *memory, Process *process) {
+    BlockId first_fit = allocate_first_fit(memory, process);
+    if (first_fit == NO_BLOCK) {
+        printf("Error: No suitable block found for process %s\n", process->code);
+        return 0;
     }
-    printf("Error: No suitable block found for process %s\n", process->code);
+    printf("Process %s allocated at address %" PRIu64 "\n", process->code, memory->start_address[first_fit]);
+    return 1;
 }
 
 // Function to allocate memory using Best-Fit strategy
-void implement_best_fit(MemoryList *memory, Process *process) {
-    MemoryBlock *current = memory->head;
-    MemoryBlock *best_fit = NULL;
-    while (current) {
-        if (current->block_status == 'f' && current->size >= process->memory_required) {
-            if (!best_fit || current->size < best_fit->size) {
-                best_fit = current;
-            }
-        }
-        current = current->next;
-    }
-    if (best_fit) {
-        // Split the best fit block if necessary
-        if (best_fit->size > process->memory_required) {
-            MemoryBlock *new_block = malloc(sizeof(MemoryBlock));
-            if (!new_block) {
-                printf("Error: Memory allocation failed!\n");
-                return;
-            }
-            *new_block = (MemoryBlock){'f', '\0', "", best_fit->start_address + process->memory_required,
-                                       best_fit->size - process->memory_required, best_fit->next, best_fit};
-            if (best_fit->next) {
-                best_fit->next->previous = new_block;
-            }
-            best_fit->next = new_block;
-            best_fit->size = process->memory_required;
-        }
-        // Assign process to the best fit block
-        best_fit->block_status = 'a';  // 'a' for allocated
-        strcpy(best_fit->process_code, process->code);
-        printf("Process %s allocated at address %d\n", process->code, best_fit->start_address);
-    } else {
+int implement_best_fit(MemoryList *memory, Process *process) {
+    BlockId best_fit = allocate_best_fit(memory, process);
+    if (best_fit == NO_BLOCK) {
+        printf("Error: No suitable block found for process %s\n", process->code);
+        return 0;
+    }
+    printf("Process %s allocated at address %" PRIu64 "\n", process->code, memory->start_address[best_fit]);
+    return 1;
+}
+
+// Function to allocate memory using the buddy system
+int implement_buddy(MemoryList *memory, Process *process) {
+    BlockId buddy = allocate_buddy(memory, process);
+    if (buddy == NO_BLOCK) {
         printf("Error: No suitable block found for process %s\n", process->code);
+        return 0;
     }
+    printf("Process %s allocated at address %" PRIu64 " in a block of %" PRIu64 "\n", process->code,
+           memory->start_address[buddy], memory->size[buddy]);
+    return 1;
+}
+
+// Unlink a block that has been absorbed by its predecessor and recycle its id
+void unlink_block(MemoryList *memory, BlockId block) {
+    BlockId previous = memory->previous[block], next = memory->next[block];
+    memory->next[previous] = next;
+    if (next != NO_BLOCK) {
+        memory->previous[next] = previous;
+    }
+    memory->next[block] = memory->recycled;
+    memory->recycled = block;
+    memory->block_status[block] = 'u';
+    memory->block_count--;
+}
+
+// Mark a block free and merge it with free neighbours. The previous/next
+// links act as boundary tags, so merging touches at most three blocks no
+// matter how long the list is. Returns the resulting free block.
+BlockId release_block(MemoryList *memory, BlockId block) {
+    if (memory->buddy) {
+        return buddy_release(memory, block);
+    }
+    if (memory->block_status[block] != 'a') {
+        return block;
+    }
+    vacate_block(memory, block);
+
+    BlockId previous = memory->previous[block];
+    if (previous != NO_BLOCK && memory->block_status[previous] == 'f') {
+        free_index_remove(memory, previous);
+        memory->size[previous] += memory->size[block];
+        unlink_block(memory, block);
+        block = previous;
+    }
+    BlockId next = memory->next[block];
+    if (next != NO_BLOCK && memory->block_status[next] == 'f') {
+        free_index_remove(memory, next);
+        memory->size[block] += memory->size[next];
+        unlink_block(memory, next);
+    }
+    free_index_insert(memory, block);
+    return block;
+}
+
+// Release the memory of a process that has finished executing
+void complete_process(MemoryList *memory, Process *process) {
+    if (process->allocation_status != 'Y') {
+        return;
+    }
+    uint64_t started = memory->metrics ? metrics_now_ns() : 0;
+    release_block(memory, process->block);
+    if (memory->metrics) {
+        allocator_metrics_free(memory, started);
+    }
+    process->block = NO_BLOCK;
+    process->allocation_status = 'C';
+}
+
+// Complete every allocated process whose arrival_date + execution_time has
+// been reached by the given time
+void complete_processes_until(MemoryList *memory, ProcessList *process_list, int current_time) {
+    int completed = 0;
+    for (Process *current = process_list->head; current; current = current->next) {
+        if (current->allocation_status == 'Y' &&
+            current->arrival_date + current->execution_time <= current_time) {
+            complete_process(memory, current);
+            printf("Process %s completed, memory released\n", current->code);
+            completed++;
+        }
+    }
+    printf("%d process(es) completed by time %d\n", completed, current_time);
 }
 
 // Function to display the memory map
 void display_memory_map(const MemoryList *memory) {
-    MemoryBlock *current = memory->head;
-    printf("\nMemory Map:\n");
-    printf("╔═══════╦═════════╦════════════════╦════════════╗\n");
-    printf("║ Start ║   Size  ║ Block Status   ║ Process ID ║\n");
-    printf("╠═══════╬═════════╬════════════════╬════════════╣\n");
-    while (current) {
-        printf("║ %-5d ║ %-7d ║ %-14c ║ %-10s ║\n", current->start_address, current->size,
-               current->block_status, current->process_code);
-        current = current->next;
+    MapRenderer renderer;
+    renderer_init(&renderer, RENDER_FULL, stdout);
+    renderer_render(&renderer, memory);
+    renderer_destroy(&renderer);
+}
+
+// The interactive and command-line front end is left out when the
+// allocator is linked into another program (compiled with
+// -DMEM_ALLOCATE_NO_MAIN), such as allocator_benchmark.c
+#ifndef MEM_ALLOCATE_NO_MAIN
+
+// Ask for the render mode and throttling used while allocating
+static void configure_renderer(MapRenderer *renderer) {
+    int mode;
+    printf("Render Mode (0 = quiet, 1 = summary, 2 = changes, 3 = full): ");
+    scanf("%d", &mode);
+    if (mode >= RENDER_QUIET && mode <= RENDER_FULL) {
+        renderer->mode = (RenderMode)mode;
     }
-    printf("╚═══════╩═════════╩════════════════╩════════════╝\n");
+    printf("Render every N allocations (0 = every one): ");
+    scanf("%" SCNu64, &renderer->every_events);
+    printf("Minimum seconds between renders (0 = no limit): ");
+    scanf("%lf", &renderer->every_seconds);
 }
 
-// Function to add a new process interactively
-void add_process_interactively(ProcessList *process_list) {
-    Process *new_process = malloc(sizeof(Process));
-    if (!new_process) {
-        printf("Error: Memory allocation failed for new process!\n");
+// The fit strategies and the buddy system keep different free-block
+// structures, so switching between them rebuilds the empty memory map
+static int select_allocator(MemoryList *memory, int buddy) {
+    if ((memory->buddy != NULL) == buddy) {
+        return 1;
+    }
+    if (memory->total_processes) {
+        printf("Error: complete all processes before switching to %s allocation\n",
+               buddy ? "buddy" : "fit");
+        return 0;
+    }
+    if (buddy) {
+        buddy_enable(memory);
+    } else {
+        uint64_t total_size = memory->total_size;
+        free_memory(memory);
+        initialize_memory(memory, total_size);
+    }
+    return 1;
+}
+
+// Allocate every process that has not been placed yet with one strategy
+static void allocate_pending(MemoryList *memory, ProcessList *process_list, MapRenderer *renderer,
+                             const CompactionPolicy *compaction, int (*implement)(MemoryList *, Process *)) {
+    if (!select_allocator(memory, implement == implement_buddy)) {
         return;
     }
+    for (Process *current = process_list->head; current; current = current->next) {
+        if (current->allocation_status != 'N') {
+            continue;
+        }
+        int allocated = implement(memory, current);
+        if (!allocated) {
+            CompactionStats stats = {0};
+            if (compact_for_request(memory, compaction, current->memory_required, &stats)) {
+                printf("Compacted memory: %" PRIu64 " unit(s) moved in %" PRIu64 " block(s)\n",
+                       stats.bytes_moved, stats.blocks_moved);
+                renderer_mark_dirty(renderer, stats.low, stats.high - stats.low);
+                allocated = implement(memory, current);
+            }
+        }
+        if (allocated) {
+            current->allocation_status = 'Y';
+            // Show the affected part of the memory map after allocation
+            renderer_mark_block(renderer, memory, current->block);
+            renderer_event(renderer, memory);
+            renderer_flush(renderer);
+        }
+    }
+    renderer_finish(renderer, memory);
+}
+
+// Compact the memory map once and keep the mode for later allocations
+static void compact_interactively(MemoryList *memory, CompactionPolicy *compaction, MapRenderer *renderer) {
+    int mode;
+    uint64_t memory_required = 0;
+    CompactionStats stats = {0};
+    if (memory->buddy) {
+        printf("Error: buddy blocks cannot be relocated\n");
+        return;
+    }
+    printf("Compaction Mode (0 = none, 1 = full, 2 = targeted, 3 = incremental): ");
+    scanf("%d", &mode);
+    if (mode < COMPACT_NONE || mode > COMPACT_INCREMENTAL) {
+        printf("Invalid mode!\n");
+        return;
+    }
+    compaction->mode = (CompactionMode)mode;
+    if (mode == COMPACT_TARGETED) {
+        printf("Free Block Size Needed: ");
+        scanf("%" SCNu64, &memory_required);
+        compact_targeted(memory, memory_required, &stats);
+    } else if (mode == COMPACT_INCREMENTAL) {
+        printf("Units to Move per Step: ");
+        scanf("%" SCNu64, &compaction->budget);
+        compact_incremental(memory, compaction->budget, &stats);
+    } else if (mode == COMPACT_FULL) {
+        compact_full(memory, &stats);
+    }
+    if (stats.passes) {
+        print_compaction_stats(&stats);
+        if (stats.bytes_moved) {
+            renderer_mark_dirty(renderer, stats.low, stats.high - stats.low);
+            renderer_render(renderer, memory);
+            renderer_flush(renderer);
+        }
+    }
+}
+
+// Function to add a new process interactively
+void add_process_interactively(ProcessList *process_list) {
+    Process *new_process = pool_alloc(&process_list->process_pool);
     printf("\nEnter Process Details:\n");
     printf("Process Code: ");
     scanf("%s", new_process->code);
     printf("Arrival Time: ");
     scanf("%d", &new_process->arrival_date);
     printf("Memory Required: ");
-    scanf("%d", &new_process->memory_required);
+    scanf("%" SCNu64, &new_process->memory_required);
     printf("Execution Time: ");
     scanf("%d", &new_process->execution_time);
 
     new_process->allocation_status = 'N';
     new_process->waiting_status = 'N';
+    new_process->block = NO_BLOCK;
     new_process->next = NULL;
     new_process->previous = process_list->tail;
 
@@ -173,18 +475,284 @@ void menu() {
     printf("║ 2. Add a New Process         ║\n");
     printf("║ 3. Allocate Memory (First-Fit)║\n");
     printf("║ 4. Allocate Memory (Best-Fit)║\n");
-    printf("║ 5. Exit                      ║\n");
+    printf("║ 5. Complete Processes        ║\n");
+    printf("║ 6. Run Simulation            ║\n");
+    printf("║ 7. Show Simulation Log       ║\n");
+    printf("║ 8. Load Processes from File  ║\n");
+    printf("║ 9. Show Pool Usage           ║\n");
+    printf("║10. Rendering Options         ║\n");
+    printf("║11. Allocate Memory (Buddy)   ║\n");
+    printf("║12. Compact Memory            ║\n");
+    printf("║ 0. Exit                      ║\n");
     printf("╚══════════════════════════════╝\n");
     printf("Enter your choice: ");
 }
 
-int main() {
+static void print_usage(const char *program) {
+    printf("Usage: %s                       interactive menu\n", program);
+    printf("       %s --trace FILE [--strategy first|best|buddy] [--memory SIZE[K|M|G|T]]\n", program);
+    printf("       %*s [--log] [--log-spill FILE] [--export-log CSV_FILE]\n", (int)strlen(program), "");
+    printf("       %*s [--render quiet|summary|changes|full] [--render-every N] [--render-interval SECONDS]\n",
+           (int)strlen(program), "");
+    printf("       %*s [--compact none|full|targeted|incremental] [--compact-budget SIZE]\n",
+           (int)strlen(program), "");
+    printf("       %*s [--metrics FILE] [--metrics-every N]\n", (int)strlen(program), "");
+    printf("       %s --sweep FILE [--strategies LIST] [--memory-sizes LIST] [--page-sizes LIST]\n", program);
+    printf("       %*s [--threads N] [--format csv|json] [--output FILE] [--compact MODE] [--compact-budget SIZE]\n",
+           (int)strlen(program), "");
+    printf("       %s --validate FILE\n", program);
+    printf("       %s --convert TEXT_FILE BINARY_FILE\n", program);
+}
+
+// Parse a comma-separated list of sizes into a new array, NULL when any is invalid
+static uint64_t *parse_size_list(const char *text, size_t *count) {
+    size_t capacity = 1;
+    for (const char *p = text; *p; p++) capacity += *p == ',';
+    uint64_t *sizes = malloc(capacity * sizeof(uint64_t));
+    char *copy = strdup(text);
+    if (!sizes || !copy) {
+        fprintf(stderr, "Memory allocation failed for sweep grid.\n");
+        exit(1);
+    }
+    *count = 0;
+    for (char *item = strtok(copy, ","); item; item = strtok(NULL, ",")) {
+        if ((sizes[(*count)++] = parse_size(item)) == 0) {
+            free(sizes);
+            sizes = NULL;
+            break;
+        }
+    }
+    free(copy);
+    if (*count == 0) {
+        free(sizes);
+        sizes = NULL;
+    }
+    return sizes;
+}
+
+// Parse a comma-separated list of strategy names, 0 when any is unknown
+static size_t parse_strategy_list(const char *text, PlacementStrategy *strategies) {
+    char *copy = strdup(text);
+    if (!copy) {
+        fprintf(stderr, "Memory allocation failed for sweep grid.\n");
+        exit(1);
+    }
+    size_t count = 0;
+    for (char *item = strtok(copy, ","); item; item = strtok(NULL, ",")) {
+        int strategy = parse_strategy(item);
+        if (count == SWEEP_MAX_STRATEGIES || strategy < 0) {
+            count = 0;
+            break;
+        }
+        strategies[count++] = (PlacementStrategy)strategy;
+    }
+    free(copy);
+    return count;
+}
+
+// Sweep mode: replay a trace under a grid of configurations in parallel and
+// print one table row per configuration
+static int run_sweep(int argc, char *argv[]) {
+    static const uint64_t default_memory_sizes[] = {1024}, default_page_sizes[] = {1};
+    SweepConfig config = {NULL, {STRATEGY_FIRST_FIT, STRATEGY_BEST_FIT, STRATEGY_BUDDY}, 3,
+                          default_memory_sizes, 1, default_page_sizes, 1, {COMPACT_NONE, 4096}, 0};
+    uint64_t *memory_sizes = NULL, *page_sizes = NULL;
+    const char *output_file = NULL;
+    int json = 0, valid = 1;
+
+    for (int i = 1; i < argc && valid; i++) {
+        if (strcmp(argv[i], "--sweep") == 0 && i + 1 < argc) {
+            config.trace = argv[++i];
+        } else if (strcmp(argv[i], "--strategies") == 0 && i + 1 < argc) {
+            config.strategy_count = parse_strategy_list(argv[++i], config.strategies);
+            valid = config.strategy_count > 0;
+        } else if (strcmp(argv[i], "--memory-sizes") == 0 && i + 1 < argc && !memory_sizes) {
+            memory_sizes = parse_size_list(argv[++i], &config.memory_count);
+            config.memory_sizes = memory_sizes;
+            valid = memory_sizes != NULL;
+        } else if (strcmp(argv[i], "--page-sizes") == 0 && i + 1 < argc && !page_sizes) {
+            page_sizes = parse_size_list(argv[++i], &config.page_count);
+            config.page_sizes = page_sizes;
+            valid = page_sizes != NULL;
+            // Rounding slack is kept in 32 bits per process
+            for (size_t p = 0; valid && p < config.page_count; p++) valid = page_sizes[p] <= (1ull << 32);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            uint64_t threads;
+            valid = parse_number(argv[++i], &threads) == 0 && threads <= INT_MAX;
+            config.threads = (int)threads;
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            i++;
+            json = strcmp(argv[i], "json") == 0;
+            valid = json || strcmp(argv[i], "csv") == 0;
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_file = argv[++i];
+        } else if (strcmp(argv[i], "--compact") == 0 && i + 1 < argc && parse_compaction_mode(argv[i + 1]) >= 0) {
+            config.compaction.mode = (CompactionMode)parse_compaction_mode(argv[++i]);
+        } else if (strcmp(argv[i], "--compact-budget") == 0 && i + 1 < argc) {
+            config.compaction.budget = parse_size(argv[++i]);
+        } else {
+            valid = 0;
+        }
+    }
+
+    int status = 1;
+    TraceReader reader;
+    if (!valid || !config.trace) {
+        print_usage(argv[0]);
+    } else if (trace_open(&reader, config.trace) == 0) {
+        // Checked once here rather than failing every point
+        trace_close(&reader);
+        FILE *output = output_file ? fopen(output_file, "w") : stdout;
+        size_t count = sweep_point_count(&config);
+        SweepResult *results = malloc(count * sizeof(SweepResult));
+        if (!output) {
+            perror(output_file);
+        } else if (!results) {
+            fprintf(stderr, "Memory allocation failed for sweep results.\n");
+        } else {
+            size_t failed = sweep_run(&config, results);
+            if (json) {
+                sweep_write_json(output, results, count);
+            } else {
+                sweep_write_csv(output, results, count);
+            }
+            status = failed == 0 && !ferror(output) ? 0 : 1;
+        }
+        if (output && output != stdout && fclose(output) != 0) status = 1;
+        free(results);
+    }
+    free(memory_sizes);
+    free(page_sizes);
+    return status;
+}
+
+// Non-interactive mode: replay a trace file and print the summary
+static int run_batch(int argc, char *argv[]) {
+    const char *trace = NULL;
+    PlacementStrategy strategy = STRATEGY_FIRST_FIT;
+    const char *spill_file = NULL, *export_file = NULL, *metrics_file = NULL;
+    uint64_t memory_size = 1024, metrics_every = 1000;
+    int print_log = 0;
+    MapRenderer renderer;
+    renderer_init(&renderer, RENDER_QUIET, stdout);
+    CompactionPolicy compaction = {COMPACT_NONE, 4096};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace = argv[++i];
+        } else if (strcmp(argv[i], "--strategy") == 0 && i + 1 < argc && parse_strategy(argv[i + 1]) >= 0) {
+            strategy = (PlacementStrategy)parse_strategy(argv[++i]);
+        } else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc) {
+            memory_size = parse_size(argv[++i]);
+        } else if (strcmp(argv[i], "--log") == 0) {
+            print_log = 1;
+        } else if (strcmp(argv[i], "--log-spill") == 0 && i + 1 < argc) {
+            spill_file = argv[++i];
+        } else if (strcmp(argv[i], "--export-log") == 0 && i + 1 < argc) {
+            export_file = argv[++i];
+        } else if (strcmp(argv[i], "--render") == 0 && i + 1 < argc && parse_render_mode(argv[i + 1]) >= 0) {
+            renderer.mode = (RenderMode)parse_render_mode(argv[++i]);
+        } else if (strcmp(argv[i], "--render-every") == 0 && i + 1 < argc &&
+                   parse_number(argv[i + 1], &renderer.every_events) == 0) {
+            i++;
+        } else if (strcmp(argv[i], "--render-interval") == 0 && i + 1 < argc) {
+            renderer.every_seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--compact") == 0 && i + 1 < argc && parse_compaction_mode(argv[i + 1]) >= 0) {
+            compaction.mode = (CompactionMode)parse_compaction_mode(argv[++i]);
+        } else if (strcmp(argv[i], "--compact-budget") == 0 && i + 1 < argc) {
+            compaction.budget = parse_size(argv[++i]);
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics_file = argv[++i];
+        } else if (strcmp(argv[i], "--metrics-every") == 0 && i + 1 < argc &&
+                   parse_number(argv[i + 1], &metrics_every) == 0) {
+            i++;
+        } else if (strcmp(argv[i], "--validate") == 0 && i + 1 < argc) {
+            int valid = validate_file_format(argv[++i]);
+            printf("%s: %s\n", argv[i], valid ? "valid" : "invalid");
+            return valid ? 0 : 1;
+        } else if (strcmp(argv[i], "--convert") == 0 && i + 2 < argc) {
+            return convert_trace(argv[i + 1], argv[i + 2]) == 0 ? 0 : 1;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!trace || memory_size == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    MemoryList memory;
+    EventLog log;
+    SimulationStats stats;
+    AllocatorMetrics metrics;
+    FILE *metrics_output = NULL;
+    if (metrics_file && !(metrics_output = fopen(metrics_file, "w"))) {
+        perror(metrics_file);
+        return 1;
+    }
+    int logging = print_log || spill_file || export_file;
+    if (logging && event_log_init(&log, EVENT_LOG_DEFAULT_CAPACITY, spill_file) < 0) {
+        if (metrics_output) fclose(metrics_output);
+        return 1;
+    }
+    initialize_memory(&memory, memory_size);
+    if (strategy == STRATEGY_BUDDY) {
+        buddy_enable(&memory);
+    }
+    if (metrics_output) {
+        allocator_metrics_init(&metrics, metrics_output, metrics_every);
+        memory.metrics = &metrics;
+    }
+    int status = simulate_trace(&memory, trace, strategy, logging ? &log : NULL, &renderer, &compaction, &stats);
+    renderer_destroy(&renderer);
+    if (print_log) {
+        print_comments(&log);
+    }
+    if (export_file && event_log_export_csv(&log, export_file) < 0) {
+        status = -1;
+    }
+    print_simulation_stats(&stats);
+    if (metrics_output) {
+        // The final state, whatever the snapshot interval
+        allocator_metrics_snapshot(&memory);
+        print_allocator_metrics(&metrics);
+        if (fclose(metrics_output) != 0) {
+            perror(metrics_file);
+            status = -1;
+        }
+    }
+    print_memory_usage(&memory);
+    if (memory.buddy) {
+        print_buddy_usage(&memory);
+    }
+    if (logging) {
+        print_event_log_usage(&log);
+        event_log_destroy(&log);
+    }
+    free_memory(&memory);
+    return status == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--sweep") == 0) {
+        return run_sweep(argc, argv);
+    }
+    if (argc > 1) {
+        return run_batch(argc, argv);
+    }
+
     MemoryList memory;
     ProcessList process_list;
+    EventLog log;
+    MapRenderer renderer;
+    CompactionPolicy compaction = {COMPACT_NONE, 4096};
 
     // Initialize structures
     initialize_memory(&memory, 1024); // Total memory size = 1024
     initialize_processes(&process_list);
+    event_log_init(&log, EVENT_LOG_DEFAULT_CAPACITY, NULL);
+    renderer_init(&renderer, RENDER_CHANGES, stdout);
 
     int choice;
     do {
@@ -197,37 +765,76 @@ int main() {
             case 2:
                 add_process_interactively(&process_list);
                 break;
-            case 3: {
-                Process *current = process_list.head;
-                while (current) {
-                    if (current->allocation_status == 'N') {
-                        implement_first_fit(&memory, current);
-                        current->allocation_status = 'Y';
-                        display_memory_map(&memory); // Show memory map after allocation
-                    }
-                    current = current->next;
-                }
+            case 3:
+                allocate_pending(&memory, &process_list, &renderer, &compaction, implement_first_fit);
+                break;
+            case 4:
+                allocate_pending(&memory, &process_list, &renderer, &compaction, implement_best_fit);
+                break;
+            case 5: {
+                int current_time;
+                printf("Current Time: ");
+                scanf("%d", &current_time);
+                complete_processes_until(&memory, &process_list, current_time);
                 break;
             }
-            case 4: {
-                Process *current = process_list.head;
-                while (current) {
-                    if (current->allocation_status == 'N') {
-                        implement_best_fit(&memory, current);
-                        current->allocation_status = 'Y';
-                        display_memory_map(&memory); // Show memory map after allocation
-                    }
-                    current = current->next;
+            case 6: {
+                int strategy;
+                SimulationStats stats;
+                printf("Strategy (1 = First-Fit, 2 = Best-Fit, 3 = Buddy): ");
+                scanf("%d", &strategy);
+                if (!select_allocator(&memory, strategy == 3)) {
+                    break;
                 }
+                run_simulation(&memory, &process_list,
+                               strategy == 3   ? STRATEGY_BUDDY
+                               : strategy == 2 ? STRATEGY_BEST_FIT
+                                               : STRATEGY_FIRST_FIT,
+                               &log, &compaction, &stats);
+                print_simulation_stats(&stats);
                 break;
             }
-            case 5:
+            case 7:
+                print_comments(&log);
+                break;
+            case 8: {
+                char filename[256];
+                printf("Trace File: ");
+                scanf("%255s", filename);
+                load_processes_from_file(&process_list, filename);
+                break;
+            }
+            case 9:
+                printf("\nPool Usage:\n");
+                print_memory_usage(&memory);
+                if (memory.buddy) {
+                    print_buddy_usage(&memory);
+                }
+                print_pool_stats(&process_list.process_pool);
+                print_event_log_usage(&log);
+                break;
+            case 10:
+                configure_renderer(&renderer);
+                break;
+            case 11:
+                allocate_pending(&memory, &process_list, &renderer, &compaction, implement_buddy);
+                break;
+            case 12:
+                compact_interactively(&memory, &compaction, &renderer);
+                break;
+            case 0:
                 printf("Exiting program.\n");
+                renderer_destroy(&renderer);
+                event_log_destroy(&log);
+                free_processes(&process_list);
+                free_memory(&memory);
                 break;
             default:
                 printf("Invalid choice! Please try again.\n");
         }
-    } while (choice != 5);
+    } while (choice != 0);
 
     return 0;
 }
+
+#endif // MEM_ALLOCATE_NO_MAIN
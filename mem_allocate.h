@@ -2,53 +2,96 @@
 #define MEM_ALLOCATE_H
 
 #include <stdio.h>
+#include <stdint.h>
+#include "node_pool.h"
+#include "process_names.h"
 
 // Structures
-typedef struct MemoryBlock {
-    char block_status, process_status;
-    char process_code[10];
-    int start_address, size;
-    struct MemoryBlock *next, *previous;
-} MemoryBlock;
 
+// Blocks are identified by their index into the MemoryList arrays
+typedef uint32_t BlockId;
+#define NO_BLOCK ((BlockId)UINT32_MAX)
+
+// Node of one free-block index tree. The fields used together during a
+// descent share a cache line; they are only meaningful for free blocks.
+typedef struct {
+    uint64_t max_free;  // Largest free size in the subtree (address tree only)
+    BlockId left, right;
+    uint32_t height;    // AVL height
+} FreeIndexLink;
+
+typedef struct {
+    BlockId root;
+    FreeIndexLink *links;  // Indexed by BlockId
+} FreeIndexTree;
+
+struct BuddyAllocator;
+struct AllocatorMetrics;
+
+// The memory map is stored as parallel arrays so that walking the list or
+// searching the index only touches the fields it needs. Unused ids are
+// recycled through next[].
 typedef struct {
-    MemoryBlock *head;
+    // Hot fields
+    uint64_t *start_address, *size;
+    char *block_status;     // 'f' for free, 'a' for allocated, 'u' for ids waiting to be reused
+    BlockId *next, *previous;
+    // Cold fields
+    uint32_t *process_id;   // Interned owner, NO_PROCESS for free blocks
+    BlockId head, recycled;
+    uint32_t block_count, used_ids, capacity;
+    FreeIndexTree by_size;     // Free blocks ordered by (size, start_address)
+    FreeIndexTree by_address;  // Free blocks ordered by start_address
+    int free_blocks;
+    uint64_t free_size;        // Sum of the sizes of all free blocks
     int total_processes;
+    uint64_t total_size;
+    ProcessNames names;
+    struct BuddyAllocator *buddy;  // Non-NULL when blocks are managed by the buddy allocator
+    struct AllocatorMetrics *metrics;  // Non-NULL while operations are instrumented
 } MemoryList;
 
 typedef struct Process {
     char code[10];
-    char allocation_status, waiting_status;
-    int arrival_date, execution_time, memory_required;
+    char allocation_status, waiting_status;  // allocation_status: 'N' none, 'Y' allocated, 'C' completed
+    int arrival_date, execution_time;
+    uint64_t memory_required;
+    BlockId block;  // Block holding the process while allocation_status == 'Y'
+    uint32_t page_slack;  // Units memory_required was rounded up by, when simulated in pages
     struct Process *next, *previous;
 } Process;
 
 typedef struct {
     Process *head, *tail;
     int total_to_allocate, total_waiting;
+    NodePool process_pool;
 } ProcessList;
 
-typedef struct CommentNode {
-    char new_process[400], waiting_process[400], completed_process[400];
-    char selected_process[400], ready_process[400];
-    int timestamp;
-    struct CommentNode *next;
-} CommentNode;
-
-typedef struct {
-    CommentNode *head;
-} CommentList;
-
 // Function Prototypes
-void initialize_memory(MemoryList *memory, int total_memory_size);
-void initialize_comments(CommentList *comments);
+void initialize_memory(MemoryList *memory, uint64_t total_memory_size);
 void initialize_processes(ProcessList *process_list);
+void free_memory(MemoryList *memory);
+void free_processes(ProcessList *process_list);
 void set_console_cursor(int x, int y);
 int validate_file_format(const char *filename);
-void add_comment(CommentList *comments, int timestamp, const char *message, int type);
 void print_process_header(void);
 void load_processes_from_file(ProcessList *process_list, const char *filename);
-void print_comments(const CommentList *comments);
 void display_processes(const ProcessList *process_list);
+BlockId allocate_first_fit(MemoryList *memory, Process *process);
+BlockId allocate_best_fit(MemoryList *memory, Process *process);
+BlockId allocate_buddy(MemoryList *memory, Process *process);
+int check_memory_availability(MemoryList *memory, uint64_t memory_required);
+uint64_t largest_free_block(const MemoryList *memory);
+uint64_t largest_possible_allocation(const MemoryList *memory);
+BlockId release_block(MemoryList *memory, BlockId block);
+const char *block_process_code(const MemoryList *memory, BlockId block);
+void print_memory_usage(const MemoryList *memory);
+void complete_process(MemoryList *memory, Process *process);
+
+// Block storage shared by the placement strategies
+BlockId new_block(MemoryList *memory);
+void unlink_block(MemoryList *memory, BlockId block);
+void claim_block(MemoryList *memory, BlockId block, Process *process);
+void vacate_block(MemoryList *memory, BlockId block);
 
 #endif // MEM_ALLOCATE_H
@@ -1,51 +1,166 @@
 #include "mem_leak_detector.h"
+#include "stack_depot.h"
+#include "heap_sampler.h"
+#include "heap_snapshot.h"
+#include <errno.h>
+#include <string.h>
 
-// Global pointer to track allocated memory
-MemoryBlock *allocated_memory = NULL;
+// Table of every allocated block that has not been freed yet
+AllocationTable allocated_memory;
 
-// Function to add a memory block to the tracking list
+// Function to add a memory block to the tracking table, recording the
+// call stack that allocated it
 void add_to_tracked_memory(void *ptr, size_t size) {
-    MemoryBlock *new_block = (MemoryBlock *)malloc(sizeof(MemoryBlock));
-    if (!new_block) {
-        printf("Error: Unable to allocate memory for tracking.\n");
-        return;
+    table_insert(&allocated_memory, ptr, size, depot_capture(__builtin_frame_address(0)));
+}
+
+// Function to free a single tracked block. Returns 0 if the address is not tracked.
+int free_tracked_block(void *ptr) {
+    if (!table_remove(&allocated_memory, ptr, NULL)) {
+        return 0;
     }
-    new_block->ptr = ptr;
-    new_block->size = size;
-    new_block->next = allocated_memory;
-    allocated_memory = new_block;
+    free(ptr);
+    return 1;
+}
+
+static void free_block(const MemoryBlock *block, void *context) {
+    (void)context;
+    free(block->ptr); // Free allocated memory
 }
 
 // Function to free all tracked memory blocks
 void free_tracked_memory() {
-    MemoryBlock *current = allocated_memory;
-    while (current) {
-        free(current->ptr); // Free allocated memory
-        MemoryBlock *temp = current;
-        current = current->next;
-        free(temp); // Free tracking node
+    table_for_each(&allocated_memory, free_block, NULL);
+    table_destroy(&allocated_memory);
+    table_init(&allocated_memory);
+}
+
+static void print_block(const MemoryBlock *block, void *context) {
+    fprintf(context, "%p\t%-12zu\t%u\n", block->ptr, block->size, block->stack);
+}
+
+// Leaked blocks grouped by the stack that allocated them. Under sampling
+// bytes and count are estimates, each recorded block weighted by how many
+// allocations of its size it stands for.
+typedef struct {
+    uint32_t stack;
+    double bytes, count;
+    size_t recorded;
+} LeakSite;
+
+static void add_to_site(const MemoryBlock *block, void *context) {
+    LeakSite *site = (LeakSite *)context + block->stack;
+    double weight = sample_weight(block->size);
+    site->stack = block->stack;
+    site->bytes += weight * (double)block->size;
+    site->count += weight;
+    site->recorded++;
+}
+
+// Largest leaked byte total first, then most blocks
+static int compare_sites(const void *a, const void *b) {
+    const LeakSite *first = a, *second = b;
+    if (first->bytes != second->bytes) return first->bytes < second->bytes ? 1 : -1;
+    if (first->count != second->count) return first->count < second->count ? 1 : -1;
+    return 0;
+}
+
+static void report_sites(FILE *output, const AllocationTable *table, const char *title) {
+    size_t site_count = (size_t)depot_size() + 1;  // Ids index the array directly; 0 is "no stack"
+    LeakSite *sites = calloc(site_count, sizeof(LeakSite));
+    if (!sites) {
+        fprintf(output, "(not enough memory to group leaks by site)\n");
+        return;
+    }
+    table_for_each(table, add_to_site, sites);
+    qsort(sites, site_count, sizeof(LeakSite), compare_sites);
+    double total_bytes = 0, total_count = 0;
+    for (size_t i = 0; i < site_count; i++) {
+        total_bytes += sites[i].bytes;
+        total_count += sites[i].count;
     }
-    allocated_memory = NULL;
+
+    if (sampler_interval) {
+        fprintf(output, "Sampled one allocation per %zu bytes on average: an estimated %.0f bytes in %.0f block(s) "
+                "still allocated\n", sampler_interval, total_bytes, total_count);
+    }
+    fprintf(output, "\n--- %s by Allocation Site ---\n", title);
+    for (size_t i = 0; i < site_count && sites[i].recorded; i++) {
+        double share = total_bytes > 0 ? 100.0 * sites[i].bytes / total_bytes : 0.0;
+        if (sampler_interval) {
+            fprintf(output, "#%zu: ~%.0f bytes in ~%.0f block(s) (%.1f%% of leaked bytes), %zu sampled, stack %u\n",
+                    i + 1, sites[i].bytes, sites[i].count, share, sites[i].recorded, sites[i].stack);
+        } else {
+            fprintf(output, "#%zu: %.0f bytes in %zu block(s) (%.1f%% of leaked bytes), stack %u\n", i + 1,
+                    sites[i].bytes, sites[i].recorded, share, sites[i].stack);
+        }
+        depot_print(output, sites[i].stack);
+    }
+    free(sites);
 }
 
-// Function to display memory leaks in the console
-void display_memory_leaks() {
-    MemoryBlock *current = allocated_memory;
-    if (!current) {
-        printf("\nNo memory leaks detected. All memory has been freed.\n");
+// Function to write the memory leak report to a stream. Every leaked block
+// is listed only when list_blocks is set; the per-site summary always is.
+void report_memory_leaks(FILE *output, int list_blocks) {
+    if (allocated_memory.live_count == 0) {
+        fprintf(output, "\nNo memory leaks detected. All memory has been freed.\n");
+        return;
+    }
+    fprintf(output, "\n--- Memory Leaks Detected ---\n");
+    if (list_blocks) {
+        fprintf(output, "Address\t\tSize (Bytes)\tStack\n");
+        fprintf(output, "----------------------------\n");
+        table_for_each(&allocated_memory, print_block, output);
+        fprintf(output, "----------------------------\n");
+    }
+    fprintf(output, "%zu block(s), %zu bytes %s\n", allocated_memory.live_count, allocated_memory.live_bytes,
+            sampler_interval ? "recorded" : "still allocated");
+    report_sites(output, &allocated_memory, "Leaks");
+    fprintf(output, "Please ensure all allocated memory is properly freed.\n");
+}
+
+// Function to write the leak report once a reachability scan has sorted
+// the blocks. Reachable blocks are still referenced and only summarized.
+void report_classified_leaks(FILE *output, const AllocationTable *definitely_lost,
+                             const AllocationTable *indirectly_lost, const AllocationTable *reachable) {
+    if (definitely_lost->live_count == 0 && indirectly_lost->live_count == 0) {
+        fprintf(output, "\nNo memory leaks detected. %zu block(s), %zu bytes still reachable.\n",
+                reachable->live_count, reachable->live_bytes);
         return;
     }
-    printf("\n--- Memory Leaks Detected ---\n");
-    printf("Address\t\tSize (Bytes)\n");
-    printf("----------------------------\n");
-    while (current) {
-        printf("%p\t%zu\n", current->ptr, current->size);
-        current = current->next;
+    fprintf(output, "\n--- Memory Leaks Detected ---\n");
+    fprintf(output, "Definitely lost : %zu block(s), %zu bytes\n", definitely_lost->live_count,
+            definitely_lost->live_bytes);
+    fprintf(output, "Indirectly lost : %zu block(s), %zu bytes\n", indirectly_lost->live_count,
+            indirectly_lost->live_bytes);
+    fprintf(output, "Still reachable : %zu block(s), %zu bytes\n", reachable->live_count, reachable->live_bytes);
+    if (definitely_lost->live_count) {
+        report_sites(output, definitely_lost, "Definitely Lost");
     }
-    printf("----------------------------\n");
-    printf("Please ensure all allocated memory is properly freed.\n");
+    if (indirectly_lost->live_count) {
+        report_sites(output, indirectly_lost, "Indirectly Lost");
+    }
+    fprintf(output, "Please ensure all allocated memory is properly freed.\n");
+}
+
+// Function to display memory leaks in the console
+void display_memory_leaks() {
+    report_memory_leaks(stdout, 1);
 }
 
+// Function to display the running totals kept by the tracking table
+void display_tracking_stats() {
+    printf("\nLive blocks     : %zu (peak %zu)\n", allocated_memory.live_count, allocated_memory.peak_count);
+    printf("Live bytes      : %zu (peak %zu)\n", allocated_memory.live_bytes, allocated_memory.peak_bytes);
+    printf("Allocations     : %llu\n", (unsigned long long)allocated_memory.total_allocations);
+    printf("Frees           : %llu\n", (unsigned long long)allocated_memory.total_frees);
+    printf("Table slots     : %zu\n", allocated_memory.slot_mask + 1);
+}
+
+// The interactive front end is left out of the LD_PRELOAD library, where
+// leak_preload.c feeds the table from the interposed allocator instead
+#ifndef LEAK_DETECTOR_PRELOAD
+
 // Function to allocate memory dynamically and track it
 void allocate_memory(size_t size) {
     void *data = malloc(size);
@@ -60,7 +175,11 @@ void allocate_memory(size_t size) {
 // Main function
 int main() {
     size_t size;
+    void *ptr;
     int choice;
+    char path[256];
+
+    table_init(&allocated_memory);
 
     while (1) {
         // Display the menu
@@ -71,6 +190,9 @@ int main() {
         printf("║ 2. Display memory leaks                      ║\n");
         printf("║ 3. Free all allocated memory                 ║\n");
         printf("║ 4. Exit                                      ║\n");
+        printf("║ 5. Free one block                            ║\n");
+        printf("║ 6. Show tracking statistics                  ║\n");
+        printf("║ 7. Save heap snapshot                        ║\n");
         printf("╚══════════════════════════════════════════════╝\n");
 
         printf("Select an option: ");
@@ -101,8 +223,41 @@ int main() {
                 printf("Exiting program...\n");
                 display_memory_leaks();
                 free_tracked_memory();
+                table_destroy(&allocated_memory);
                 return 0;
 
+            case 5:
+                printf("Enter address of the block to free: ");
+                if (scanf("%p", &ptr) != 1) {
+                    printf("Invalid address.\n");
+                    while (getchar() != '\n'); // Clear invalid input
+                    break;
+                }
+                if (free_tracked_block(ptr)) {
+                    printf("Memory at %p freed.\n", ptr);
+                } else {
+                    printf("Error: %p is not a tracked block.\n", ptr);
+                }
+                break;
+
+            case 6:
+                display_tracking_stats();
+                break;
+
+            case 7:
+                printf("Enter snapshot file name: ");
+                if (scanf("%255s", path) != 1) {
+                    printf("Invalid file name.\n");
+                    while (getchar() != '\n'); // Clear invalid input
+                    break;
+                }
+                if (heap_snapshot_write(path, &allocated_memory, 0) == 0) {
+                    printf("Snapshot of %zu block(s) written to %s\n", allocated_memory.live_count, path);
+                } else {
+                    printf("Error: cannot write %s: %s\n", path, strerror(errno));
+                }
+                break;
+
             default:
                 printf("Invalid option. Please try again.\n");
                 break;
@@ -111,3 +266,5 @@ int main() {
 
     return 0;
 }
+
+#endif // LEAK_DETECTOR_PRELOAD
@@ -3,17 +3,19 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include "allocation_table.h"
 
-// Structure to track memory blocks
-typedef struct MemoryBlock {
-    void *ptr;
-    size_t size;
-    struct MemoryBlock *next;
-} MemoryBlock;
+// Every block allocated and not yet freed
+extern AllocationTable allocated_memory;
 
 // Function declarations
 void add_to_tracked_memory(void *ptr, size_t size);
+int free_tracked_block(void *ptr);
 void free_tracked_memory();
 void display_memory_leaks();
+void report_memory_leaks(FILE *output, int list_blocks);
+void report_classified_leaks(FILE *output, const AllocationTable *definitely_lost,
+                             const AllocationTable *indirectly_lost, const AllocationTable *reachable);
+void display_tracking_stats();
 
 #endif // MEMORY_LEAK_DETECTOR_H
@@ -1,5 +1,42 @@
+; Kernels for the paging simulator's free-frame bitmap and size arrays.
+;
+; Each exported kernel has a scalar, an AVX2 and an AVX-512 version. The
+; unsuffixed entry points jump through a pointer that starts out at a
+; resolver: the first call checks CPUID (and that the OS saves the vector
+; registers) and points every kernel at the best version, so later calls
+; cost one indirect jump. The suffixed versions are exported as well, so
+; that memory_utils_benchmark can check them against each other.
+;
+; The AVX-512 versions need AVX512F and AVX512_VPOPCNTDQ; CPUs without
+; the latter use the AVX2 versions. All kernels use the System V AMD64
+; calling convention.
+
+default rel
+
+section .data
+align 8
+cpu_level:       dd -1                  ; 0 scalar, 1 AVX2, 2 AVX-512, -1 not checked yet
+align 8
+popcount_impl:   dq popcount_resolve
+find_run_impl:   dq find_run_resolve
+best_fit_impl:   dq best_fit_resolve
+
+popcount_table:  dq bitmap_popcount_scalar, bitmap_popcount_avx2, bitmap_popcount_avx512
+find_run_table:  dq bitmap_find_run_scalar, bitmap_find_run_avx2, bitmap_find_run_avx512
+best_fit_table:  dq best_fit_index_scalar, best_fit_index_avx2, best_fit_index_avx512
+
+section .rodata
+align 32
+; Bits set in each nibble value, twice over for both 128-bit lanes
+nibble_popcount: db 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+                 db 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+
 section .text
 global check_memory_availability
+global memory_utils_level
+global bitmap_popcount, bitmap_popcount_scalar, bitmap_popcount_avx2, bitmap_popcount_avx512
+global bitmap_find_run, bitmap_find_run_scalar, bitmap_find_run_avx2, bitmap_find_run_avx512
+global best_fit_index, best_fit_index_scalar, best_fit_index_avx2, best_fit_index_avx512
 
 ; Function: check_memory_availability
 ; Input: RDI = total free pages
@@ -18,3 +55,667 @@ check_memory_availability:
 enough_memory:
     mov rax, 1          ; Set RAX to 1 (enough memory)
     ret                 ; Return
+
+; ---------------------------------------------------------------------------
+; Dispatch
+
+; Function: detect_cpu
+; Description:
+; - Sets cpu_level and points every kernel at the version for that level.
+; - Preserves all registers but RAX, R8, R9 and the flags, so the resolvers
+;   can call it with the kernel's arguments still in place.
+
+detect_cpu:
+    push rbx
+    push rcx
+    push rdx
+    xor r8d, r8d                ; Level found so far
+    mov eax, 1
+    cpuid
+    mov r9d, ecx
+    and r9d, (1 << 27) | (1 << 28) | (1 << 23)
+    cmp r9d, (1 << 27) | (1 << 28) | (1 << 23)  ; OSXSAVE, AVX and POPCNT
+    jne .store
+    xor ecx, ecx
+    xgetbv                      ; Which register states the OS saves
+    mov r9d, eax
+    and eax, 0x06
+    cmp eax, 0x06               ; XMM and YMM
+    jne .store
+    mov eax, 7
+    xor ecx, ecx
+    cpuid
+    test ebx, 1 << 5            ; AVX2
+    jz .store
+    mov r8d, 1
+    and r9d, 0xe6
+    cmp r9d, 0xe6               ; Opmask and ZMM as well
+    jne .store
+    test ebx, 1 << 16           ; AVX512F
+    jz .store
+    test ecx, 1 << 14           ; AVX512_VPOPCNTDQ
+    jz .store
+    mov r8d, 2
+.store:
+    lea rax, [popcount_table]   ; RIP-relative, so indexed separately
+    mov rax, [rax + r8 * 8]
+    mov [popcount_impl], rax
+    lea rax, [find_run_table]
+    mov rax, [rax + r8 * 8]
+    mov [find_run_impl], rax
+    lea rax, [best_fit_table]
+    mov rax, [rax + r8 * 8]
+    mov [best_fit_impl], rax
+    mov [cpu_level], r8d
+    pop rdx
+    pop rcx
+    pop rbx
+    ret
+
+; Function: memory_utils_level
+; Output: EAX = 0 (scalar), 1 (AVX2) or 2 (AVX-512), the versions in use
+
+memory_utils_level:
+    mov eax, [cpu_level]
+    test eax, eax
+    jns .known
+    call detect_cpu
+    mov eax, [cpu_level]
+.known:
+    ret
+
+bitmap_popcount:
+    jmp [popcount_impl]
+popcount_resolve:
+    call detect_cpu
+    jmp [popcount_impl]
+
+bitmap_find_run:
+    jmp [find_run_impl]
+find_run_resolve:
+    call detect_cpu
+    jmp [find_run_impl]
+
+best_fit_index:
+    jmp [best_fit_impl]
+best_fit_resolve:
+    call detect_cpu
+    jmp [best_fit_impl]
+
+; ---------------------------------------------------------------------------
+; Function: bitmap_popcount
+; Input: RDI = words, RSI = number of 64-bit words
+; Output: RAX = number of set bits
+
+bitmap_popcount_scalar:
+    xor eax, eax
+    test rsi, rsi
+    jz .done
+    mov r8, 0x5555555555555555
+    mov r9, 0x3333333333333333
+    mov r10, 0x0f0f0f0f0f0f0f0f
+    mov r11, 0x0101010101010101
+.loop:                          ; Bit counts summed in ever wider fields
+    mov rdx, [rdi]
+    mov rcx, rdx
+    shr rcx, 1
+    and rcx, r8
+    sub rdx, rcx                ; 2-bit fields
+    mov rcx, rdx
+    shr rcx, 2
+    and rdx, r9
+    and rcx, r9
+    add rdx, rcx                ; 4-bit fields
+    mov rcx, rdx
+    shr rcx, 4
+    add rdx, rcx
+    and rdx, r10                ; Bytes
+    imul rdx, r11               ; Top byte gets the sum of all bytes
+    shr rdx, 56
+    add rax, rdx
+    add rdi, 8
+    dec rsi
+    jnz .loop
+.done:
+    ret
+
+; Nibbles are looked up in a 16-entry table with VPSHUFB and the byte
+; counts summed per word with VPSADBW
+bitmap_popcount_avx2:
+    vpxor ymm0, ymm0, ymm0      ; Four word-sized sums
+    vpxor ymm5, ymm5, ymm5
+    vmovdqa ymm4, [nibble_popcount]
+    mov eax, 0x0f0f0f0f
+    vmovd xmm3, eax
+    vpbroadcastd ymm3, xmm3     ; Low nibble mask
+    cmp rsi, 4
+    jb .reduce
+.loop:
+    vmovdqu ymm1, [rdi]
+    vpsrlw ymm2, ymm1, 4
+    vpand ymm1, ymm1, ymm3
+    vpand ymm2, ymm2, ymm3
+    vpshufb ymm1, ymm4, ymm1
+    vpshufb ymm2, ymm4, ymm2
+    vpaddb ymm1, ymm1, ymm2     ; At most 8 per byte
+    vpsadbw ymm1, ymm1, ymm5
+    vpaddq ymm0, ymm0, ymm1
+    add rdi, 32
+    sub rsi, 4
+    cmp rsi, 4
+    jae .loop
+.reduce:
+    vextracti128 xmm1, ymm0, 1
+    vpaddq xmm0, xmm0, xmm1
+    vpshufd xmm1, xmm0, 0x4e
+    vpaddq xmm0, xmm0, xmm1
+    vmovq rax, xmm0
+    vzeroupper
+    test rsi, rsi
+    jz .done
+.tail:
+    popcnt rdx, [rdi]
+    add rax, rdx
+    add rdi, 8
+    dec rsi
+    jnz .tail
+.done:
+    ret
+
+bitmap_popcount_avx512:
+    vpxorq zmm0, zmm0, zmm0
+    cmp rsi, 8
+    jb .tail
+.loop:
+    vpopcntq zmm1, [rdi]
+    vpaddq zmm0, zmm0, zmm1
+    add rdi, 64
+    sub rsi, 8
+    cmp rsi, 8
+    jae .loop
+.tail:                          ; Up to seven words through a load mask
+    mov ecx, esi
+    mov eax, 1
+    shl eax, cl
+    dec eax
+    kmovw k1, eax
+    vmovdqu64 zmm1{k1}{z}, [rdi]
+    vpopcntq zmm1, zmm1
+    vpaddq zmm0, zmm0, zmm1
+    vextracti64x4 ymm1, zmm0, 1
+    vpaddq ymm0, ymm0, ymm1
+    vextracti128 xmm1, ymm0, 1
+    vpaddq xmm0, xmm0, xmm1
+    vpshufd xmm1, xmm0, 0x4e
+    vpaddq xmm0, xmm0, xmm1
+    vmovq rax, xmm0
+    vzeroupper
+    ret
+
+; ---------------------------------------------------------------------------
+; Function: bitmap_find_run
+; Input: RDI = words, RSI = number of 64-bit words, RDX = run length
+; Output: RAX = index of the first bit of the lowest run of RDX set bits,
+;         -1 if there is none or RDX is 0
+; Description:
+; - Bit i of word w is bit 64 * w + i. A run may span any number of words.
+;
+; All three versions keep the same state while scanning:
+;   RDI = next word, RSI = words left, RDX = run length wanted,
+;   R8 = first bit of the current run, R9 = its length so far,
+;   R10 = bit index of the next word's bit 0
+; The vector versions skip blocks of words that are all clear or all set
+; and leave mixed blocks and the last words to the scalar loop.
+
+bitmap_find_run_scalar:
+    push rbx
+    push rbp
+    test rdx, rdx
+    jz find_run_none
+    xor r8d, r8d
+    xor r9d, r9d
+    xor r10d, r10d
+find_run_words:
+    test rsi, rsi
+    jz find_run_none
+.word:
+    mov r11, [rdi]
+    test r11, r11
+    jz .clear
+    cmp r11, -1
+    je .set
+    call find_run_mixed
+    cmp rax, -1
+    jne find_run_return
+    jmp .next
+.clear:
+    xor r9d, r9d
+    jmp .next
+.set:
+    test r9, r9
+    jnz .extend
+    mov r8, r10
+.extend:
+    add r9, 64
+    cmp r9, rdx
+    jae find_run_found
+.next:
+    add rdi, 8
+    add r10, 64
+    dec rsi
+    jnz .word
+find_run_none:
+    mov rax, -1
+    jmp find_run_return
+find_run_found:
+    mov rax, r8
+find_run_return:
+    pop rbp
+    pop rbx
+    ret
+
+; Function: find_run_mixed
+; Input: R11 = a word with both set and clear bits, other state as above
+; Output: RAX = first bit of a run that reaches RDX, -1 to carry on
+; Clobbers RBX, RBP and RCX
+
+find_run_mixed:
+    mov rax, r11
+    not rax
+    bsf rcx, rax                ; Set bits below the lowest clear bit
+    test rcx, rcx
+    jz .inside
+    test r9, r9
+    jnz .extend
+    mov r8, r10
+.extend:
+    add r9, rcx
+    cmp r9, rdx
+    jb .inside
+    mov rax, r8
+    ret
+.inside:
+    ; A run within the word: AND the word with itself shifted by doubling
+    ; amounts until bit i is set only where bits i..i+RDX-1 all were. Runs
+    ; from bit 0 were handled above, and a run of 64 cannot fit.
+    cmp rdx, 64
+    jae .leading
+    mov rax, r11
+    mov ebx, 1                  ; Run length bit i stands for
+.shift:
+    cmp rbx, rdx
+    jae .inside_found
+    mov rcx, rdx
+    sub rcx, rbx
+    cmp rcx, rbx
+    cmova rcx, rbx              ; Shift by min(length, wanted - length)
+    add rbx, rcx
+    mov rbp, rax
+    shr rbp, cl
+    and rax, rbp
+    jnz .shift
+    jmp .leading
+.inside_found:
+    bsf rax, rax
+    add rax, r10
+    ret
+.leading:
+    ; Set bits above the highest clear bit start a run into the next word
+    mov rax, r11
+    not rax
+    bsr rcx, rax
+    mov r9, 63
+    sub r9, rcx
+    lea r8, [r10 + rcx + 1]
+    mov rax, -1
+    ret
+
+bitmap_find_run_avx2:
+    push rbx
+    push rbp
+    test rdx, rdx
+    jz find_run_none
+    xor r8d, r8d
+    xor r9d, r9d
+    xor r10d, r10d
+    vpcmpeqq ymm2, ymm2, ymm2   ; All ones
+.block:
+    cmp rsi, 4
+    jb .words
+    vmovdqu ymm0, [rdi]
+    vptest ymm0, ymm0
+    jz .clear                   ; Four words in use
+    vptest ymm0, ymm2
+    jc .set                     ; Four words free
+    mov ebx, 4                  ; Mixed: word by word
+.mixed_word:
+    mov r11, [rdi]
+    test r11, r11
+    jz .mixed_clear
+    cmp r11, -1
+    je .mixed_set
+    push rbx
+    call find_run_mixed
+    pop rbx
+    cmp rax, -1
+    jne .found_mixed
+    jmp .mixed_next
+.mixed_clear:
+    xor r9d, r9d
+    jmp .mixed_next
+.mixed_set:
+    test r9, r9
+    jnz .mixed_extend
+    mov r8, r10
+.mixed_extend:
+    add r9, 64
+    cmp r9, rdx
+    jae .found_run
+.mixed_next:
+    add rdi, 8
+    add r10, 64
+    dec rsi
+    dec ebx
+    jnz .mixed_word
+    jmp .block
+.clear:
+    xor r9d, r9d
+    jmp .skip
+.set:
+    test r9, r9
+    jnz .extend
+    mov r8, r10
+.extend:
+    add r9, 256
+    cmp r9, rdx
+    jae .found_run
+.skip:
+    add rdi, 32
+    add r10, 256
+    sub rsi, 4
+    jmp .block
+.found_run:
+    mov rax, r8
+.found_mixed:
+    vzeroupper
+    jmp find_run_return
+.words:
+    vzeroupper
+    jmp find_run_words
+
+bitmap_find_run_avx512:
+    push rbx
+    push rbp
+    test rdx, rdx
+    jz find_run_none
+    xor r8d, r8d
+    xor r9d, r9d
+    xor r10d, r10d
+    vpternlogq zmm2, zmm2, zmm2, 0xff  ; All ones
+.block:
+    cmp rsi, 8
+    jb .words
+    vmovdqu64 zmm0, [rdi]
+    vptestmq k1, zmm0, zmm0
+    kortestw k1, k1
+    jz .clear                   ; Eight words in use
+    vpcmpeqq k2, zmm0, zmm2
+    kmovw eax, k2
+    cmp eax, 0xff
+    je .set                     ; Eight words free
+    mov ebx, 8                  ; Mixed: word by word
+.mixed_word:
+    mov r11, [rdi]
+    test r11, r11
+    jz .mixed_clear
+    cmp r11, -1
+    je .mixed_set
+    push rbx
+    call find_run_mixed
+    pop rbx
+    cmp rax, -1
+    jne .found_mixed
+    jmp .mixed_next
+.mixed_clear:
+    xor r9d, r9d
+    jmp .mixed_next
+.mixed_set:
+    test r9, r9
+    jnz .mixed_extend
+    mov r8, r10
+.mixed_extend:
+    add r9, 64
+    cmp r9, rdx
+    jae .found_run
+.mixed_next:
+    add rdi, 8
+    add r10, 64
+    dec rsi
+    dec ebx
+    jnz .mixed_word
+    jmp .block
+.clear:
+    xor r9d, r9d
+    jmp .skip
+.set:
+    test r9, r9
+    jnz .extend
+    mov r8, r10
+.extend:
+    add r9, 512
+    cmp r9, rdx
+    jae .found_run
+.skip:
+    add rdi, 64
+    add r10, 512
+    sub rsi, 8
+    jmp .block
+.found_run:
+    mov rax, r8
+.found_mixed:
+    vzeroupper
+    jmp find_run_return
+.words:
+    vzeroupper
+    jmp find_run_words
+
+; ---------------------------------------------------------------------------
+; Function: best_fit_index
+; Input: RDI = sizes, RSI = number of 64-bit sizes, RDX = size wanted
+; Output: RAX = index of the smallest size >= RDX, the lowest such index on
+;         a tie, -1 if every size is smaller
+; Description:
+; - The vector versions find the best size first and then its first index.
+
+best_fit_index_scalar:
+    mov rax, -1                 ; Best index so far
+    mov r8, -1                  ; Its size
+    xor ecx, ecx
+    test rsi, rsi
+    jz .done
+.loop:
+    mov r9, [rdi + rcx * 8]
+    cmp r9, rdx
+    jb .next                    ; Too small
+    je .exact                   ; Nothing can fit better
+    cmp r9, r8
+    jb .take
+    cmp rax, -1                 ; Equal or larger only counts for the first
+    jne .next                   ; fit, whose size can only be -1 here
+.take:
+    mov r8, r9
+    mov rax, rcx
+.next:
+    inc rcx
+    cmp rcx, rsi
+    jb .loop
+.done:
+    ret
+.exact:
+    mov rax, rcx
+    ret
+
+; AVX2 has no unsigned 64-bit compare, so sizes are compared as signed
+; after flipping their top bits
+best_fit_index_avx2:
+    mov rax, 0x8000000000000000
+    vmovq xmm5, rax
+    vpbroadcastq ymm5, xmm5     ; Sign flip
+    vmovq xmm4, rdx
+    vpbroadcastq ymm4, xmm4
+    vpxor ymm4, ymm4, ymm5      ; Wanted size, flipped
+    vpcmpeqq ymm6, ymm6, ymm6
+    vpxor ymm6, ymm6, ymm5      ; -1, flipped
+    vmovdqa ymm0, ymm6          ; Best per lane, flipped
+    mov r10, rdi                ; Keep the start for the second pass
+    mov r11, rsi
+.min_loop:
+    cmp rsi, 4
+    jb .min_reduce
+    vmovdqu ymm1, [rdi]
+    vpxor ymm1, ymm1, ymm5
+    vpcmpgtq ymm2, ymm4, ymm1   ; Too small ...
+    vblendvpd ymm1, ymm1, ymm6, ymm2  ; ... counts as -1
+    vpcmpgtq ymm3, ymm0, ymm1   ; Smaller than the best so far
+    vblendvpd ymm0, ymm0, ymm1, ymm3
+    add rdi, 32
+    sub rsi, 4
+    jmp .min_loop
+.min_reduce:
+    ; Unsigned minimum of the four lanes and the remaining sizes
+    mov rcx, 0x8000000000000000
+    mov r8, -1
+    vmovq rax, xmm0
+    xor rax, rcx
+    cmp rax, r8
+    cmovb r8, rax
+    vpextrq rax, xmm0, 1
+    xor rax, rcx
+    cmp rax, r8
+    cmovb r8, rax
+    vextracti128 xmm0, ymm0, 1
+    vmovq rax, xmm0
+    xor rax, rcx
+    cmp rax, r8
+    cmovb r8, rax
+    vpextrq rax, xmm0, 1
+    xor rax, rcx
+    cmp rax, r8
+    cmovb r8, rax
+    test rsi, rsi
+    jz .find
+.min_tail:
+    mov rax, [rdi]
+    cmp rax, rdx
+    jb .min_tail_next
+    cmp rax, r8
+    cmovb r8, rax
+.min_tail_next:
+    add rdi, 8
+    dec rsi
+    jnz .min_tail
+.find:
+    ; First index holding the best size. A best of -1 is only a fit if
+    ; some size really is -1, which the search then finds.
+    mov rdi, r10
+    xor ecx, ecx
+    vmovq xmm1, r8
+    vpbroadcastq ymm1, xmm1
+.find_loop:
+    lea rax, [rcx + 4]
+    cmp rax, r11
+    ja .find_tail
+    vpcmpeqq ymm2, ymm1, [rdi + rcx * 8]
+    vmovmskpd eax, ymm2
+    test eax, eax
+    jnz .find_found
+    add rcx, 4
+    jmp .find_loop
+.find_found:
+    bsf eax, eax
+    add rax, rcx
+    vzeroupper
+    ret
+.find_tail:
+    vzeroupper
+.find_tail_loop:
+    cmp rcx, r11
+    jae .none
+    cmp [rdi + rcx * 8], r8
+    je .tail_found
+    inc rcx
+    jmp .find_tail_loop
+.tail_found:
+    mov rax, rcx
+    ret
+.none:
+    mov rax, -1
+    ret
+
+best_fit_index_avx512:
+    vpbroadcastq zmm4, rdx      ; Wanted size
+    vpternlogq zmm0, zmm0, zmm0, 0xff  ; Best per lane; starts at -1
+    mov r10, rdi
+    mov r11, rsi
+.min_loop:
+    cmp rsi, 8
+    jb .min_tail
+    vmovdqu64 zmm1, [rdi]
+    vpcmpuq k1, zmm1, zmm4, 5   ; Fits: size >= wanted
+    vpminuq zmm0{k1}, zmm0, zmm1
+    add rdi, 64
+    sub rsi, 8
+    jmp .min_loop
+.min_tail:
+    mov ecx, esi
+    mov eax, 1
+    shl eax, cl
+    dec eax
+    kmovw k2, eax
+    vmovdqu64 zmm1{k2}{z}, [rdi]
+    vpcmpuq k1{k2}, zmm1, zmm4, 5
+    vpminuq zmm0{k1}, zmm0, zmm1
+    vshufi64x2 zmm1, zmm0, zmm0, 0x4e   ; Unsigned minimum across lanes
+    vpminuq zmm0, zmm0, zmm1
+    vshufi64x2 zmm1, zmm0, zmm0, 0xb1
+    vpminuq zmm0, zmm0, zmm1
+    vpshufd zmm1, zmm0, 0x4e
+    vpminuq zmm0, zmm0, zmm1
+    vmovq r8, xmm0
+    ; First index holding the best size, as in the AVX2 version
+    vpbroadcastq zmm1, r8
+    xor ecx, ecx
+.find_loop:
+    lea rax, [rcx + 8]
+    cmp rax, r11
+    ja .find_tail
+    vpcmpeqq k1, zmm1, [r10 + rcx * 8]
+    kmovw eax, k1
+    test eax, eax
+    jnz .find_found
+    add rcx, 8
+    jmp .find_loop
+.find_tail:
+    mov rax, r11
+    sub rax, rcx
+    mov r9, rcx
+    mov ecx, eax
+    mov eax, 1
+    shl eax, cl
+    dec eax
+    kmovw k2, eax
+    mov rcx, r9
+    vmovdqu64 zmm2{k2}{z}, [r10 + rcx * 8]
+    vpcmpeqq k1{k2}, zmm1, zmm2
+    kmovw eax, k1
+    test eax, eax
+    jz .none
+.find_found:
+    bsf eax, eax
+    add rax, rcx
+    vzeroupper
+    ret
+.none:
+    mov rax, -1
+    vzeroupper
+    ret
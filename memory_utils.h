@@ -0,0 +1,40 @@
+#ifndef MEMORY_UTILS_H
+#define MEMORY_UTILS_H
+
+#include <stdint.h>
+
+// Kernels from memory_utils.asm. Each unsuffixed kernel runs the best
+// version the CPU supports, picked on first use; the suffixed versions can
+// be called directly when the CPU has the instructions they need.
+
+#define SIMD_NO_INDEX UINT64_MAX
+
+enum { SIMD_SCALAR, SIMD_AVX2, SIMD_AVX512, SIMD_LEVELS };
+
+// Returns 1 if free_pages >= pages_needed; the counts are compared as full
+// 64-bit registers
+extern int check_memory_availability(long free_pages, long pages_needed);
+// The version in use: SIMD_SCALAR, SIMD_AVX2 or SIMD_AVX512
+extern int memory_utils_level(void);
+
+// Number of set bits in count words
+extern uint64_t bitmap_popcount(const uint64_t *words, uint64_t count);
+extern uint64_t bitmap_popcount_scalar(const uint64_t *words, uint64_t count);
+extern uint64_t bitmap_popcount_avx2(const uint64_t *words, uint64_t count);
+extern uint64_t bitmap_popcount_avx512(const uint64_t *words, uint64_t count);
+
+// First bit of the lowest run of length set bits, bit i of word w being
+// bit 64 * w + i; SIMD_NO_INDEX if there is none or length is 0
+extern uint64_t bitmap_find_run(const uint64_t *words, uint64_t count, uint64_t length);
+extern uint64_t bitmap_find_run_scalar(const uint64_t *words, uint64_t count, uint64_t length);
+extern uint64_t bitmap_find_run_avx2(const uint64_t *words, uint64_t count, uint64_t length);
+extern uint64_t bitmap_find_run_avx512(const uint64_t *words, uint64_t count, uint64_t length);
+
+// Index of the smallest size >= wanted, the lowest index on a tie;
+// SIMD_NO_INDEX if every size is smaller
+extern uint64_t best_fit_index(const uint64_t *sizes, uint64_t count, uint64_t wanted);
+extern uint64_t best_fit_index_scalar(const uint64_t *sizes, uint64_t count, uint64_t wanted);
+extern uint64_t best_fit_index_avx2(const uint64_t *sizes, uint64_t count, uint64_t wanted);
+extern uint64_t best_fit_index_avx512(const uint64_t *sizes, uint64_t count, uint64_t wanted);
+
+#endif // MEMORY_UTILS_H
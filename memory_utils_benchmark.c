@@ -0,0 +1,212 @@
+// Checks every version of the memory_utils.asm kernels the CPU can run
+// against a plain C reference, then measures them in cycles per byte.
+//
+// The checks cover every word count up to a few vector blocks and every
+// tail length, run length and start offset within them, over bitmaps and
+// size arrays drawn at several densities, including all-clear, all-set
+// and duplicate-heavy inputs. Any mismatch is printed and the program
+// exits with status 1 before benchmarking.
+//
+// Usage: memory_utils_benchmark [max_words]
+
+#include "memory_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <x86intrin.h>
+
+#define CHECK_WORDS 40       // Five AVX-512 blocks
+#define CHECK_ROUNDS 200
+#define DEFAULT_MAX_WORDS (8u << 20)  // 64 MiB
+#define REPEAT_BYTES (256u << 20)     // Bytes scanned per measurement
+
+typedef uint64_t (*PopcountKernel)(const uint64_t *, uint64_t);
+typedef uint64_t (*FindRunKernel)(const uint64_t *, uint64_t, uint64_t);
+typedef uint64_t (*BestFitKernel)(const uint64_t *, uint64_t, uint64_t);
+
+static const char *level_names[SIMD_LEVELS] = {"scalar", "avx2", "avx512"};
+static const PopcountKernel popcount_kernels[SIMD_LEVELS] = {bitmap_popcount_scalar, bitmap_popcount_avx2,
+                                                             bitmap_popcount_avx512};
+static const FindRunKernel find_run_kernels[SIMD_LEVELS] = {bitmap_find_run_scalar, bitmap_find_run_avx2,
+                                                            bitmap_find_run_avx512};
+static const BestFitKernel best_fit_kernels[SIMD_LEVELS] = {best_fit_index_scalar, best_fit_index_avx2,
+                                                            best_fit_index_avx512};
+
+static uint64_t random_state = 0x9E3779B97F4A7C15ull;
+
+static uint64_t next_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+// A word whose bits are set with probability density / 8
+static uint64_t random_word(int density) {
+    if (density <= 0) return 0;
+    if (density >= 8) return ~0ull;
+    uint64_t word = 0;
+    for (int bit = 0; bit < 64; bit++) {
+        if ((int)(next_random() % 8) < density) word |= 1ull << bit;
+    }
+    return word;
+}
+
+static uint64_t reference_popcount(const uint64_t *words, uint64_t count) {
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        total += (uint64_t)__builtin_popcountll(words[i]);
+    }
+    return total;
+}
+
+static uint64_t reference_find_run(const uint64_t *words, uint64_t count, uint64_t length) {
+    uint64_t run = 0;
+    for (uint64_t bit = 0; length && bit < count * 64; bit++) {
+        run = (words[bit / 64] >> (bit % 64) & 1) ? run + 1 : 0;
+        if (run == length) return bit + 1 - length;
+    }
+    return SIMD_NO_INDEX;
+}
+
+static uint64_t reference_best_fit(const uint64_t *sizes, uint64_t count, uint64_t wanted) {
+    uint64_t best = SIMD_NO_INDEX;
+    for (uint64_t i = 0; i < count; i++) {
+        if (sizes[i] >= wanted && (best == SIMD_NO_INDEX || sizes[i] < sizes[best])) best = i;
+    }
+    return best;
+}
+
+static int failures;
+static volatile uint64_t measure_sink;  // Keeps measured calls from being optimised away
+
+static void report_mismatch(const char *kernel, int level, uint64_t count, uint64_t argument, uint64_t expected,
+                            uint64_t actual) {
+    if (failures++ < 20) {
+        fprintf(stderr, "MISMATCH %s_%s: %llu items, argument %llu: expected %lld, got %lld\n", kernel,
+                level_names[level], (unsigned long long)count, (unsigned long long)argument, (long long)expected,
+                (long long)actual);
+    }
+}
+
+static void check_kernels(int levels) {
+    // Spare words past the end, so that starting 0-7 words in tests every
+    // alignment against a vector block
+    uint64_t buffer[CHECK_WORDS + 16];
+    for (int round = 0; round < CHECK_ROUNDS; round++) {
+        int density = round % 10 - 1;  // -1 and 9 give all-clear and all-set words
+        for (uint64_t i = 0; i < CHECK_WORDS + 16; i++) {
+            // Mix densities within a bitmap so runs cross word and block edges
+            buffer[i] = next_random() % 4 == 0 ? random_word((int)(next_random() % 10) - 1) : random_word(density);
+        }
+        for (uint64_t offset = 0; offset < 8; offset++) {
+            const uint64_t *words = buffer + offset;
+            for (uint64_t count = 0; count <= CHECK_WORDS; count++) {
+                uint64_t expected = reference_popcount(words, count);
+                for (int level = 0; level < levels; level++) {
+                    uint64_t actual = popcount_kernels[level](words, count);
+                    if (actual != expected) report_mismatch("bitmap_popcount", level, count, 0, expected, actual);
+                }
+                if (offset > 1) continue;  // Runs do not depend on alignment; keep the check short
+                for (uint64_t length = 0; length <= count * 64 + 1; length++) {
+                    // Every short run, and long runs around whole words
+                    if (length > 130 && (length + 1) % 64 > 2 && length % 61 != 0) continue;
+                    expected = reference_find_run(words, count, length);
+                    for (int level = 0; level < levels; level++) {
+                        uint64_t actual = find_run_kernels[level](words, count, length);
+                        if (actual != expected) {
+                            report_mismatch("bitmap_find_run", level, count, length, expected, actual);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Sizes from a small range so that ties are common, with the
+        // extremes mixed in
+        uint64_t *sizes = buffer;
+        uint64_t range = round % 3 == 0 ? 4 : 1000;
+        for (uint64_t i = 0; i < CHECK_WORDS + 16; i++) {
+            uint64_t pick = next_random() % 16;
+            sizes[i] = pick == 0 ? 0 : pick == 1 ? UINT64_MAX : pick == 2 ? UINT64_MAX - 1 : next_random() % range;
+        }
+        uint64_t wanted_values[] = {0, 1, 2, 3, range / 2, range - 1, range, UINT64_MAX - 1, UINT64_MAX,
+                                    next_random() % range, 1ull << 63, (1ull << 63) - 1};
+        for (uint64_t offset = 0; offset < 8; offset++) {
+            for (uint64_t count = 0; count <= CHECK_WORDS; count++) {
+                for (size_t w = 0; w < sizeof(wanted_values) / sizeof(wanted_values[0]); w++) {
+                    uint64_t expected = reference_best_fit(sizes + offset, count, wanted_values[w]);
+                    for (int level = 0; level < levels; level++) {
+                        uint64_t actual = best_fit_kernels[level](sizes + offset, count, wanted_values[w]);
+                        if (actual != expected) {
+                            report_mismatch("best_fit_index", level, count, wanted_values[w], expected, actual);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Cycles per byte for one kernel call over count words, repeated until
+// REPEAT_BYTES have been scanned
+#define MEASURE(call, count)                                                              \
+    do {                                                                                  \
+        uint64_t repeats = REPEAT_BYTES / ((count) * 8) + 1, sink = 0;                    \
+        uint64_t started = __rdtsc();                                                     \
+        for (uint64_t r = 0; r < repeats; r++) sink += (call);                            \
+        uint64_t cycles = __rdtsc() - started;                                            \
+        printf(" %10.4f", (double)cycles / (double)(repeats * (count) * 8));              \
+        measure_sink = sink;                                                              \
+    } while (0)
+
+int main(int argc, char *argv[]) {
+    uint64_t max_words = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_MAX_WORDS;
+    int levels = memory_utils_level() + 1;
+    printf("CPU level: %s\n", level_names[levels - 1]);
+
+    check_kernels(levels);
+    if (failures) {
+        fprintf(stderr, "%d mismatches\n", failures);
+        return 1;
+    }
+    printf("Equivalence checks passed for %d kernel versions\n", levels);
+
+    uint64_t *data = malloc(max_words * sizeof(uint64_t));
+    if (!data) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 1;
+    }
+    // A fragmented bitmap: every bit set with probability 1/2, so runs of
+    // set bits are a few bits long, none reaches 1000 and find_run(1000)
+    // scans all of it
+    for (uint64_t i = 0; i < max_words; i++) data[i] = random_word(4);
+
+    printf("\nCycles per byte (TSC)\n%-16s %10s", "kernel", "words");
+    for (int level = 0; level < levels; level++) printf(" %10s", level_names[level]);
+    printf("\n");
+    for (uint64_t count = 512; count <= max_words; count *= 16) {
+        printf("%-16s %10llu", "popcount", (unsigned long long)count);
+        for (int level = 0; level < levels; level++) MEASURE(popcount_kernels[level](data, count), count);
+        printf("\n");
+    }
+    for (uint64_t count = 512; count <= max_words; count *= 16) {
+        printf("%-16s %10llu", "find_run(1000)", (unsigned long long)count);
+        for (int level = 0; level < levels; level++) MEASURE(find_run_kernels[level](data, count, 1000), count);
+        printf("\n");
+    }
+    // A mostly full bitmap, where whole blocks are skipped
+    for (uint64_t i = 0; i < max_words; i++) data[i] = next_random() % 64 ? 0 : random_word(4);
+    for (uint64_t count = 512; count <= max_words; count *= 16) {
+        printf("%-16s %10llu", "find_run(full)", (unsigned long long)count);
+        for (int level = 0; level < levels; level++) MEASURE(find_run_kernels[level](data, count, 64), count);
+        printf("\n");
+    }
+    for (uint64_t i = 0; i < max_words; i++) data[i] = next_random() % (1u << 20);
+    for (uint64_t count = 512; count <= max_words; count *= 16) {
+        printf("%-16s %10llu", "best_fit", (unsigned long long)count);
+        for (int level = 0; level < levels; level++) MEASURE(best_fit_kernels[level](data, count, 1u << 19), count);
+        printf("\n");
+    }
+    free(data);
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "metrics.h"
+#include <inttypes.h>
+#include <string.h>
+
+void histogram_init(LogHistogram *histogram) {
+    memset(histogram, 0, sizeof(*histogram));
+    histogram->min = UINT64_MAX;
+}
+
+void histogram_merge(LogHistogram *into, const LogHistogram *from) {
+    for (unsigned i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        into->counts[i] += from->counts[i];
+    }
+    into->count += from->count;
+    into->sum += from->sum;
+    if (from->min < into->min) into->min = from->min;
+    if (from->max > into->max) into->max = from->max;
+}
+
+uint64_t histogram_bucket_low(unsigned bucket) {
+    if (bucket < HISTOGRAM_SUB_BUCKETS) {
+        return bucket;
+    }
+    unsigned exponent = bucket / HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BITS - 1;
+    uint64_t sub = bucket % HISTOGRAM_SUB_BUCKETS;
+    return (HISTOGRAM_SUB_BUCKETS + sub) << (exponent - HISTOGRAM_SUB_BITS);
+}
+
+uint64_t histogram_bucket_high(unsigned bucket) {
+    if (bucket < HISTOGRAM_SUB_BUCKETS) {
+        return bucket;
+    }
+    unsigned exponent = bucket / HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BITS - 1;
+    return histogram_bucket_low(bucket) + ((1ull << (exponent - HISTOGRAM_SUB_BITS)) - 1);
+}
+
+uint64_t histogram_percentile(const LogHistogram *histogram, double fraction) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(fraction * (double)histogram->count + 0.5);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            uint64_t high = histogram_bucket_high(i);
+            return high < histogram->max ? high : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+void print_histogram_summary(FILE *output, const char *name, const LogHistogram *histogram, const char *unit) {
+    if (histogram->count == 0) {
+        fprintf(output, "  %-21s: none\n", name);
+        return;
+    }
+    fprintf(output,
+            "  %-21s: %" PRIu64 " ops, mean %.1f %s, p50 %" PRIu64 ", p99 %" PRIu64 ", p99.9 %" PRIu64
+            ", max %" PRIu64 "\n",
+            name, histogram->count, (double)histogram->sum / (double)histogram->count, unit,
+            histogram_percentile(histogram, 0.5), histogram_percentile(histogram, 0.99),
+            histogram_percentile(histogram, 0.999), histogram->max);
+}
+
+static void next_field(SnapshotWriter *writer, const char *name) {
+    fprintf(writer->output, "%s\"%s\": ", writer->fields++ ? ", " : "", name);
+}
+
+void snapshot_begin(SnapshotWriter *writer, FILE *output, const char *source, double seconds) {
+    writer->output = output;
+    writer->fields = 0;
+    fputc('{', output);
+    next_field(writer, "source");
+    fprintf(output, "\"%s\"", source);
+    snapshot_ratio(writer, "seconds", seconds);
+}
+
+void snapshot_count(SnapshotWriter *writer, const char *name, uint64_t value) {
+    next_field(writer, name);
+    fprintf(writer->output, "%" PRIu64, value);
+}
+
+void snapshot_ratio(SnapshotWriter *writer, const char *name, double value) {
+    next_field(writer, name);
+    fprintf(writer->output, "%.6f", value);
+}
+
+void snapshot_histogram(SnapshotWriter *writer, const char *name, const LogHistogram *histogram) {
+    next_field(writer, name);
+    FILE *output = writer->output;
+    fprintf(output, "{\"count\": %" PRIu64, histogram->count);
+    if (histogram->count) {
+        fprintf(output,
+                ", \"min\": %" PRIu64 ", \"mean\": %.2f, \"p50\": %" PRIu64 ", \"p90\": %" PRIu64
+                ", \"p99\": %" PRIu64 ", \"p999\": %" PRIu64 ", \"max\": %" PRIu64,
+                histogram->min, (double)histogram->sum / (double)histogram->count,
+                histogram_percentile(histogram, 0.5), histogram_percentile(histogram, 0.9),
+                histogram_percentile(histogram, 0.99), histogram_percentile(histogram, 0.999), histogram->max);
+    }
+    fprintf(output, ", \"buckets\": [");
+    int first = 1;
+    for (unsigned i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        if (!histogram->counts[i]) continue;
+        fprintf(output, "%s[%" PRIu64 ", %" PRIu64 ", %" PRIu64 "]", first ? "" : ", ", histogram_bucket_low(i),
+                histogram_bucket_high(i), histogram->counts[i]);
+        first = 0;
+    }
+    fprintf(output, "]}");
+}
+
+void snapshot_end(SnapshotWriter *writer) {
+    fputs("}\n", writer->output);
+    fflush(writer->output);
+}
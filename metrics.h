@@ -0,0 +1,86 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+// Instrumentation shared by the tools: HDR-style histograms and snapshot
+// export.
+//
+// A LogHistogram counts values in log-linear buckets: values below 16 get
+// a bucket each, and every power of two above is split into 16 equal
+// buckets, so any value is placed within 1/16 (6.25%) of itself over the
+// whole 64-bit range. Recording is a count-leading-zeros, a shift and an
+// increment, with no allocation; percentiles are read off the cumulative
+// counts.
+//
+// Snapshots are JSON objects, one per line, so that a file of periodic
+// snapshots can be read as a time series. Histograms in a snapshot are
+// cumulative since the start; subtract the bucket counts of two snapshots
+// for the distribution of the interval between them.
+
+#define HISTOGRAM_SUB_BITS 4
+#define HISTOGRAM_SUB_BUCKETS (1u << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+typedef struct {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t count, sum, min, max;
+} LogHistogram;
+
+static inline unsigned histogram_bucket(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return (unsigned)value;
+    }
+    unsigned exponent = 63 - (unsigned)__builtin_clzll(value);
+    unsigned sub = (unsigned)(value >> (exponent - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1);
+    return (exponent - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+static inline void histogram_record(LogHistogram *histogram, uint64_t value) {
+    histogram->counts[histogram_bucket(value)]++;
+    histogram->count++;
+    histogram->sum += value;
+    if (value < histogram->min) histogram->min = value;
+    if (value > histogram->max) histogram->max = value;
+}
+
+// Nanoseconds on the monotonic clock, for timing instrumented operations
+static inline uint64_t metrics_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+// The same clock in seconds, for timings reported in seconds
+static inline double metrics_now_seconds(void) {
+    return (double)metrics_now_ns() / 1e9;
+}
+
+void histogram_init(LogHistogram *histogram);
+void histogram_merge(LogHistogram *into, const LogHistogram *from);
+// Smallest and largest value a bucket holds
+uint64_t histogram_bucket_low(unsigned bucket);
+uint64_t histogram_bucket_high(unsigned bucket);
+// Upper bound of the bucket holding the given fraction (0-1) of the values,
+// capped at the largest value recorded; 0 when the histogram is empty
+uint64_t histogram_percentile(const LogHistogram *histogram, double fraction);
+// One line of count, mean, p50, p99, p99.9 and max, for text reports
+void print_histogram_summary(FILE *output, const char *name, const LogHistogram *histogram, const char *unit);
+
+// Writer of one snapshot line. Fields are added between snapshot_begin and
+// snapshot_end in the order they should appear.
+typedef struct {
+    FILE *output;
+    int fields;
+} SnapshotWriter;
+
+void snapshot_begin(SnapshotWriter *writer, FILE *output, const char *source, double seconds);
+void snapshot_count(SnapshotWriter *writer, const char *name, uint64_t value);
+void snapshot_ratio(SnapshotWriter *writer, const char *name, double value);
+// A histogram as its summary and the non-empty buckets, as [low, high, count]
+void snapshot_histogram(SnapshotWriter *writer, const char *name, const LogHistogram *histogram);
+void snapshot_end(SnapshotWriter *writer);
+
+#endif // METRICS_H
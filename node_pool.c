@@ -0,0 +1,80 @@
+#include "node_pool.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdalign.h>
+#include <stddef.h>
+
+#define POOL_SLAB_BYTES (64 * 1024)
+
+// Slab headers are padded so the nodes that follow stay aligned
+#define SLAB_HEADER_SIZE \
+    ((sizeof(PoolSlab) + alignof(max_align_t) - 1) / alignof(max_align_t) * alignof(max_align_t))
+
+void pool_init(NodePool *pool, const char *name, size_t node_size) {
+    size_t alignment = alignof(max_align_t);
+    if (node_size < sizeof(void *)) {
+        node_size = sizeof(void *);
+    }
+    pool->name = name;
+    pool->node_size = (node_size + alignment - 1) / alignment * alignment;
+    pool->nodes_per_slab = (POOL_SLAB_BYTES - SLAB_HEADER_SIZE) / pool->node_size;
+    if (pool->nodes_per_slab == 0) {
+        pool->nodes_per_slab = 1;
+    }
+    pool->free_list = NULL;
+    pool->slabs = NULL;
+    pool->bump = pool->bump_end = NULL;
+    pool->slab_count = pool->in_use = pool->peak_in_use = 0;
+}
+
+// Hand out a node: recycled first, then from the current slab, and only
+// when both are exhausted fall back to malloc for a new slab
+void *pool_alloc(NodePool *pool) {
+    void *node = pool->free_list;
+    if (node) {
+        pool->free_list = *(void **)node;
+    } else {
+        if (pool->bump == pool->bump_end) {
+            PoolSlab *slab = malloc(SLAB_HEADER_SIZE + pool->nodes_per_slab * pool->node_size);
+            if (!slab) {
+                fprintf(stderr, "Memory allocation failed for %s pool.\n", pool->name);
+                exit(1);
+            }
+            slab->next = pool->slabs;
+            pool->slabs = slab;
+            pool->slab_count++;
+            pool->bump = (char *)slab + SLAB_HEADER_SIZE;
+            pool->bump_end = pool->bump + pool->nodes_per_slab * pool->node_size;
+        }
+        node = pool->bump;
+        pool->bump += pool->node_size;
+    }
+    if (++pool->in_use > pool->peak_in_use) {
+        pool->peak_in_use = pool->in_use;
+    }
+    return node;
+}
+
+void pool_free(NodePool *pool, void *node) {
+    *(void **)node = pool->free_list;
+    pool->free_list = node;
+    pool->in_use--;
+}
+
+void pool_destroy(NodePool *pool) {
+    while (pool->slabs) {
+        PoolSlab *next = pool->slabs->next;
+        free(pool->slabs);
+        pool->slabs = next;
+    }
+    pool_init(pool, pool->name, pool->node_size);
+}
+
+void print_pool_stats(const NodePool *pool) {
+    size_t capacity = pool->slab_count * pool->nodes_per_slab;
+    printf("  %-14s %8zu in use / %8zu capacity (%5.1f%%), peak %zu, %zu slab(s) of %zu B\n",
+           pool->name, pool->in_use, capacity,
+           capacity ? 100.0 * (double)pool->in_use / (double)capacity : 0.0,
+           pool->peak_in_use, pool->slab_count,
+           SLAB_HEADER_SIZE + pool->nodes_per_slab * pool->node_size);
+}
@@ -0,0 +1,30 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <stddef.h>
+
+// Fixed-size node allocator for the simulator's bookkeeping structures.
+// Nodes are carved out of large slabs, returned nodes are recycled through
+// a free list, and every slab is released at once by pool_destroy.
+
+typedef struct PoolSlab {
+    struct PoolSlab *next;
+} PoolSlab;
+
+typedef struct {
+    const char *name;
+    size_t node_size, nodes_per_slab;
+    void *free_list;       // Recycled nodes, linked through their first word
+    PoolSlab *slabs;
+    char *bump, *bump_end; // Never-used tail of the newest slab
+    size_t slab_count, in_use, peak_in_use;
+} NodePool;
+
+void pool_init(NodePool *pool, const char *name, size_t node_size);
+void *pool_alloc(NodePool *pool);
+void pool_free(NodePool *pool, void *node);
+// Release every slab, invalidating all nodes handed out by the pool
+void pool_destroy(NodePool *pool);
+void print_pool_stats(const NodePool *pool);
+
+#endif // NODE_POOL_H
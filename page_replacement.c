@@ -0,0 +1,232 @@
+#include "page_replacement.h"
+#include <stdlib.h>
+#include <string.h>
+
+enum { LIST_NONE, LIST_T1, LIST_T2, LIST_B1, LIST_B2 };
+#define LRU_LIST LIST_T1
+
+static const char *policy_names[POLICY_COUNT] = {"fifo", "lru", "clock", "arc"};
+
+int parse_replacement_policy(const char *name) {
+    for (int i = 0; i < POLICY_COUNT; i++) {
+        if (strcmp(name, policy_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+const char *replacement_policy_name(ReplacementPolicy policy) {
+    return policy_names[policy];
+}
+
+int replacer_init(PageReplacer *replacer, ReplacementPolicy policy, uint32_t frame_count, uint32_t page_count,
+                  uint32_t *page_table) {
+    memset(replacer, 0, sizeof(*replacer));
+    replacer->policy = policy;
+    replacer->frame_count = frame_count;
+    replacer->page_count = page_count;
+    replacer->page_table = page_table;
+    replacer->last_evicted = NOT_PRESENT;
+    for (uint32_t page = 0; page < page_count; page++) {
+        page_table[page] = NOT_PRESENT;
+    }
+    for (int i = 0; i < 5; i++) {
+        replacer->lists[i] = (PageList){NOT_PRESENT, NOT_PRESENT, 0};
+    }
+    replacer->frame_page = malloc((frame_count ? frame_count : 1) * sizeof(uint32_t));
+    if (!replacer->frame_page) return 0;
+    if (policy == POLICY_CLOCK) {
+        replacer->referenced = calloc(frame_count ? frame_count : 1, 1);
+        if (!replacer->referenced) return 0;
+    }
+    if (policy == POLICY_LRU || policy == POLICY_ARC) {
+        replacer->previous = malloc((page_count ? page_count : 1) * sizeof(uint32_t));
+        replacer->next = malloc((page_count ? page_count : 1) * sizeof(uint32_t));
+        replacer->list = calloc(page_count ? page_count : 1, 1);
+        if (!replacer->previous || !replacer->next || !replacer->list) return 0;
+    }
+    return 1;
+}
+
+void replacer_destroy(PageReplacer *replacer) {
+    free(replacer->frame_page);
+    free(replacer->referenced);
+    free(replacer->previous);
+    free(replacer->next);
+    free(replacer->list);
+    replacer->frame_page = replacer->previous = replacer->next = NULL;
+    replacer->referenced = replacer->list = NULL;
+}
+
+static void list_remove(PageReplacer *replacer, uint32_t page) {
+    PageList *list = &replacer->lists[replacer->list[page]];
+    uint32_t previous = replacer->previous[page], next = replacer->next[page];
+    if (previous != NOT_PRESENT) replacer->next[previous] = next;
+    else list->head = next;
+    if (next != NOT_PRESENT) replacer->previous[next] = previous;
+    else list->tail = previous;
+    list->size--;
+    replacer->list[page] = LIST_NONE;
+}
+
+static void list_push_head(PageReplacer *replacer, int which, uint32_t page) {
+    PageList *list = &replacer->lists[which];
+    replacer->previous[page] = NOT_PRESENT;
+    replacer->next[page] = list->head;
+    if (list->head != NOT_PRESENT) replacer->previous[list->head] = page;
+    else list->tail = page;
+    list->head = page;
+    list->size++;
+    replacer->list[page] = (uint8_t)which;
+}
+
+// Take a page out of memory and return the frame it held
+static uint32_t evict(PageReplacer *replacer, uint32_t page) {
+    uint32_t frame = replacer->page_table[page];
+    replacer->page_table[page] = NOT_PRESENT;
+    replacer->evictions++;
+    replacer->last_evicted = page;
+    return frame;
+}
+
+static void load(PageReplacer *replacer, uint32_t page, uint32_t frame) {
+    replacer->page_table[page] = frame;
+    replacer->frame_page[frame] = page;
+}
+
+// A frame for a new page when memory is not full yet, NOT_PRESENT otherwise
+static uint32_t unused_frame(PageReplacer *replacer) {
+    return replacer->used_frames < replacer->frame_count ? replacer->used_frames++ : NOT_PRESENT;
+}
+
+static int reference_fifo_clock(PageReplacer *replacer, uint32_t page) {
+    uint32_t frame = replacer->page_table[page];
+    if (frame != NOT_PRESENT) {
+        if (replacer->referenced) replacer->referenced[frame] = 1;
+        return 0;
+    }
+    frame = unused_frame(replacer);
+    if (frame == NOT_PRESENT) {
+        // Frames fill up in order, so the hand always points at the oldest
+        // load; CLOCK skips pages referenced since the hand last passed
+        if (replacer->referenced) {
+            while (replacer->referenced[replacer->hand]) {
+                replacer->referenced[replacer->hand] = 0;
+                replacer->hand = replacer->hand + 1 == replacer->frame_count ? 0 : replacer->hand + 1;
+            }
+        }
+        frame = evict(replacer, replacer->frame_page[replacer->hand]);
+        replacer->hand = replacer->hand + 1 == replacer->frame_count ? 0 : replacer->hand + 1;
+    }
+    load(replacer, page, frame);
+    if (replacer->referenced) replacer->referenced[frame] = 0;
+    return 1;
+}
+
+static int reference_lru(PageReplacer *replacer, uint32_t page) {
+    if (replacer->page_table[page] != NOT_PRESENT) {
+        list_remove(replacer, page);
+        list_push_head(replacer, LRU_LIST, page);
+        return 0;
+    }
+    uint32_t frame = unused_frame(replacer);
+    if (frame == NOT_PRESENT) {
+        uint32_t victim = replacer->lists[LRU_LIST].tail;
+        list_remove(replacer, victim);
+        frame = evict(replacer, victim);
+    }
+    load(replacer, page, frame);
+    list_push_head(replacer, LRU_LIST, page);
+    return 1;
+}
+
+// ARC's REPLACE: evict from T1 or T2 depending on the target, keeping the
+// evicted page as a ghost
+static uint32_t arc_replace(PageReplacer *replacer, int in_b2) {
+    uint32_t t1 = replacer->lists[LIST_T1].size;
+    uint32_t victim;
+    int ghost;
+    if (t1 > 0 && (t1 > replacer->target || (in_b2 && t1 == replacer->target))) {
+        victim = replacer->lists[LIST_T1].tail;
+        ghost = LIST_B1;
+    } else {
+        victim = replacer->lists[LIST_T2].tail;
+        ghost = LIST_B2;
+    }
+    list_remove(replacer, victim);
+    list_push_head(replacer, ghost, victim);
+    return evict(replacer, victim);
+}
+
+static void arc_forget_ghost(PageReplacer *replacer, int which) {
+    list_remove(replacer, replacer->lists[which].tail);
+}
+
+static int reference_arc(PageReplacer *replacer, uint32_t page) {
+    uint32_t c = replacer->frame_count;
+    PageList *lists = replacer->lists;
+    int where = replacer->list[page];
+    if (where == LIST_T1 || where == LIST_T2) {
+        list_remove(replacer, page);
+        list_push_head(replacer, LIST_T2, page);
+        return 0;
+    }
+
+    uint32_t frame;
+    if (where == LIST_B1 || where == LIST_B2) {
+        // A ghost hit: grow the side that would have kept the page
+        uint32_t b1 = lists[LIST_B1].size, b2 = lists[LIST_B2].size;
+        if (where == LIST_B1) {
+            uint32_t step = b1 >= b2 ? 1 : b2 / b1;
+            replacer->target = replacer->target + step > c ? c : replacer->target + step;
+        } else {
+            uint32_t step = b2 >= b1 ? 1 : b1 / b2;
+            replacer->target = replacer->target > step ? replacer->target - step : 0;
+        }
+        list_remove(replacer, page);
+        frame = unused_frame(replacer);
+        if (frame == NOT_PRESENT) frame = arc_replace(replacer, where == LIST_B2);
+        load(replacer, page, frame);
+        list_push_head(replacer, LIST_T2, page);
+        return 1;
+    }
+
+    uint32_t l1 = lists[LIST_T1].size + lists[LIST_B1].size;
+    uint32_t total = l1 + lists[LIST_T2].size + lists[LIST_B2].size;
+    frame = NOT_PRESENT;
+    if (l1 == c) {
+        if (lists[LIST_T1].size < c) {
+            arc_forget_ghost(replacer, LIST_B1);
+            frame = unused_frame(replacer);
+            if (frame == NOT_PRESENT) frame = arc_replace(replacer, 0);
+        } else {
+            // T1 holds everything: drop its oldest page outright
+            uint32_t victim = lists[LIST_T1].tail;
+            list_remove(replacer, victim);
+            frame = evict(replacer, victim);
+        }
+    } else {
+        if (total >= c) {
+            if (total == 2 * c) arc_forget_ghost(replacer, LIST_B2);
+            frame = unused_frame(replacer);
+            if (frame == NOT_PRESENT) frame = arc_replace(replacer, 0);
+        } else {
+            frame = unused_frame(replacer);
+        }
+    }
+    load(replacer, page, frame);
+    list_push_head(replacer, LIST_T1, page);
+    return 1;
+}
+
+int replacer_reference(PageReplacer *replacer, uint32_t page) {
+    int fault;
+    replacer->references++;
+    replacer->last_evicted = NOT_PRESENT;
+    switch (replacer->policy) {
+        case POLICY_LRU: fault = reference_lru(replacer, page); break;
+        case POLICY_ARC: fault = reference_arc(replacer, page); break;
+        default: fault = reference_fifo_clock(replacer, page); break;
+    }
+    replacer->faults += (uint64_t)fault;
+    return fault;
+}
@@ -0,0 +1,55 @@
+#ifndef PAGE_REPLACEMENT_H
+#define PAGE_REPLACEMENT_H
+
+#include <stdint.h>
+
+// Demand paging of one address space into a fixed budget of frames. The
+// page table maps each virtual page to the frame holding it; on a fault
+// with every frame taken, the policy picks the page to evict:
+//   FIFO  - the page loaded longest ago
+//   LRU   - the page referenced longest ago
+//   CLOCK - second chance: a hand sweeps the frames clearing reference bits
+//           and evicts the first page whose bit is already clear
+//   ARC   - adaptive replacement cache: recency (T1) and frequency (T2)
+//           lists, with ghost lists of recently evicted pages (B1, B2)
+//           steering how many frames each side gets
+// Every operation is O(1) per reference; LRU and ARC keep their lists
+// threaded through per-page link arrays.
+
+#define NOT_PRESENT UINT32_MAX
+
+typedef enum { POLICY_FIFO, POLICY_LRU, POLICY_CLOCK, POLICY_ARC, POLICY_COUNT } ReplacementPolicy;
+
+typedef struct {
+    uint32_t head, tail;  // head is the most recent end
+    uint32_t size;
+} PageList;
+
+typedef struct {
+    ReplacementPolicy policy;
+    uint32_t frame_count, page_count;
+    uint32_t *page_table;  // Virtual page -> frame, NOT_PRESENT if not resident
+    uint32_t *frame_page;  // Frame -> virtual page
+    uint32_t used_frames;
+    uint32_t hand;         // FIFO and CLOCK position
+    uint8_t *referenced;   // CLOCK reference bit per frame
+    uint32_t *previous, *next;  // LRU and ARC list links per page
+    uint8_t *list;              // ARC list of each page
+    PageList lists[5];          // LRU uses lists[1]; ARC uses T1, T2, B1, B2
+    uint32_t target;            // ARC's target size of T1
+    uint64_t references, faults, evictions;
+    uint32_t last_evicted;      // Page evicted by the latest reference, NOT_PRESENT if none
+} PageReplacer;
+
+// page_table must hold page_count entries and is reset to NOT_PRESENT.
+// Returns 0 if memory ran out.
+int replacer_init(PageReplacer *replacer, ReplacementPolicy policy, uint32_t frame_count, uint32_t page_count,
+                  uint32_t *page_table);
+void replacer_destroy(PageReplacer *replacer);
+// Reference a virtual page; returns 1 if it faulted
+int replacer_reference(PageReplacer *replacer, uint32_t page);
+// "fifo", "lru", "clock" or "arc"; -1 if unknown
+int parse_replacement_policy(const char *name);
+const char *replacement_policy_name(ReplacementPolicy policy);
+
+#endif // PAGE_REPLACEMENT_H
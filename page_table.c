@@ -0,0 +1,169 @@
+#include "page_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bits of the virtual address indexing a node at the given level (1-4)
+static inline unsigned level_shift(int level) {
+    return PT_PAGE_SHIFT + 9 * (unsigned)(level - 1);
+}
+
+static inline unsigned level_index(uint64_t va, int level) {
+    return (unsigned)(va >> level_shift(level)) & (PT_ENTRIES - 1);
+}
+
+static PageTableNode *new_node(PageTable *table) {
+    PageTableNode *node = calloc(1, sizeof(PageTableNode));
+    if (!node) {
+        fprintf(stderr, "Error: Memory allocation failed for page tables\n");
+        exit(1);
+    }
+    table->node_count++;
+    return node;
+}
+
+static void free_node(PageTable *table, PageTableNode *node) {
+    free(node);
+    table->node_count--;
+}
+
+static inline PageTableNode *child_of(uint64_t entry) {
+    return (PageTableNode *)(uintptr_t)(entry & PTE_ADDRESS);
+}
+
+static inline int is_leaf(uint64_t entry, int level) {
+    return level == 1 || (entry & PTE_HUGE);
+}
+
+void page_table_init(PageTable *table, int largest_leaf) {
+    memset(table, 0, sizeof(*table));
+    table->largest_leaf = largest_leaf;
+    table->root = new_node(table);
+}
+
+static void destroy_node(PageTable *table, PageTableNode *node, int level) {
+    for (unsigned i = 0; level > 1 && i < PT_ENTRIES; i++) {
+        uint64_t entry = node->entries[i];
+        if ((entry & PTE_PRESENT) && !is_leaf(entry, level)) {
+            destroy_node(table, child_of(entry), level - 1);
+        }
+    }
+    free_node(table, node);
+}
+
+void page_table_destroy(PageTable *table) {
+    if (table->root) {
+        destroy_node(table, table->root, PT_LEVELS);
+    }
+    memset(table, 0, sizeof(*table));
+}
+
+static void set_leaf(PageTable *table, PageTableNode *node, unsigned index, int level, uint64_t pa) {
+    node->entries[index] = pa | PTE_PRESENT | (level > 1 ? PTE_HUGE : 0);
+    node->used++;
+    table->leaves[level - 1]++;
+}
+
+// Map from *va onwards within one node, descending where the range is not
+// aligned for a leaf at this level. Advances *va, *pa and *length past
+// what was mapped; stops at the end of the node's span.
+static void map_node(PageTable *table, PageTableNode *node, int level, uint64_t *va, uint64_t *pa,
+                     uint64_t *length) {
+    uint64_t size = 1ull << level_shift(level);
+    for (unsigned index = level_index(*va, level); *length && index < PT_ENTRIES; index++) {
+        uint64_t entry = node->entries[index];
+        if (level - 1 <= table->largest_leaf && level < PT_LEVELS && *length >= size &&
+            ((*va | *pa) & (size - 1)) == 0) {
+            set_leaf(table, node, index, level, *pa);
+            *va += size;
+            *pa += size;
+            *length -= size;
+            continue;
+        }
+        if (!(entry & PTE_PRESENT)) {
+            entry = (uint64_t)(uintptr_t)new_node(table) | PTE_PRESENT;
+            node->entries[index] = entry;
+            node->used++;
+        }
+        map_node(table, child_of(entry), level - 1, va, pa, length);
+    }
+}
+
+void page_table_map(PageTable *table, uint64_t va, uint64_t pa, uint64_t length) {
+    map_node(table, table->root, PT_LEVELS, &va, &pa, &length);
+}
+
+// Replace a huge leaf by a node of leaves one size down covering the same
+// memory, so that part of it can be unmapped
+static PageTableNode *split_leaf(PageTable *table, PageTableNode *node, unsigned index, int level) {
+    PageTableNode *child = new_node(table);
+    uint64_t pa = node->entries[index] & PTE_ADDRESS;
+    uint64_t size = 1ull << level_shift(level - 1);
+    for (unsigned i = 0; i < PT_ENTRIES; i++) {
+        set_leaf(table, child, i, level - 1, pa + i * size);
+    }
+    table->leaves[level - 1]--;
+    node->entries[index] = (uint64_t)(uintptr_t)child | PTE_PRESENT;
+    return child;
+}
+
+static void unmap_node(PageTable *table, PageTableNode *node, int level, uint64_t *va, uint64_t *length) {
+    uint64_t size = 1ull << level_shift(level);
+    for (unsigned index = level_index(*va, level); *length && index < PT_ENTRIES; index++) {
+        uint64_t entry = node->entries[index];
+        uint64_t covered = size - (*va & (size - 1));  // Rest of this entry's span
+        if (covered > *length) covered = *length;
+        if (!(entry & PTE_PRESENT)) {
+            *va += covered;
+            *length -= covered;
+            continue;
+        }
+        if (is_leaf(entry, level) && covered == size) {
+            node->entries[index] = 0;
+            node->used--;
+            table->leaves[level - 1]--;
+            *va += size;
+            *length -= size;
+            continue;
+        }
+        PageTableNode *child = is_leaf(entry, level) ? split_leaf(table, node, index, level) : child_of(entry);
+        unmap_node(table, child, level - 1, va, length);
+        if (child->used == 0) {
+            free_node(table, child);
+            node->entries[index] = 0;
+            node->used--;
+        }
+    }
+}
+
+void page_table_unmap(PageTable *table, uint64_t va, uint64_t length) {
+    unmap_node(table, table->root, PT_LEVELS, &va, &length);
+}
+
+int page_table_translate(const PageTable *table, uint64_t va, uint64_t *pa) {
+    if (va >> PT_ADDRESS_BITS) {
+        return 0;
+    }
+    const PageTableNode *node = table->root;
+    for (int level = PT_LEVELS; level >= 1; level--) {
+        uint64_t entry = node->entries[level_index(va, level)];
+        if (!(entry & PTE_PRESENT)) {
+            return 0;
+        }
+        if (is_leaf(entry, level)) {
+            uint64_t offset = va & ((1ull << level_shift(level)) - 1);
+            *pa = (entry & PTE_ADDRESS) + offset;
+            return PT_LEVELS - level + 1;
+        }
+        node = child_of(entry);
+    }
+    return 0;
+}
+
+uint64_t page_table_mapped_bytes(const PageTable *table) {
+    uint64_t bytes = 0;
+    for (int leaf = 0; leaf < PT_LEAF_SIZES; leaf++) {
+        bytes += table->leaves[leaf] * pt_leaf_bytes(leaf);
+    }
+    return bytes;
+}
@@ -0,0 +1,59 @@
+#ifndef PAGE_TABLE_H
+#define PAGE_TABLE_H
+
+#include <stdint.h>
+
+// Four-level radix page table in the x86-64 layout: a 48-bit virtual
+// address is split into four 9-bit indexes and a 12-bit offset, and each
+// node holds 512 entries. An entry in a level 2 or level 3 node may map a
+// whole 2 MiB or 1 GiB huge page instead of pointing at the next level,
+// which saves both nodes and walk steps.
+//
+// Entries hold a physical address or a child pointer in the upper bits and
+// the flags below in the low two; both are at least 16-byte aligned.
+
+#define PT_ENTRIES 512
+#define PT_LEVELS 4
+#define PT_PAGE_SHIFT 12
+#define PT_ADDRESS_BITS 48
+
+#define PTE_PRESENT 1ull
+#define PTE_HUGE 2ull  // Leaf in a level 2 or 3 node
+#define PTE_ADDRESS (~3ull)
+
+// Leaf sizes, by the level whose entries map them
+enum { PT_LEAF_4K, PT_LEAF_2M, PT_LEAF_1G, PT_LEAF_SIZES };
+
+typedef struct PageTableNode {
+    uint64_t entries[PT_ENTRIES];
+    uint32_t used;  // Present entries; an empty node is freed
+} PageTableNode;
+
+typedef struct {
+    PageTableNode *root;  // Level 4
+    int largest_leaf;     // Biggest leaf size mappings may use
+    uint64_t node_count;  // Including the root
+    uint64_t leaves[PT_LEAF_SIZES];
+} PageTable;
+
+// The size in bytes of a leaf
+static inline uint64_t pt_leaf_bytes(int leaf) {
+    return 1ull << (PT_PAGE_SHIFT + 9 * leaf);
+}
+
+void page_table_init(PageTable *table, int largest_leaf);
+void page_table_destroy(PageTable *table);
+// Map length bytes at va to pa. All three must be 4 KiB aligned and the
+// range must not be mapped yet. Each step uses the biggest leaf that va and
+// pa are both aligned to and that fits in the rest of the range.
+void page_table_map(PageTable *table, uint64_t va, uint64_t pa, uint64_t length);
+// Unmap a 4 KiB aligned range, splitting huge pages it only partly covers
+// and freeing nodes left empty
+void page_table_unmap(PageTable *table, uint64_t va, uint64_t length);
+// Walk the table for va. Returns the number of entries read (4 for a 4 KiB
+// page, 3 for 2 MiB, 2 for 1 GiB) with the physical address in *pa, or 0
+// if va is not mapped.
+int page_table_translate(const PageTable *table, uint64_t va, uint64_t *pa);
+uint64_t page_table_mapped_bytes(const PageTable *table);
+
+#endif // PAGE_TABLE_H
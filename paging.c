@@ -1,234 +1,751 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-#define TOTAL_PAGES 25  
-
-// Structure for pages in memory
-struct page {
-    int address;
-    struct page* next;
-};
-
-// Structure for program loaded into memory
-struct program {
-    char name[15];
-    int size;
-    struct page* pages;
-    struct program* next;
-};
-
-// Function prototypes
-struct page* initialize_pages();
-void display_free_pages(struct page* head);
-struct program* load_program(struct program* head, char name[], int size, struct page** freePages);
-void display_programs(struct program* head);
-void display_memory_state(struct program* head);
-struct program* remove_program(struct program* head, char name[], struct page** freePages);
-int page_count(int size);
-int free_page_count(struct page* head);
-
-// Assembly function prototype
-extern int check_memory_availability(int freePages, int pagesNeeded);
-
-// Color codes for Linux terminal output
-#define RESET "\033[0m"
-#define RED "\033[1;31m"
-#define GREEN "\033[1;32m"
-#define YELLOW "\033[1;33m"
-#define BLUE "\033[1;34m"
-#define MAGENTA "\033[1;35m"
-
-int main() {
-    struct page* freePages = initialize_pages();
-    struct program* programList = NULL;
-    char choice[5], programName[15];
-    int programSize;
-
-    printf("\n%s=== Memory Management by Paging ===%s\n", BLUE, RESET);
-    
-    while (1) {
-        printf("\n\033[35m");
-        printf("                                 +------------------------------------------------------+\n");
-        printf("                                 |                      ~~ MENU ~~                      |\n");
-        printf("                                 +------------------------------------------------------+\n");
-        printf("                                 |         1 . Load a program                           |\n");
-        printf("                                 |         2 . Display free pages                       |\n");
-        printf("                                 |         3 . Display loaded programs                  |\n");
-        printf("                                 |         4 . Display memory state                     |\n");
-        printf("                                 |         5 . Unload a program                         |\n");
-        printf("                                 |         9 . Quit                                     |\n");
-        printf("                                 +------------------------------------------------------+\n");
-        printf("                                 Enter your choice: \033[0m");
-        scanf("%s", choice);
-        if (strcmp(choice, "1") == 0) {
-            printf("Enter program name: ");
-            scanf("%s", programName);
-            printf("Enter program size (in KB): ");
-            scanf("%d", &programSize);
-            programList = load_program(programList, programName, programSize, &freePages);
-
-        } else if (strcmp(choice, "2") == 0) {
-            display_free_pages(freePages);
-
-        } else if (strcmp(choice, "3") == 0) {
-            display_programs(programList);
-
-        } else if (strcmp(choice, "4") == 0) {
-            display_memory_state(programList);
-
-        } else if (strcmp(choice, "5") == 0) {
-            printf("Enter program name to unload: ");
-            scanf("%s", programName);
-            programList = remove_program(programList, programName, &freePages);
-
-        } else if (strcmp(choice, "9") == 0) {
-            printf("%sExiting...%s\n", RED, RESET);
-            break;
-
-        } else {
-            printf("%sInvalid choice! Try again.%s\n", RED, RESET);
-        }
-    }
-
-    return 0;
-}
-
-// Initialize free pages for memory
-struct page* initialize_pages() {
-    struct page* head = NULL, *temp = NULL;
-    for (int i = 1; i <= TOTAL_PAGES; i++) {
-        struct page* newPage = (struct page*)malloc(sizeof(struct page));
-        newPage->address = i;
-        newPage->next = NULL;
-        if (!head) {
-            head = newPage;
-            temp = newPage;
-        } else {
-            temp->next = newPage;
-            temp = temp->next;
-        }
-    }
-    return head;
-}
-
-// Display all free pages
-void display_free_pages(struct page* head) {
-    printf("%sFree Pages:%s ", MAGENTA, RESET);
-    while (head) {
-        printf("%d ", head->address);
-        head = head->next;
-    }
-    printf("\n");
-}
-
-// Calculate number of pages required for a program
-int page_count(int size) {
-    return (size + 99) / 100;  // Each page holds 100 KB, rounding up
-}
-
-// Load program into memory
-struct program* load_program(struct program* head, char name[], int size, struct page** freePages) {
-    int pagesNeeded = page_count(size);
-    int availablePages = free_page_count(*freePages);
-
-    // Call assembly function to check if sufficient memory is available
-    if (!check_memory_availability(availablePages, pagesNeeded)) {
-        printf("%sInsufficient free pages for program %s%s\n", RED, name, RESET);
-        return head;
-    }
-
-    struct program* newProgram = (struct program*)malloc(sizeof(struct program));
-    strcpy(newProgram->name, name);
-    newProgram->size = size;
-    newProgram->next = NULL;
-    newProgram->pages = NULL;
-
-    // Allocate pages to the program
-    struct page* temp = NULL;
-    for (int i = 0; i < pagesNeeded; i++) {
-        struct page* pageToLoad = *freePages;
-        *freePages = (*freePages)->next;
-
-        if (temp) {
-            temp->next = pageToLoad;
-            temp = temp->next;
-        } else {
-            newProgram->pages = pageToLoad;
-            temp = pageToLoad;
-        }
-    }
-    temp->next = NULL;
-
-    // Add program to the program list
-    newProgram->next = head;
-    printf("%sProgram %s loaded successfully%s\n", GREEN, name, RESET);
-    return newProgram;
-}
-
-// Display loaded programs
-void display_programs(struct program* head) {
-    printf("%sLoaded Programs:%s\n", BLUE, RESET);
-    while (head) {
-        printf("- %s (Size: %d KB)\n", head->name, head->size);
-        head = head->next;
-    }
-}
-
-// Display memory state with programs and free pages
-void display_memory_state(struct program* head) {
-    printf("%sMemory State:%s\n", BLUE, RESET);
-    struct page* usedPages[25] = { NULL };
-    while (head) {
-        struct page* temp = head->pages;
-        while (temp) {
-            usedPages[temp->address - 1] = temp;
-            temp = temp->next;
-        }
-        head = head->next;
-    }
-
-    printf("Memory Layout:\n");
-    for (int i = 0; i < TOTAL_PAGES; i++) {
-        if (usedPages[i]) printf("[P] ");
-        else printf("[ ] ");
-    }
-    printf("\n");
-}
-
-// Free pages used by a program and remove from program list
-struct program* remove_program(struct program* head, char name[], struct page** freePages) {
-    struct program* temp = head, *prev = NULL;
-    while (temp) {
-        if (strcmp(temp->name, name) == 0) {
-            // Free pages used by program
-            struct page* pgTemp = temp->pages;
-            while (pgTemp) {
-                struct page* nextPg = pgTemp->next;
-                pgTemp->next = *freePages;
-                *freePages = pgTemp;
-                pgTemp = nextPg;
-            }
-            // Remove program from list
-            if (prev) prev->next = temp->next;
-            else head = temp->next;
-            free(temp);
-            printf("%sProgram %s unloaded successfully%s\n", GREEN, name, RESET);
-            return head;
-        }
-        prev = temp;
-        temp = temp->next;
-    }
-    printf("%sProgram %s not found%s\n", RED, name, RESET);
-    return head;
-}
-
-// Count free pages
-int free_page_count(struct page* head) {
-    int count = 0;
-    while (head) {
-        count++;
-        head = head->next;
-    }
-    return count;
-}
\ No newline at end of file
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "frame_bitmap.h"
+#include "memory_utils.h"
+#include "metrics.h"
+#include "page_replacement.h"
+#include "page_table.h"
+#include "program_index.h"
+#include "reference_trace.h"
+#include "size_parse.h"
+#include "tlb.h"
+
+#define DEFAULT_FRAMES 25
+#define DEFAULT_PAGE_SIZE (128 * 1024)
+#define MIN_PAGE_SIZE (4 * 1024)
+#define MAX_PAGE_SIZE (1024 * 1024 * 1024)
+#define DETAILED_LAYOUT_FRAMES 64  // Larger maps are shown as runs
+#define MAX_LAYOUT_RUNS 40
+#define DEFAULT_TLB_ENTRIES 64
+#define DEFAULT_TLB_WAYS 4
+#define REPLAY_BATCH 65536
+#define PROGRAM_BASE (1ull << 30)  // Where each program's address space starts
+#define TRANSLATION_SAMPLES 1000000
+
+// Bytes per page, a power of two set at startup
+static uint64_t pageSize = DEFAULT_PAGE_SIZE;
+// Largest leaf page tables may map, set at startup
+static int largestLeaf = PT_LEAF_1G;
+static ProgramIndex programIndex;
+static uint32_t nextPid = 1;
+
+// Instrumentation of loads and unloads, on when --metrics names a file.
+// Latencies cover the allocation, mapping and indexing, not the messages.
+static struct {
+    FILE* output;
+    uint64_t every, operations, snapshots, startNs;
+    uint64_t loads, failedLoads, unloads;
+    LogHistogram loadNs, unloadNs, extents;
+} metrics;
+
+// Run of contiguous frames held by a program
+struct extent {
+    uint64_t first;
+    uint64_t count;
+};
+
+// Structure for program loaded into memory
+struct program {
+    char name[15];
+    uint32_t pid;
+    uint64_t size;  // In KB
+    struct extent* extents;
+    int extentCount;
+    uint64_t virtualBase;  // Start of the program's mapped address range
+    PageTable pageTable;
+    uint32_t* replayTable;  // Virtual page -> frame while replaying a trace, allocated on first replay
+    struct program* prev;
+    struct program* next;
+};
+
+// Function prototypes
+void display_free_pages(const FrameBitmap* frames);
+struct program* load_program(struct program* head, char name[], uint64_t size, FrameBitmap* frames);
+void display_programs(struct program* head);
+void display_memory_state(const FrameBitmap* frames);
+void display_page_tables(struct program* head);
+struct program* remove_program(struct program* head, char name[], FrameBitmap* frames);
+uint64_t page_count(uint64_t size);
+void replay_program(char name[], const char* traceFile, const char* policyName, uint32_t frameBudget);
+void write_metrics_snapshot(const FrameBitmap* frames);
+
+// Color codes for Linux terminal output
+#define RESET "\033[0m"
+#define RED "\033[1;31m"
+#define GREEN "\033[1;32m"
+#define YELLOW "\033[1;33m"
+#define BLUE "\033[1;34m"
+#define MAGENTA "\033[1;35m"
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--page-size SIZE[K|M|G]] [--memory SIZE[K|M|G|T]] [--huge-pages 4K|2M|1G]\n",
+            program);
+    fprintf(stderr, "       page size: a power of two from 4K to 1G (default 128K)\n");
+    fprintf(stderr, "       huge pages: the largest page-table leaf mappings may use (default 1G)\n");
+    fprintf(stderr, "       memory: physical memory, a multiple of the page size (default %d pages)\n",
+            DEFAULT_FRAMES);
+    fprintf(stderr, "       %s --replay TRACE [--policy fifo|lru|clock|arc|all] [--frames N] [--pages N]\n"
+                    "           [--tlb-entries N] [--tlb-ways N]\n", program);
+    fprintf(stderr, "       replay a reference trace against N frames (default: all of memory); 0 TLB entries\n"
+                    "       disables the TLB (default %d entries, %d ways)\n", DEFAULT_TLB_ENTRIES, DEFAULT_TLB_WAYS);
+    fprintf(stderr, "       %s --convert-trace TEXT BINARY\n", program);
+    fprintf(stderr, "       add --metrics FILE [--metrics-every N] to write latency and fragmentation snapshots\n"
+                    "       every N loads and unloads (default 1, 0 for only at exit)\n");
+}
+
+// Parse a count that must fit below NOT_PRESENT, exiting on anything else
+static uint32_t parse_count(const char *program, const char *text) {
+    char *end;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (*end != '\0' || end == text || value >= NOT_PRESENT) {
+        print_usage(program);
+        exit(1);
+    }
+    return (uint32_t)value;
+}
+
+static double elapsed_seconds(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void print_replay_header(void) {
+    printf("%-6s %14s %14s %8s %14s %8s %12s %8s\n", "policy", "references", "faults", "hit %", "evictions",
+           "TLB %", "refs/s", "ns/ref");
+}
+
+// Replay a trace from its start under one policy and print a line of
+// results. Every reference goes through the TLB first and then to the
+// policy, which sees hits as well as faults; an evicted page loses its
+// TLB entry. Returns 0 if the trace is malformed or names a page past
+// pages.
+static int replay_trace(ReferenceReader* reader, uint32_t* pageTable, uint32_t pages, ReplacementPolicy policy,
+                        uint32_t frameBudget, uint32_t tlbEntries, uint32_t tlbWays) {
+    static uint32_t batch[REPLAY_BATCH];
+    PageReplacer replacer;
+    Tlb tlb;
+    if (!replacer_init(&replacer, policy, frameBudget, pages, pageTable)) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        exit(1);
+    }
+    if (tlbEntries && !tlb_init(&tlb, tlbEntries, tlbWays)) {
+        fprintf(stderr, "Error: TLB needs entries / ways to be a power of two\n");
+        exit(1);
+    }
+
+    reference_trace_rewind(reader);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    long count;
+    int valid = 1;
+    while (valid && (count = reference_trace_read(reader, batch, REPLAY_BATCH)) > 0) {
+        for (long i = 0; i < count; i++) {
+            uint32_t page = batch[i];
+            if (page >= pages) {
+                fprintf(stderr, "%sReference %llu: page %u is outside the %u-page address space%s\n", RED,
+                        (unsigned long long)(reader->references - (uint64_t)count + (uint64_t)i + 1), page, pages,
+                        RESET);
+                valid = 0;
+                break;
+            }
+            if (tlbEntries) tlb_access(&tlb, page);
+            if (replacer_reference(&replacer, page) && tlbEntries && replacer.last_evicted != NOT_PRESENT) {
+                tlb_invalidate(&tlb, replacer.last_evicted);
+            }
+        }
+    }
+    if (valid && count < 0) {
+        fprintf(stderr, "%sMalformed reference after %llu references%s\n", RED,
+                (unsigned long long)reader->references, RESET);
+        valid = 0;
+    }
+    double seconds = elapsed_seconds(&start);
+
+    if (valid) {
+        uint64_t references = replacer.references;
+        double perReference = references ? 100.0 / (double)references : 0;
+        printf("%-6s %14llu %14llu %7.2f%% %14llu ", replacement_policy_name(policy),
+               (unsigned long long)references, (unsigned long long)replacer.faults,
+               (double)(references - replacer.faults) * perReference, (unsigned long long)replacer.evictions);
+        if (tlbEntries) printf("%7.2f%% ", (double)tlb.hits * perReference);
+        else printf("%8s ", "-");
+        printf("%12.0f %8.2f\n", seconds > 0 ? references / seconds : 0,
+               references ? seconds * 1e9 / (double)references : 0);
+    }
+    if (tlbEntries) tlb_destroy(&tlb);
+    replacer_destroy(&replacer);
+    return valid;
+}
+
+// Replay under one policy, or under each in turn when policy is -1
+static int replay_policies(ReferenceReader* reader, uint32_t* pageTable, uint32_t pages, int policy,
+                           uint32_t frameBudget, uint32_t tlbEntries, uint32_t tlbWays) {
+    printf("%u pages, %u frames, ", pages, frameBudget);
+    if (tlbEntries) printf("%u-entry %u-way TLB\n", tlbEntries, tlbWays);
+    else printf("no TLB\n");
+    print_replay_header();
+    for (int p = 0; p < POLICY_COUNT; p++) {
+        if ((policy < 0 || p == policy) &&
+            !replay_trace(reader, pageTable, pages, (ReplacementPolicy)p, frameBudget, tlbEntries, tlbWays)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// The address space a trace needs: one past its highest page
+static uint32_t trace_pages(ReferenceReader* reader) {
+    static uint32_t batch[REPLAY_BATCH];
+    uint32_t highest = 0;
+    long count;
+    reference_trace_rewind(reader);
+    while ((count = reference_trace_read(reader, batch, REPLAY_BATCH)) > 0) {
+        for (long i = 0; i < count; i++) {
+            if (batch[i] > highest) highest = batch[i];
+        }
+    }
+    if (count < 0) {
+        fprintf(stderr, "Error: malformed reference after %llu references\n", (unsigned long long)reader->references);
+        exit(1);
+    }
+    return highest + 1;
+}
+
+// Batch mode: replay a trace file and exit
+static int replay_main(const char* program, const char* traceFile, int policy, uint32_t frameBudget, uint32_t pages,
+                       uint32_t tlbEntries, uint32_t tlbWays) {
+    ReferenceReader reader;
+    if (reference_trace_open(&reader, traceFile) < 0) {
+        return 1;
+    }
+    if (pages == 0) {
+        pages = trace_pages(&reader);
+    }
+    if (frameBudget == 0) {
+        print_usage(program);
+        exit(1);
+    }
+    uint32_t* pageTable = malloc((size_t)pages * sizeof(uint32_t));
+    if (!pageTable) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        exit(1);
+    }
+    int status = replay_policies(&reader, pageTable, pages, policy, frameBudget, tlbEntries, tlbWays) ? 0 : 1;
+    free(pageTable);
+    reference_trace_close(&reader);
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    FrameBitmap frames;
+    struct program* programList = NULL;
+    char choice[5], programName[15];
+    uint64_t programSize, memorySize = 0;
+    const char* replayFile = NULL;
+    int replayPolicy = -1;
+    uint32_t frameBudget = 0, replayPages = 0, tlbEntries = DEFAULT_TLB_ENTRIES, tlbWays = DEFAULT_TLB_WAYS;
+    const char* metricsFile = NULL;
+    metrics.every = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--page-size") == 0 && i + 1 < argc) {
+            pageSize = parse_size(argv[++i]);
+        } else if (strcmp(argv[i], "--huge-pages") == 0 && i + 1 < argc) {
+            uint64_t leafSize = parse_size(argv[++i]);
+            for (largestLeaf = PT_LEAF_4K; largestLeaf < PT_LEAF_SIZES; largestLeaf++) {
+                if (pt_leaf_bytes(largestLeaf) == leafSize) break;
+            }
+            if (largestLeaf == PT_LEAF_SIZES) {
+                print_usage(argv[0]);
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayFile = argv[++i];
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            i++;
+            replayPolicy = strcmp(argv[i], "all") == 0 ? -1 : parse_replacement_policy(argv[i]);
+            if (replayPolicy < 0 && strcmp(argv[i], "all") != 0) {
+                print_usage(argv[0]);
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frameBudget = parse_count(argv[0], argv[++i]);
+        } else if (strcmp(argv[i], "--pages") == 0 && i + 1 < argc) {
+            replayPages = parse_count(argv[0], argv[++i]);
+        } else if (strcmp(argv[i], "--tlb-entries") == 0 && i + 1 < argc) {
+            tlbEntries = parse_count(argv[0], argv[++i]);
+        } else if (strcmp(argv[i], "--tlb-ways") == 0 && i + 1 < argc) {
+            tlbWays = parse_count(argv[0], argv[++i]);
+        } else if (strcmp(argv[i], "--convert-trace") == 0 && i + 2 < argc) {
+            return convert_reference_trace(argv[i + 1], argv[i + 2]) < 0 ? 1 : 0;
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metricsFile = argv[++i];
+        } else if (strcmp(argv[i], "--metrics-every") == 0 && i + 1 < argc) {
+            metrics.every = parse_count(argv[0], argv[++i]);
+        } else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc) {
+            memorySize = parse_size(argv[++i]);
+            if (memorySize == 0) {
+                print_usage(argv[0]);
+                exit(1);
+            }
+        } else {
+            print_usage(argv[0]);
+            exit(1);
+        }
+    }
+    if (pageSize < MIN_PAGE_SIZE || pageSize > MAX_PAGE_SIZE || (pageSize & (pageSize - 1)) != 0) {
+        fprintf(stderr, "Error: page size must be a power of two from 4K to 1G\n");
+        exit(1);
+    }
+    if (memorySize == 0) {
+        memorySize = DEFAULT_FRAMES * pageSize;
+    }
+    if (memorySize % pageSize != 0) {
+        fprintf(stderr, "Error: memory size must be a multiple of the page size\n");
+        exit(1);
+    }
+    if (replayFile) {
+        if (frameBudget == 0) {
+            frameBudget = memorySize / pageSize >= NOT_PRESENT ? NOT_PRESENT - 1 : (uint32_t)(memorySize / pageSize);
+        }
+        return replay_main(argv[0], replayFile, replayPolicy, frameBudget, replayPages, tlbEntries, tlbWays);
+    }
+    if (!frames_init(&frames, memorySize / pageSize)) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        exit(1);
+    }
+    index_init(&programIndex);
+    if (metricsFile) {
+        metrics.output = fopen(metricsFile, "w");
+        if (!metrics.output) {
+            perror(metricsFile);
+            exit(1);
+        }
+        histogram_init(&metrics.loadNs);
+        histogram_init(&metrics.unloadNs);
+        histogram_init(&metrics.extents);
+        metrics.startNs = metrics_now_ns();
+    }
+
+    printf("\n%s=== Memory Management by Paging ===%s\n", BLUE, RESET);
+    printf("%llu frames of %llu KB (%llu KB of physical memory)\n", (unsigned long long)frames.frame_count,
+           (unsigned long long)(pageSize >> 10), (unsigned long long)(memorySize >> 10));
+    static const char* levelNames[SIMD_LEVELS] = {"scalar", "AVX2", "AVX-512"};
+    printf("Frame scans use the %s kernels\n", levelNames[memory_utils_level()]);
+    
+    while (1) {
+        printf("\n\033[35m");
+        printf("                                 +------------------------------------------------------+\n");
+        printf("                                 |                      ~~ MENU ~~                      |\n");
+        printf("                                 +------------------------------------------------------+\n");
+        printf("                                 |         1 . Load a program                           |\n");
+        printf("                                 |         2 . Display free pages                       |\n");
+        printf("                                 |         3 . Display loaded programs                  |\n");
+        printf("                                 |         4 . Display memory state                     |\n");
+        printf("                                 |         5 . Unload a program                         |\n");
+        printf("                                 |         6 . Replay a reference trace                 |\n");
+        printf("                                 |         7 . Display page tables                      |\n");
+        printf("                                 |         9 . Quit                                     |\n");
+        printf("                                 +------------------------------------------------------+\n");
+        printf("                                 Enter your choice: \033[0m");
+        scanf("%s", choice);
+        if (strcmp(choice, "1") == 0) {
+            printf("Enter program name: ");
+            scanf("%s", programName);
+            printf("Enter program size (in KB): ");
+            if (scanf("%llu", (unsigned long long*)&programSize) != 1) {
+                printf("%sInvalid program size%s\n", RED, RESET);
+                while (getchar() != '\n'); // Clear invalid input
+                continue;
+            }
+            programList = load_program(programList, programName, programSize, &frames);
+            if (metrics.output && metrics.every && ++metrics.operations % metrics.every == 0) {
+                write_metrics_snapshot(&frames);
+            }
+
+        } else if (strcmp(choice, "2") == 0) {
+            display_free_pages(&frames);
+
+        } else if (strcmp(choice, "3") == 0) {
+            display_programs(programList);
+
+        } else if (strcmp(choice, "4") == 0) {
+            display_memory_state(&frames);
+
+        } else if (strcmp(choice, "5") == 0) {
+            printf("Enter program name or PID to unload: ");
+            scanf("%s", programName);
+            programList = remove_program(programList, programName, &frames);
+            if (metrics.output && metrics.every && ++metrics.operations % metrics.every == 0) {
+                write_metrics_snapshot(&frames);
+            }
+
+        } else if (strcmp(choice, "6") == 0) {
+            char traceFile[256], policyName[8];
+            unsigned int frameBudget;
+            printf("Enter program name: ");
+            scanf("%14s", programName);
+            printf("Enter trace file: ");
+            scanf("%255s", traceFile);
+            printf("Enter policy (fifo, lru, clock, arc or all): ");
+            scanf("%7s", policyName);
+            printf("Enter frame budget: ");
+            if (scanf("%u", &frameBudget) != 1) {
+                printf("%sInvalid frame budget%s\n", RED, RESET);
+                while (getchar() != '\n'); // Clear invalid input
+                continue;
+            }
+            replay_program(programName, traceFile, policyName, frameBudget);
+
+        } else if (strcmp(choice, "7") == 0) {
+            display_page_tables(programList);
+
+        } else if (strcmp(choice, "9") == 0) {
+            printf("%sExiting...%s\n", RED, RESET);
+            if (metrics.output) {
+                write_metrics_snapshot(&frames);
+                fclose(metrics.output);
+            }
+            break;
+
+        } else {
+            printf("%sInvalid choice! Try again.%s\n", RED, RESET);
+        }
+    }
+
+    return 0;
+}
+
+// Print the frames from first to end - 1 (shown 1-based) as a range
+static void print_run(uint64_t first, uint64_t end) {
+    if (end - first == 1) printf("%llu ", (unsigned long long)first + 1);
+    else printf("%llu-%llu ", (unsigned long long)first + 1, (unsigned long long)end);
+}
+
+// Display all free pages, as ranges of consecutive frames
+void display_free_pages(const FrameBitmap* frames) {
+    printf("%sFree Pages:%s ", MAGENTA, RESET);
+    int runs = 0;
+    uint64_t first = frame_next_free(frames, 0);
+    while (first != NO_FRAME && runs < MAX_LAYOUT_RUNS) {
+        uint64_t end = frame_next_used(frames, first);
+        print_run(first, end);
+        runs++;
+        first = frame_next_free(frames, end);
+    }
+    if (first != NO_FRAME) printf("...");
+    printf("\n%llu of %llu frames free\n", (unsigned long long)frames_free(frames),
+           (unsigned long long)frames->frame_count);
+}
+
+// Calculate number of pages required for a program
+uint64_t page_count(uint64_t size) {
+    uint64_t pageKB = pageSize >> 10;
+    return (size + pageKB - 1) / pageKB;  // Rounding up to whole pages
+}
+
+// Append a frame to a program, extending its last extent when adjacent
+static int add_frame(struct program* program, uint64_t frame, int* capacity) {
+    struct extent* last = program->extentCount ? &program->extents[program->extentCount - 1] : NULL;
+    if (last && last->first + last->count == frame) {
+        last->count++;
+        return 1;
+    }
+    if (program->extentCount == *capacity) {
+        int grown = *capacity ? *capacity * 2 : 4;
+        struct extent* extents = realloc(program->extents, grown * sizeof(struct extent));
+        if (!extents) return 0;
+        program->extents = extents;
+        *capacity = grown;
+    }
+    program->extents[program->extentCount++] = (struct extent){frame, 1};
+    return 1;
+}
+
+// Map a program's extents one after another into its address space. The
+// range starts as far into a 1 GiB region as the first extent is into
+// physical memory, so that aligned physical runs line up for huge pages.
+static void map_program(struct program* program) {
+    page_table_init(&program->pageTable, largestLeaf);
+    uint64_t first = program->extents[0].first * pageSize;
+    program->virtualBase = PROGRAM_BASE + (first & (PROGRAM_BASE - 1));
+    uint64_t va = program->virtualBase;
+    for (int i = 0; i < program->extentCount; i++) {
+        uint64_t length = program->extents[i].count * pageSize;
+        page_table_map(&program->pageTable, va, program->extents[i].first * pageSize, length);
+        va += length;
+    }
+}
+
+// Find a loaded program by name or, failing that, by PID
+static struct program* find_program(const char* nameOrPid) {
+    struct program* program = index_find_name(&programIndex, nameOrPid);
+    if (!program) {
+        char* end;
+        unsigned long pid = strtoul(nameOrPid, &end, 10);
+        if (*end == '\0' && end != nameOrPid && pid <= UINT32_MAX) {
+            program = index_find_pid(&programIndex, (uint32_t)pid);
+        }
+    }
+    return program;
+}
+
+// Load program into memory
+struct program* load_program(struct program* head, char name[], uint64_t size, FrameBitmap* frames) {
+    uint64_t startNs = metrics.output ? metrics_now_ns() : 0;
+    if (size == 0) {
+        printf("%sInvalid program size%s\n", RED, RESET);
+        metrics.failedLoads++;
+        return head;
+    }
+    if (index_find_name(&programIndex, name)) {
+        printf("%sProgram %s is already loaded%s\n", RED, name, RESET);
+        metrics.failedLoads++;
+        return head;
+    }
+    uint64_t pagesNeeded = page_count(size);
+
+    // Call assembly function to check if sufficient memory is available
+    if (!check_memory_availability((long)frames_free(frames), (long)pagesNeeded)) {
+        printf("%sInsufficient free pages for program %s%s\n", RED, name, RESET);
+        metrics.failedLoads++;
+        return head;
+    }
+
+    struct program* newProgram = (struct program*)malloc(sizeof(struct program));
+    if (!newProgram) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        exit(1);
+    }
+    strcpy(newProgram->name, name);
+    newProgram->pid = nextPid++;
+    newProgram->size = size;
+    newProgram->prev = NULL;
+    newProgram->next = NULL;
+    newProgram->extents = NULL;
+    newProgram->extentCount = 0;
+    newProgram->replayTable = NULL;
+
+    // Allocate pages to the program: one contiguous run if there is one,
+    // otherwise whichever frames are free
+    int capacity = 0;
+    uint64_t first = frame_alloc_run(frames, pagesNeeded);
+    if (first != NO_FRAME) {
+        newProgram->extents = malloc(sizeof(struct extent));
+        if (!newProgram->extents) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            exit(1);
+        }
+        newProgram->extents[0] = (struct extent){first, pagesNeeded};
+        newProgram->extentCount = 1;
+    } else {
+        for (uint64_t i = 0; i < pagesNeeded; i++) {
+            if (!add_frame(newProgram, frame_alloc(frames), &capacity)) {
+                fprintf(stderr, "Error: Memory allocation failed\n");
+                exit(1);
+            }
+        }
+    }
+
+    map_program(newProgram);
+
+    // Add program to the program list and the index
+    newProgram->next = head;
+    if (head) head->prev = newProgram;
+    index_insert(&programIndex, newProgram->name, newProgram->pid, newProgram);
+    if (metrics.output) {
+        histogram_record(&metrics.loadNs, metrics_now_ns() - startNs);
+        histogram_record(&metrics.extents, (uint64_t)newProgram->extentCount);
+        metrics.loads++;
+    }
+    printf("%sProgram %s loaded successfully (PID %u)%s\n", GREEN, name, newProgram->pid, RESET);
+    return newProgram;
+}
+
+// Display loaded programs
+void display_programs(struct program* head) {
+    printf("%sLoaded Programs:%s\n", BLUE, RESET);
+    while (head) {
+        printf("- %s (PID %u, Size: %llu KB, %d extent(s))\n", head->name, head->pid,
+               (unsigned long long)head->size, head->extentCount);
+        head = head->next;
+    }
+}
+
+// Display memory state with programs and free pages. Small maps show
+// every frame; larger ones show alternating runs of used and free frames.
+void display_memory_state(const FrameBitmap* frames) {
+    printf("%sMemory State:%s\n", BLUE, RESET);
+    printf("Memory Layout:\n");
+    if (frames->frame_count <= DETAILED_LAYOUT_FRAMES) {
+        for (uint64_t i = 0; i < frames->frame_count; i++) {
+            if (!frame_is_free(frames, i)) printf("[P] ");
+            else printf("[ ] ");
+        }
+        printf("\n");
+        return;
+    }
+    uint64_t first = 0;
+    int runs = 0;
+    while (first < frames->frame_count && runs < MAX_LAYOUT_RUNS) {
+        int free = frame_is_free(frames, first);
+        uint64_t end = free ? frame_next_used(frames, first) : frame_next_free(frames, first);
+        if (end == NO_FRAME) end = frames->frame_count;
+        printf("%s %12llu - %-12llu %12llu frames  %10llu MB\n", free ? "[ ]" : "[P]", (unsigned long long)first + 1,
+               (unsigned long long)end, (unsigned long long)(end - first),
+               (unsigned long long)((end - first) * pageSize >> 20));
+        first = end;
+        runs++;
+    }
+    if (first < frames->frame_count) {
+        printf("... %llu more frames\n", (unsigned long long)(frames->frame_count - first));
+    }
+}
+
+// Replay a reference trace against a loaded program's address space,
+// keeping at most frameBudget of its pages resident
+void replay_program(char name[], const char* traceFile, const char* policyName, uint32_t frameBudget) {
+    struct program* head = find_program(name);
+    if (!head) {
+        printf("%sProgram %s not found%s\n", RED, name, RESET);
+        return;
+    }
+    int policy = strcmp(policyName, "all") == 0 ? -1 : parse_replacement_policy(policyName);
+    if (policy < 0 && strcmp(policyName, "all") != 0) {
+        printf("%sUnknown policy %s%s\n", RED, policyName, RESET);
+        return;
+    }
+    uint64_t pages = page_count(head->size);
+    if (pages >= NOT_PRESENT) {
+        printf("%sProgram %s has too many pages to replay%s\n", RED, name, RESET);
+        return;
+    }
+    if (frameBudget == 0 || frameBudget > pages) {
+        printf("%sFrame budget must be between 1 and the program's %llu pages%s\n", RED,
+               (unsigned long long)pages, RESET);
+        return;
+    }
+    if (!head->replayTable) {
+        head->replayTable = malloc(pages * sizeof(uint32_t));
+        if (!head->replayTable) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            exit(1);
+        }
+    }
+    ReferenceReader reader;
+    if (reference_trace_open(&reader, traceFile) < 0) {
+        return;
+    }
+    replay_policies(&reader, head->replayTable, (uint32_t)pages, policy, frameBudget, DEFAULT_TLB_ENTRIES,
+                    DEFAULT_TLB_WAYS);
+    reference_trace_close(&reader);
+}
+
+// Free pages used by a program and remove from program list
+struct program* remove_program(struct program* head, char name[], FrameBitmap* frames) {
+    uint64_t startNs = metrics.output ? metrics_now_ns() : 0;
+    struct program* temp = find_program(name);
+    if (!temp) {
+        printf("%sProgram %s not found%s\n", RED, name, RESET);
+        return head;
+    }
+    // Unmap and free pages used by program
+    uint64_t va = temp->virtualBase;
+    for (int i = 0; i < temp->extentCount; i++) {
+        uint64_t length = temp->extents[i].count * pageSize;
+        page_table_unmap(&temp->pageTable, va, length);
+        frame_free_run(frames, temp->extents[i].first, temp->extents[i].count);
+        va += length;
+    }
+    page_table_destroy(&temp->pageTable);
+    index_remove(&programIndex, temp->name, temp->pid);
+    // Remove program from list
+    if (temp->prev) temp->prev->next = temp->next;
+    else head = temp->next;
+    if (temp->next) temp->next->prev = temp->prev;
+    if (metrics.output) {
+        histogram_record(&metrics.unloadNs, metrics_now_ns() - startNs);
+        metrics.unloads++;
+    }
+    printf("%sProgram %s unloaded successfully%s\n", GREEN, temp->name, RESET);
+    free(temp->extents);
+    free(temp->replayTable);
+    free(temp);
+    return head;
+}
+
+// Append a snapshot of the load and unload metrics and of how scattered
+// the free frames are. External fragmentation is the share of free frames
+// outside the largest free run.
+void write_metrics_snapshot(const FrameBitmap* frames) {
+    uint64_t freeRuns = 0, largestRun = 0;
+    uint64_t first = frame_next_free(frames, 0);
+    while (first != NO_FRAME) {
+        uint64_t end = frame_next_used(frames, first);
+        if (end - first > largestRun) largestRun = end - first;
+        freeRuns++;
+        first = frame_next_free(frames, end);
+    }
+    uint64_t freeFrames = frames_free(frames);
+    SnapshotWriter writer;
+    snapshot_begin(&writer, metrics.output, "memory_manager", (double)(metrics_now_ns() - metrics.startNs) / 1e9);
+    snapshot_count(&writer, "snapshot", metrics.snapshots++);
+    snapshot_count(&writer, "loads", metrics.loads);
+    snapshot_count(&writer, "failed_loads", metrics.failedLoads);
+    snapshot_count(&writer, "unloads", metrics.unloads);
+    snapshot_count(&writer, "loaded_programs", programIndex.live);
+    snapshot_count(&writer, "free_frames", freeFrames);
+    snapshot_count(&writer, "free_runs", freeRuns);
+    snapshot_count(&writer, "largest_free_run", largestRun);
+    snapshot_ratio(&writer, "external_fragmentation", freeFrames ? 1.0 - (double)largestRun / (double)freeFrames : 0.0);
+    snapshot_histogram(&writer, "load_ns", &metrics.loadNs);
+    snapshot_histogram(&writer, "unload_ns", &metrics.unloadNs);
+    snapshot_histogram(&writer, "extents_per_load", &metrics.extents);
+    snapshot_end(&writer);
+}
+
+// Show each program's page tables: leaves by size, how much memory the
+// tables take, and what a TLB miss costs: the entries read and the time
+// per walk, over random addresses in the program's range.
+void display_page_tables(struct program* head) {
+    static const char* leafNames[PT_LEAF_SIZES] = {"4K", "2M", "1G"};
+    uint64_t totalNodes = 0, totalMapped = 0, totalLeaves = 0;
+    printf("%sPage Tables:%s (leaves up to %s)\n", BLUE, RESET, leafNames[largestLeaf]);
+    printf("%-6s %-14s %10s %10s %10s %10s %12s %8s %6s %8s\n", "PID", "name", "4K", "2M", "1G", "nodes",
+           "table KB", "overhead", "walk", "ns/walk");
+    for (; head; head = head->next) {
+        const PageTable* table = &head->pageTable;
+        uint64_t mapped = page_table_mapped_bytes(table);
+        for (int leaf = 0; leaf < PT_LEAF_SIZES; leaf++) {
+            totalLeaves += table->leaves[leaf];
+        }
+
+        uint64_t state = 0x9E3779B97F4A7C15ull ^ head->pid, reads = 0, physical;
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < TRANSLATION_SAMPLES; i++) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            reads += (uint64_t)page_table_translate(table, head->virtualBase + state % mapped, &physical);
+        }
+        double seconds = elapsed_seconds(&start);
+
+        uint64_t tableBytes = table->node_count * sizeof(((PageTableNode*)0)->entries);
+        printf("%-6u %-14s %10llu %10llu %10llu %10llu %12llu %7.3f%% %6.2f %8.1f\n", head->pid, head->name,
+               (unsigned long long)table->leaves[PT_LEAF_4K], (unsigned long long)table->leaves[PT_LEAF_2M],
+               (unsigned long long)table->leaves[PT_LEAF_1G], (unsigned long long)table->node_count,
+               (unsigned long long)(tableBytes >> 10), 100.0 * (double)tableBytes / (double)mapped,
+               (double)reads / TRANSLATION_SAMPLES,
+               seconds * 1e9 / TRANSLATION_SAMPLES);
+        totalNodes += table->node_count;
+        totalMapped += mapped;
+    }
+    uint64_t totalBytes = totalNodes * sizeof(((PageTableNode*)0)->entries);
+    printf("Total: %llu KB of page tables for %llu MB mapped (%.3f%%); %llu TLB entries would cover it all\n",
+           (unsigned long long)(totalBytes >> 10), (unsigned long long)(totalMapped >> 20),
+           totalMapped ? 100.0 * (double)totalBytes / (double)totalMapped : 0, (unsigned long long)totalLeaves);
+}
@@ -0,0 +1,122 @@
+#include "process_names.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// FNV-1a over the NUL-terminated code
+static uint32_t hash_code(const char *code) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < PROCESS_CODE_SIZE && code[i]; i++) {
+        hash = (hash ^ (unsigned char)code[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void *grow(void *array, size_t count, size_t element_size) {
+    void *grown = realloc(array, count * element_size);
+    if (!grown) {
+        fprintf(stderr, "Memory allocation failed for process names.\n");
+        exit(1);
+    }
+    return grown;
+}
+
+void names_init(ProcessNames *names) {
+    memset(names, 0, sizeof(*names));
+}
+
+void names_destroy(ProcessNames *names) {
+    free(names->codes);
+    free(names->references);
+    free(names->free_ids);
+    free(names->slots);
+    names_init(names);
+}
+
+// Rebuild the hash table with room for twice as many live codes
+static void rehash(ProcessNames *names) {
+    uint32_t slot_count = names->slot_mask ? (names->slot_mask + 1) * 2 : 64;
+    free(names->slots);
+    names->slots = grow(NULL, slot_count, sizeof(uint32_t));
+    memset(names->slots, 0xff, slot_count * sizeof(uint32_t));
+    names->slot_mask = slot_count - 1;
+
+    for (uint32_t id = 0; id < names->used_ids; id++) {
+        if (names->references[id] == 0) continue;
+        uint32_t slot = hash_code(names->codes[id]) & names->slot_mask;
+        while (names->slots[slot] != NO_PROCESS) {
+            slot = (slot + 1) & names->slot_mask;
+        }
+        names->slots[slot] = id;
+    }
+}
+
+uint32_t names_acquire(ProcessNames *names, const char *code) {
+    if ((names->live + 1) * 2 > names->slot_mask + 1) {
+        rehash(names);
+    }
+    uint32_t slot = hash_code(code) & names->slot_mask;
+    for (;;) {
+        uint32_t id = names->slots[slot];
+        if (id == NO_PROCESS) break;
+        if (strncmp(names->codes[id], code, PROCESS_CODE_SIZE) == 0) {
+            names->references[id]++;
+            return id;
+        }
+        slot = (slot + 1) & names->slot_mask;
+    }
+
+    uint32_t id;
+    if (names->free_count) {
+        id = names->free_ids[--names->free_count];
+    } else {
+        if (names->used_ids == names->capacity) {
+            names->capacity = names->capacity ? names->capacity * 2 : 64;
+            names->codes = grow(names->codes, names->capacity, PROCESS_CODE_SIZE);
+            names->references = grow(names->references, names->capacity, sizeof(uint32_t));
+            names->free_ids = grow(names->free_ids, names->capacity, sizeof(uint32_t));
+        }
+        id = names->used_ids++;
+    }
+    strncpy(names->codes[id], code, PROCESS_CODE_SIZE - 1);
+    names->codes[id][PROCESS_CODE_SIZE - 1] = '\0';
+    names->references[id] = 1;
+    names->slots[slot] = id;
+    names->live++;
+    return id;
+}
+
+// Remove an id from the table, shifting later entries of its probe run
+// back so that lookups never stop at a hole
+static void remove_slot(ProcessNames *names, uint32_t id) {
+    uint32_t slot = hash_code(names->codes[id]) & names->slot_mask;
+    while (names->slots[slot] != id) {
+        slot = (slot + 1) & names->slot_mask;
+    }
+    uint32_t hole = slot;
+    for (;;) {
+        slot = (slot + 1) & names->slot_mask;
+        uint32_t other = names->slots[slot];
+        if (other == NO_PROCESS) break;
+        uint32_t home = hash_code(names->codes[other]) & names->slot_mask;
+        // Move the entry unless its home lies cyclically in (hole, slot]
+        if (((slot - home) & names->slot_mask) >= ((slot - hole) & names->slot_mask)) {
+            names->slots[hole] = other;
+            hole = slot;
+        }
+    }
+    names->slots[hole] = NO_PROCESS;
+}
+
+void names_release(ProcessNames *names, uint32_t id) {
+    if (id == NO_PROCESS || --names->references[id] > 0) {
+        return;
+    }
+    remove_slot(names, id);
+    names->free_ids[names->free_count++] = id;
+    names->live--;
+}
+
+const char *names_lookup(const ProcessNames *names, uint32_t id) {
+    return id == NO_PROCESS ? "" : names->codes[id];
+}
@@ -0,0 +1,29 @@
+#ifndef PROCESS_NAMES_H
+#define PROCESS_NAMES_H
+
+#include <stdint.h>
+
+#define NO_PROCESS ((uint32_t)UINT32_MAX)
+#define PROCESS_CODE_SIZE 10  // Matches Process.code
+
+// Reference-counted intern table for process codes. Memory blocks store
+// the 32-bit id instead of a copy of the code; an id is recycled once the
+// last block referring to it is released.
+typedef struct {
+    char (*codes)[PROCESS_CODE_SIZE];
+    uint32_t *references;
+    uint32_t *free_ids, free_count;
+    uint32_t used_ids, capacity;
+    uint32_t *slots;  // Open-addressing table of ids, NO_PROCESS when empty
+    uint32_t slot_mask, live;
+} ProcessNames;
+
+void names_init(ProcessNames *names);
+void names_destroy(ProcessNames *names);
+// Return the id for a code, adding a reference to it
+uint32_t names_acquire(ProcessNames *names, const char *code);
+// Drop a reference taken by names_acquire
+void names_release(ProcessNames *names, uint32_t id);
+const char *names_lookup(const ProcessNames *names, uint32_t id);
+
+#endif // PROCESS_NAMES_H
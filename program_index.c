@@ -0,0 +1,122 @@
+#include "program_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_SLOTS 64
+
+// FNV-1a over the NUL-terminated name
+static uint32_t hash_name(const char *name) {
+    uint32_t hash = 2166136261u;
+    for (; *name; name++) {
+        hash = (hash ^ (unsigned char)*name) * 16777619u;
+    }
+    return hash;
+}
+
+// Fibonacci hashing; PIDs are handed out in sequence
+static uint32_t hash_pid(uint32_t pid) {
+    return (uint32_t)(((uint64_t)pid * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+static ProgramEntry *allocate_slots(uint32_t count) {
+    ProgramEntry *slots = calloc(count, sizeof(ProgramEntry));
+    if (!slots) {
+        fprintf(stderr, "Error: Memory allocation failed for the program index\n");
+        exit(1);
+    }
+    return slots;
+}
+
+void index_init(ProgramIndex *index) {
+    memset(index, 0, sizeof(*index));
+    index->by_name = allocate_slots(INITIAL_SLOTS);
+    index->by_pid = allocate_slots(INITIAL_SLOTS);
+    index->slot_mask = INITIAL_SLOTS - 1;
+}
+
+void index_destroy(ProgramIndex *index) {
+    free(index->by_name);
+    free(index->by_pid);
+    memset(index, 0, sizeof(*index));
+}
+
+static uint32_t name_slot(const ProgramIndex *index, const char *name) {
+    uint32_t slot = hash_name(name) & index->slot_mask;
+    while (index->by_name[slot].program && strcmp(index->by_name[slot].name, name) != 0) {
+        slot = (slot + 1) & index->slot_mask;
+    }
+    return slot;
+}
+
+static uint32_t pid_slot(const ProgramIndex *index, uint32_t pid) {
+    uint32_t slot = hash_pid(pid) & index->slot_mask;
+    while (index->by_pid[slot].program && index->by_pid[slot].pid != pid) {
+        slot = (slot + 1) & index->slot_mask;
+    }
+    return slot;
+}
+
+// Double both tables and reinsert every entry
+static void rehash(ProgramIndex *index) {
+    ProgramEntry *old_entries = index->by_name;
+    uint32_t old_count = index->slot_mask + 1;
+    free(index->by_pid);
+    index->by_name = allocate_slots(old_count * 2);
+    index->by_pid = allocate_slots(old_count * 2);
+    index->slot_mask = old_count * 2 - 1;
+    for (uint32_t i = 0; i < old_count; i++) {
+        ProgramEntry entry = old_entries[i];
+        if (entry.program) {
+            index->by_name[name_slot(index, entry.name)] = entry;
+            index->by_pid[pid_slot(index, entry.pid)] = entry;
+        }
+    }
+    free(old_entries);
+}
+
+void index_insert(ProgramIndex *index, const char *name, uint32_t pid, void *program) {
+    // Keep the load factor at or below one half
+    if ((index->live + 1) * 2 > index->slot_mask + 1) {
+        rehash(index);
+    }
+    ProgramEntry entry = {name, pid, program};
+    index->by_name[name_slot(index, name)] = entry;
+    index->by_pid[pid_slot(index, pid)] = entry;
+    index->live++;
+}
+
+void *index_find_name(const ProgramIndex *index, const char *name) {
+    return index->by_name[name_slot(index, name)].program;
+}
+
+void *index_find_pid(const ProgramIndex *index, uint32_t pid) {
+    return index->by_pid[pid_slot(index, pid)].program;
+}
+
+// Empty a slot, shifting later entries of its probe run back so lookups
+// never stop at a hole
+static void remove_slot(ProgramIndex *index, ProgramEntry *slots, uint32_t slot, int by_name) {
+    uint32_t hole = slot;
+    for (;;) {
+        slot = (slot + 1) & index->slot_mask;
+        if (!slots[slot].program) break;
+        uint32_t home = (by_name ? hash_name(slots[slot].name) : hash_pid(slots[slot].pid)) & index->slot_mask;
+        // Move the entry unless its home lies cyclically in (hole, slot]
+        if (((slot - home) & index->slot_mask) >= ((slot - hole) & index->slot_mask)) {
+            slots[hole] = slots[slot];
+            hole = slot;
+        }
+    }
+    slots[hole] = (ProgramEntry){0};
+}
+
+void index_remove(ProgramIndex *index, const char *name, uint32_t pid) {
+    uint32_t slot = name_slot(index, name);
+    if (!index->by_name[slot].program) {
+        return;
+    }
+    remove_slot(index, index->by_name, slot, 1);
+    remove_slot(index, index->by_pid, pid_slot(index, pid), 0);
+    index->live--;
+}
@@ -0,0 +1,28 @@
+#ifndef PROGRAM_INDEX_H
+#define PROGRAM_INDEX_H
+
+#include <stdint.h>
+
+// Loaded programs by name and by PID: two open-addressing tables over the
+// same entries, so either lookup is O(1) on average. The index only stores
+// pointers; the name must stay valid while its program is indexed.
+typedef struct {
+    const char *name;
+    uint32_t pid;
+    void *program;
+} ProgramEntry;
+
+typedef struct {
+    ProgramEntry *by_name, *by_pid;  // Slots with program == NULL are empty
+    uint32_t slot_mask, live;
+} ProgramIndex;
+
+void index_init(ProgramIndex *index);
+void index_destroy(ProgramIndex *index);
+// The name and PID must not be indexed already
+void index_insert(ProgramIndex *index, const char *name, uint32_t pid, void *program);
+void *index_find_name(const ProgramIndex *index, const char *name);
+void *index_find_pid(const ProgramIndex *index, uint32_t pid);
+void index_remove(ProgramIndex *index, const char *name, uint32_t pid);
+
+#endif // PROGRAM_INDEX_H
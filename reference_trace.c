@@ -0,0 +1,170 @@
+#include "reference_trace.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Consumed input is dropped from the mapping in chunks of this size, so a
+// trace larger than RAM never stays resident
+#define REFERENCE_RELEASE_CHUNK (64UL << 20)
+#define CONVERT_BATCH 65536
+
+int reference_trace_open(ReferenceReader *reader, const char *filename) {
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = open(filename, O_RDONLY);
+    if (reader->fd < 0) {
+        perror(filename);
+        return -1;
+    }
+    struct stat info;
+    if (fstat(reader->fd, &info) < 0) {
+        perror(filename);
+        close(reader->fd);
+        return -1;
+    }
+    reader->size = (size_t)info.st_size;
+    if (reader->size > 0) {
+        void *data = mmap(NULL, reader->size, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+        if (data == MAP_FAILED) {
+            perror(filename);
+            close(reader->fd);
+            return -1;
+        }
+        madvise(data, reader->size, MADV_SEQUENTIAL);
+        reader->data = data;
+    }
+    reader->end = reader->size;
+
+    if (reader->size >= sizeof(ReferenceTraceHeader) && memcmp(reader->data, REFERENCE_TRACE_MAGIC, 4) == 0) {
+        ReferenceTraceHeader header;
+        memcpy(&header, reader->data, sizeof(header));
+        if (header.version != REFERENCE_TRACE_VERSION ||
+            header.reference_count > (reader->size - sizeof(header)) / sizeof(uint32_t)) {
+            fprintf(stderr, "%s: unsupported or truncated binary reference trace\n", filename);
+            reference_trace_close(reader);
+            return -1;
+        }
+        reader->binary = 1;
+        reader->start = sizeof(header);
+        reader->end = sizeof(header) + header.reference_count * sizeof(uint32_t);
+    }
+    reader->offset = reader->start;
+    return 0;
+}
+
+void reference_trace_close(ReferenceReader *reader) {
+    if (reader->data) {
+        munmap((void *)reader->data, reader->size);
+    }
+    if (reader->fd >= 0) {
+        close(reader->fd);
+    }
+    reader->data = NULL;
+    reader->fd = -1;
+}
+
+void reference_trace_rewind(ReferenceReader *reader) {
+    reader->offset = reader->start;
+    reader->released = 0;
+    reader->references = 0;
+}
+
+// Hand fully consumed chunks of the mapping back to the kernel
+static void release_consumed(ReferenceReader *reader) {
+    if (reader->offset - reader->released < REFERENCE_RELEASE_CHUNK) {
+        return;
+    }
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t end = reader->offset & ~(page - 1);
+    madvise((void *)(reader->data + reader->released), end - reader->released, MADV_DONTNEED);
+    reader->released = end;
+}
+
+static long read_text(ReferenceReader *reader, uint32_t *pages, size_t max) {
+    const char *p = reader->data + reader->offset, *end = reader->data + reader->end;
+    size_t count = 0;
+    while (count < max) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+        if (p == end) break;
+        if (*p == '#') {
+            const char *line_end = memchr(p, '\n', (size_t)(end - p));
+            p = line_end ? line_end : end;
+            continue;
+        }
+        if (*p < '0' || *p > '9') {
+            reader->offset = (size_t)(p - reader->data);
+            reader->references += count;
+            return -1;
+        }
+        uint64_t page = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            page = page * 10 + (uint64_t)(*p++ - '0');
+            if (page >= UINT32_MAX) {  // UINT32_MAX itself means "not present"
+                reader->offset = (size_t)(p - reader->data);
+                reader->references += count;
+                return -1;
+            }
+        }
+        pages[count++] = (uint32_t)page;
+    }
+    reader->offset = (size_t)(p - reader->data);
+    return (long)count;
+}
+
+static long read_binary(ReferenceReader *reader, uint32_t *pages, size_t max) {
+    size_t available = (reader->end - reader->offset) / sizeof(uint32_t);
+    size_t count = available < max ? available : max;
+    memcpy(pages, reader->data + reader->offset, count * sizeof(uint32_t));
+    reader->offset += count * sizeof(uint32_t);
+    for (size_t i = 0; i < count; i++) {
+        if (pages[i] == UINT32_MAX) {
+            reader->references += i;
+            return -1;
+        }
+    }
+    return (long)count;
+}
+
+long reference_trace_read(ReferenceReader *reader, uint32_t *pages, size_t max) {
+    long count = reader->binary ? read_binary(reader, pages, max) : read_text(reader, pages, max);
+    if (count > 0) {
+        reader->references += (uint64_t)count;
+        release_consumed(reader);
+    }
+    return count;
+}
+
+int convert_reference_trace(const char *input_filename, const char *output_filename) {
+    ReferenceReader reader;
+    if (reference_trace_open(&reader, input_filename) < 0) {
+        return -1;
+    }
+    FILE *output = fopen(output_filename, "wb");
+    if (!output) {
+        perror(output_filename);
+        reference_trace_close(&reader);
+        return -1;
+    }
+
+    // The reference count is patched in once the input has been read
+    ReferenceTraceHeader header = {{'P', 'R', 'E', 'F'}, REFERENCE_TRACE_VERSION, 0};
+    fwrite(&header, sizeof(header), 1, output);
+    static uint32_t pages[CONVERT_BATCH];
+    long count;
+    while ((count = reference_trace_read(&reader, pages, CONVERT_BATCH)) > 0) {
+        fwrite(pages, sizeof(uint32_t), (size_t)count, output);
+        header.reference_count += (uint64_t)count;
+    }
+    if (count < 0) {
+        fprintf(stderr, "%s: malformed reference after %llu references\n", input_filename,
+                (unsigned long long)reader.references);
+    }
+    rewind(output);
+    fwrite(&header, sizeof(header), 1, output);
+    int failed = count < 0 || ferror(output);
+    if (fclose(output) != 0) failed = 1;
+    reference_trace_close(&reader);
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,44 @@
+#ifndef REFERENCE_TRACE_H
+#define REFERENCE_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Memory reference strings for the paging simulator, read through a
+// read-only mapping in batches. Two formats are accepted:
+//
+//   text   virtual page numbers separated by white space; '#' starts a
+//          comment that runs to the end of the line
+//   binary ReferenceTraceHeader followed by reference_count uint32_t pages
+//
+// The binary format is what makes traces of billions of references cheap
+// to replay; convert_reference_trace produces it from text.
+
+#define REFERENCE_TRACE_MAGIC "PREF"
+#define REFERENCE_TRACE_VERSION 1
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t reference_count;
+} ReferenceTraceHeader;
+
+typedef struct {
+    int fd;
+    const char *data;
+    size_t size, start, end, offset;  // Mapping size, first reference, end of data, read position
+    size_t released;                  // Bytes already handed back to the kernel
+    int binary;
+    uint64_t references;              // References read so far
+} ReferenceReader;
+
+int reference_trace_open(ReferenceReader *reader, const char *filename);
+// Read up to max pages. Returns the number read, 0 at the end of the trace
+// and -1 on a malformed entry.
+long reference_trace_read(ReferenceReader *reader, uint32_t *pages, size_t max);
+// Start again from the first reference
+void reference_trace_rewind(ReferenceReader *reader);
+void reference_trace_close(ReferenceReader *reader);
+int convert_reference_trace(const char *input_filename, const char *output_filename);
+
+#endif // REFERENCE_TRACE_H
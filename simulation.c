@@ -0,0 +1,401 @@
+#include "simulation.h"
+#include "trace_loader.h"
+#include "metrics.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+// Event a runs before event b
+static int event_before(const Event *a, const Event *b) {
+    if (a->time != b->time) return a->time < b->time;
+    if (a->type != b->type) return a->type < b->type;
+    return a->sequence < b->sequence;
+}
+
+static void queue_push(EventQueue *queue, Event event) {
+    if (queue->count == queue->capacity) {
+        size_t capacity = queue->capacity ? queue->capacity * 2 : 256;
+        Event *events = realloc(queue->events, capacity * sizeof(Event));
+        if (!events) {
+            fprintf(stderr, "Memory allocation failed for event queue.\n");
+            exit(1);
+        }
+        queue->events = events;
+        queue->capacity = capacity;
+    }
+
+    // Sift up
+    size_t i = queue->count++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!event_before(&event, &queue->events[parent])) break;
+        queue->events[i] = queue->events[parent];
+        i = parent;
+    }
+    queue->events[i] = event;
+}
+
+static Event queue_pop(EventQueue *queue) {
+    Event top = queue->events[0];
+    Event last = queue->events[--queue->count];
+
+    // Sift the last event down from the root
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= queue->count) break;
+        if (child + 1 < queue->count && event_before(&queue->events[child + 1], &queue->events[child])) {
+            child++;
+        }
+        if (!event_before(&queue->events[child], &last)) break;
+        queue->events[i] = queue->events[child];
+        i = child;
+    }
+    if (queue->count > 0) {
+        queue->events[i] = last;
+    }
+    return top;
+}
+
+static void waiting_push(WaitingQueue *waiting, Process *process) {
+    if (waiting->count == waiting->capacity) {
+        size_t capacity = waiting->capacity ? waiting->capacity * 2 : 64;
+        Process **processes = malloc(capacity * sizeof(Process *));
+        if (!processes) {
+            fprintf(stderr, "Memory allocation failed for waiting queue.\n");
+            exit(1);
+        }
+        // Unwrap the ring into the new buffer
+        for (size_t i = 0; i < waiting->count; i++) {
+            processes[i] = waiting->processes[(waiting->head + i) % waiting->capacity];
+        }
+        free(waiting->processes);
+        waiting->processes = processes;
+        waiting->head = 0;
+        waiting->capacity = capacity;
+    }
+    waiting->processes[(waiting->head + waiting->count) % waiting->capacity] = process;
+    waiting->count++;
+}
+
+static Process *waiting_peek(const WaitingQueue *waiting) {
+    return waiting->count ? waiting->processes[waiting->head] : NULL;
+}
+
+static void waiting_pop(WaitingQueue *waiting) {
+    waiting->head = (waiting->head + 1) % waiting->capacity;
+    waiting->count--;
+}
+
+static void schedule(Simulation *sim, long long time, EventType type, Process *process) {
+    Event event = {time, sim->next_sequence++, type, process};
+    queue_push(&sim->queue, event);
+}
+
+static void log_event(Simulation *sim, int kind, const Process *process, BlockId block) {
+    if (!sim->log) return;
+    uint64_t address = block != NO_BLOCK ? sim->memory->start_address[block] : EVENT_LOG_NO_ADDRESS;
+    event_log_record(sim->log, sim->now, kind, process->code, address);
+}
+
+// Compact when the free memory would be enough if it were contiguous.
+// Incremental compaction that did not make room yet continues next tick.
+static int compact_for(Simulation *sim, Process *process) {
+    CompactionStats *stats = &sim->stats.compaction;
+    uint64_t moved = stats->bytes_moved;
+    int fits = compact_for_request(sim->memory, sim->compaction, process->memory_required, stats);
+    if (sim->renderer && stats->bytes_moved != moved) {
+        renderer_mark_dirty(sim->renderer, stats->low, stats->high - stats->low);
+        renderer_event(sim->renderer, sim->memory);
+    }
+    if (!fits && sim->compaction && sim->compaction->mode == COMPACT_INCREMENTAL && !sim->tick_pending &&
+        sim->memory->free_size >= process->memory_required) {
+        sim->tick_pending = 1;
+        sim->tick_time = sim->now + 1;
+        schedule(sim, sim->tick_time, EVENT_RETRY, NULL);
+    }
+    return fits;
+}
+
+// Try to place a process now; on success schedule its completion
+static int try_allocate(Simulation *sim, Process *process) {
+    if (!check_memory_availability(sim->memory, process->memory_required) && !compact_for(sim, process)) {
+        return 0;
+    }
+    BlockId block;
+    switch (sim->strategy) {
+        case STRATEGY_BEST_FIT:
+            block = allocate_best_fit(sim->memory, process);
+            break;
+        case STRATEGY_BUDDY:
+            block = allocate_buddy(sim->memory, process);
+            break;
+        default:
+            block = allocate_first_fit(sim->memory, process);
+            break;
+    }
+    if (block == NO_BLOCK) {
+        return 0;
+    }
+    process->allocation_status = 'Y';
+    sim->stats.allocated++;
+    if (sim->page_size > 1) {
+        sim->stats.requested_bytes += process->memory_required * sim->page_size - process->page_slack;
+        sim->stats.granted_bytes += sim->memory->size[block] * sim->page_size;
+    } else {
+        sim->stats.requested_bytes += process->memory_required;
+        sim->stats.granted_bytes += sim->memory->size[block];
+    }
+    if (sim->renderer) {
+        renderer_mark_block(sim->renderer, sim->memory, block);
+        renderer_event(sim->renderer, sim->memory);
+    }
+    sim->stats.total_wait_time += sim->now - process->arrival_date;
+    schedule(sim, sim->now + process->execution_time, EVENT_COMPLETION, process);
+    return 1;
+}
+
+static void recycle_process(Simulation *sim, Process *process) {
+    if (sim->recycle) {
+        pool_free(&sim->process_pool, process);
+    }
+}
+
+static void handle_arrival(Simulation *sim, Process *process) {
+    sim->stats.arrived++;
+    log_event(sim, LOG_NEW, process, NO_BLOCK);
+
+    if (process->memory_required == 0 || process->memory_required > largest_possible_allocation(sim->memory)) {
+        // Could never fit, so it must not block the waiting queue
+        process->allocation_status = 'R';
+        sim->stats.rejected++;
+        recycle_process(sim, process);
+        return;
+    }
+    // Strict FIFO: an arrival may only bypass the queue when it is empty
+    if (sim->waiting.count == 0 && try_allocate(sim, process)) {
+        log_event(sim, LOG_SELECTED, process, process->block);
+        return;
+    }
+    process->waiting_status = 'Y';
+    waiting_push(&sim->waiting, process);
+    if (sim->process_list) sim->process_list->total_waiting++;
+    if (sim->waiting.count > sim->stats.max_waiting) sim->stats.max_waiting = sim->waiting.count;
+    log_event(sim, LOG_WAITING, process, NO_BLOCK);
+}
+
+// Serve the waiting queue in order until its head no longer fits
+static void handle_retry(Simulation *sim) {
+    sim->retry_pending = 0;
+    if (sim->tick_pending && sim->now >= sim->tick_time) sim->tick_pending = 0;
+    Process *process;
+    while ((process = waiting_peek(&sim->waiting)) && try_allocate(sim, process)) {
+        waiting_pop(&sim->waiting);
+        process->waiting_status = 'N';
+        if (sim->process_list) sim->process_list->total_waiting--;
+        log_event(sim, LOG_READY, process, process->block);
+    }
+}
+
+static void handle_completion(Simulation *sim, Process *process) {
+    if (sim->renderer) {
+        renderer_mark_block(sim->renderer, sim->memory, process->block);
+    }
+    complete_process(sim->memory, process);
+    if (sim->renderer) {
+        renderer_event(sim->renderer, sim->memory);
+    }
+    sim->stats.completed++;
+    log_event(sim, LOG_COMPLETED, process, NO_BLOCK);
+    recycle_process(sim, process);
+    if (sim->waiting.count && !sim->retry_pending) {
+        sim->retry_pending = 1;
+        schedule(sim, sim->now, EVENT_RETRY, NULL);
+    }
+}
+
+static void dispatch(Simulation *sim, Event event) {
+    sim->now = event.time;
+    sim->stats.events++;
+    switch (event.type) {
+        case EVENT_ARRIVAL:
+            handle_arrival(sim, event.process);
+            break;
+        case EVENT_COMPLETION:
+            handle_completion(sim, event.process);
+            break;
+        case EVENT_RETRY:
+            handle_retry(sim);
+            break;
+    }
+}
+
+// Initialize a simulation over the given memory
+void simulation_init(Simulation *sim, MemoryList *memory, PlacementStrategy strategy, EventLog *log) {
+    memset(sim, 0, sizeof(*sim));
+    sim->memory = memory;
+    sim->strategy = strategy;
+    sim->log = log;
+    sim->page_size = 1;
+    pool_init(&sim->process_pool, "Process", sizeof(Process));
+}
+
+// Release the event and waiting queues and any streamed processes
+void simulation_destroy(Simulation *sim) {
+    pool_destroy(&sim->process_pool);
+    free(sim->queue.events);
+    free(sim->waiting.processes);
+    sim->queue.events = NULL;
+    sim->waiting.processes = NULL;
+}
+
+Process *simulation_new_process(Simulation *sim) {
+    return pool_alloc(&sim->process_pool);
+}
+
+void simulation_add_arrival(Simulation *sim, Process *process) {
+    schedule(sim, process->arrival_date, EVENT_ARRIVAL, process);
+}
+
+void simulation_run_until(Simulation *sim, long long time) {
+    double started = metrics_now_seconds();
+    while (sim->queue.count && sim->queue.events[0].time < time) {
+        dispatch(sim, queue_pop(&sim->queue));
+    }
+    sim->stats.end_time = sim->now;
+    sim->stats.elapsed_seconds += metrics_now_seconds() - started;
+}
+
+void simulation_run(Simulation *sim) {
+    double started = metrics_now_seconds();
+    while (sim->queue.count) {
+        dispatch(sim, queue_pop(&sim->queue));
+    }
+    sim->stats.end_time = sim->now;
+    sim->stats.elapsed_seconds += metrics_now_seconds() - started;
+}
+
+// Run every process of the list that has not been allocated yet
+void run_simulation(MemoryList *memory, ProcessList *process_list, PlacementStrategy strategy,
+                    EventLog *log, const CompactionPolicy *compaction, SimulationStats *stats) {
+    Simulation sim;
+    simulation_init(&sim, memory, strategy, log);
+    sim.compaction = compaction;
+    sim.process_list = process_list;
+
+    for (Process *current = process_list->head; current; current = current->next) {
+        if (current->allocation_status == 'N') {
+            simulation_add_arrival(&sim, current);
+        }
+    }
+    simulation_run(&sim);
+    *stats = sim.stats;
+    simulation_destroy(&sim);
+}
+
+// Convert a request to whole pages
+static void round_to_pages(Process *process, uint64_t page_size) {
+    uint64_t pages = process->memory_required / page_size + (process->memory_required % page_size != 0);
+    process->page_slack = (uint32_t)(pages * page_size - process->memory_required);
+    process->memory_required = pages;
+}
+
+static int stream_trace(MemoryList *memory, const char *filename, PlacementStrategy strategy, uint64_t page_size,
+                        EventLog *log, MapRenderer *renderer, const CompactionPolicy *compaction,
+                        SimulationStats *stats) {
+    TraceReader reader;
+    if (trace_open(&reader, filename) < 0) {
+        return -1;
+    }
+    Simulation sim;
+    simulation_init(&sim, memory, strategy, log);
+    sim.renderer = renderer;
+    sim.compaction = compaction;
+    sim.recycle = 1;
+    sim.page_size = page_size;
+
+    // Only events before the next arrival are run, so the simulator holds
+    // just the live and waiting processes rather than the whole trace
+    Process record;
+    int result, status = 0;
+    long long last_arrival = 0;
+    while ((result = trace_next(&reader, &record)) == 1) {
+        if (record.arrival_date < last_arrival) {
+            fprintf(stderr, "%s: arrival dates go backwards at line %lld\n", filename, reader.line);
+            status = -1;
+            break;
+        }
+        if (record.arrival_date > last_arrival) {
+            simulation_run_until(&sim, record.arrival_date);
+            last_arrival = record.arrival_date;
+        }
+        Process *process = simulation_new_process(&sim);
+        *process = record;
+        if (page_size > 1) {
+            round_to_pages(process, page_size);
+        }
+        simulation_add_arrival(&sim, process);
+    }
+    if (result < 0) {
+        fprintf(stderr, "%s: malformed entry at line %lld\n", filename, reader.line);
+        status = -1;
+    }
+    simulation_run(&sim);
+    trace_close(&reader);
+    if (renderer) {
+        renderer_finish(renderer, memory);
+    }
+
+    sim.stats.peak_live_processes = sim.process_pool.peak_in_use;
+    *stats = sim.stats;
+    simulation_destroy(&sim);
+    return status;
+}
+
+int simulate_trace(MemoryList *memory, const char *filename, PlacementStrategy strategy,
+                   EventLog *log, MapRenderer *renderer, const CompactionPolicy *compaction,
+                   SimulationStats *stats) {
+    return stream_trace(memory, filename, strategy, 1, log, renderer, compaction, stats);
+}
+
+int simulate_trace_pages(MemoryList *memory, const char *filename, PlacementStrategy strategy,
+                         uint64_t page_size, const CompactionPolicy *compaction, SimulationStats *stats) {
+    return stream_trace(memory, filename, strategy, page_size, NULL, NULL, compaction, stats);
+}
+
+void print_simulation_stats(const SimulationStats *stats) {
+    printf("\nSimulation Summary:\n");
+    printf("  Processes arrived    : %lld\n", stats->arrived);
+    printf("  Processes allocated  : %lld\n", stats->allocated);
+    printf("  Processes completed  : %lld\n", stats->completed);
+    printf("  Processes rejected   : %lld\n", stats->rejected);
+    printf("  Average wait time    : %.2f\n",
+           stats->allocated ? (double)stats->total_wait_time / (double)stats->allocated : 0.0);
+    printf("  Longest waiting queue: %zu\n", stats->max_waiting);
+    printf("  Rounding waste       : %.2f%% of %" PRIu64 " units granted (internal fragmentation)\n",
+           stats->granted_bytes
+               ? 100.0 * (double)(stats->granted_bytes - stats->requested_bytes) / (double)stats->granted_bytes
+               : 0.0,
+           stats->granted_bytes);
+    if (stats->peak_live_processes) {
+        printf("  Peak live processes  : %zu\n", stats->peak_live_processes);
+    }
+    if (stats->compaction.passes) {
+        print_compaction_stats(&stats->compaction);
+    }
+    printf("  Simulated end time   : %lld\n", stats->end_time);
+    printf("  Events processed     : %lld in %.3f s", stats->events, stats->elapsed_seconds);
+    if (stats->elapsed_seconds > 0) {
+        printf(" (%.0f events/s)", (double)stats->events / stats->elapsed_seconds);
+    }
+    printf("\n");
+}
+
+int parse_strategy(const char *name) {
+    const char *names[] = {"first", "best", "buddy"};
+    for (int strategy = STRATEGY_FIRST_FIT; strategy <= STRATEGY_BUDDY; strategy++) {
+        if (strcmp(name, names[strategy]) == 0) return strategy;
+    }
+    return -1;
+}
@@ -0,0 +1,96 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "mem_allocate.h"
+#include "event_log.h"
+#include "map_render.h"
+#include "compaction.h"
+
+// Discrete-event simulation of process arrivals and completions. The clock
+// jumps from one event to the next; nothing happens between events.
+
+// STRATEGY_BUDDY requires a memory map switched over with buddy_enable
+typedef enum { STRATEGY_FIRST_FIT, STRATEGY_BEST_FIT, STRATEGY_BUDDY } PlacementStrategy;
+
+// Events at the same time run in this order: memory is released first, the
+// waiting queue is served next, and new arrivals queue up behind it.
+typedef enum { EVENT_COMPLETION, EVENT_RETRY, EVENT_ARRIVAL } EventType;
+
+typedef struct {
+    long long time;
+    unsigned long long sequence;  // Keeps events of the same time and type FIFO
+    EventType type;
+    Process *process;
+} Event;
+
+typedef struct {
+    Event *events;
+    size_t count, capacity;
+} EventQueue;
+
+// FIFO of processes waiting for memory, stored as a growable ring buffer
+typedef struct {
+    Process **processes;
+    size_t head, count, capacity;
+} WaitingQueue;
+
+typedef struct {
+    long long arrived, allocated, completed, rejected;
+    long long total_wait_time;  // Sum of (allocation time - arrival time)
+    uint64_t requested_bytes, granted_bytes;  // Summed over allocations; granted includes rounding
+    CompactionStats compaction;
+    long long events;
+    size_t max_waiting;
+    size_t peak_live_processes;  // Streamed processes held at once
+    long long end_time;
+    double elapsed_seconds;
+} SimulationStats;
+
+typedef struct {
+    MemoryList *memory;
+    PlacementStrategy strategy;
+    EventLog *log;  // Optional, NULL disables event logging
+    MapRenderer *renderer;  // Optional, notified of every map change
+    const CompactionPolicy *compaction;  // Optional, used when free memory is too fragmented
+    ProcessList *process_list;  // Optional, total_waiting is kept up to date
+    EventQueue queue;
+    WaitingQueue waiting;
+    long long now;
+    unsigned long long next_sequence;
+    int retry_pending;
+    int tick_pending;  // An incremental compaction step is scheduled for tick_time
+    long long tick_time;
+    int recycle;  // Completed and rejected processes return to process_pool
+    uint64_t page_size;  // Units per page of memory; memory_required counts pages when above 1
+    NodePool process_pool;
+    SimulationStats stats;
+} Simulation;
+
+void simulation_init(Simulation *sim, MemoryList *memory, PlacementStrategy strategy, EventLog *log);
+void simulation_destroy(Simulation *sim);
+// Get a Process for a streamed arrival from the simulation's own pool
+Process *simulation_new_process(Simulation *sim);
+// Schedule the arrival of a process at its arrival_date
+void simulation_add_arrival(Simulation *sim, Process *process);
+// Process every event scheduled strictly before the given time
+void simulation_run_until(Simulation *sim, long long time);
+// Process events until the queue is empty
+void simulation_run(Simulation *sim);
+// Schedule every unallocated process of the list and run to completion
+void run_simulation(MemoryList *memory, ProcessList *process_list, PlacementStrategy strategy,
+                    EventLog *log, const CompactionPolicy *compaction, SimulationStats *stats);
+// Stream a trace file through the simulator without keeping it in memory.
+// Returns 0 on success and -1 if the trace could not be read.
+int simulate_trace(MemoryList *memory, const char *filename, PlacementStrategy strategy,
+                   EventLog *log, MapRenderer *renderer, const CompactionPolicy *compaction,
+                   SimulationStats *stats);
+// Stream a trace through memory of memory->total_size pages of page_size
+// units each, rounding every request up to whole pages. Byte counts in the
+// stats stay in units of the trace.
+int simulate_trace_pages(MemoryList *memory, const char *filename, PlacementStrategy strategy,
+                         uint64_t page_size, const CompactionPolicy *compaction, SimulationStats *stats);
+void print_simulation_stats(const SimulationStats *stats);
+// Parse "first", "best" or "buddy"; returns -1 when unknown
+int parse_strategy(const char *name);
+
+#endif // SIMULATION_H
@@ -0,0 +1,41 @@
+#include "size_parse.h"
+#include <errno.h>
+#include <stdlib.h>
+
+uint64_t parse_size(const char *text) {
+    // strtoull would also take leading blanks and a sign, and wrap negatives
+    if (*text < '0' || *text > '9') {
+        return 0;
+    }
+    char *end;
+    errno = 0;
+    uint64_t value = strtoull(text, &end, 10);
+    if (errno == ERANGE) {
+        return 0;
+    }
+    unsigned shift = 0;
+    switch (*end) {
+        case 'K': case 'k': shift = 10; end++; break;
+        case 'M': case 'm': shift = 20; end++; break;
+        case 'G': case 'g': shift = 30; end++; break;
+        case 'T': case 't': shift = 40; end++; break;
+    }
+    if (*end != '\0' || value > UINT64_MAX >> shift) {
+        return 0;
+    }
+    return value << shift;
+}
+
+int parse_number(const char *text, uint64_t *number) {
+    if (*text < '0' || *text > '9') {
+        return -1;
+    }
+    char *end;
+    errno = 0;
+    uint64_t value = strtoull(text, &end, 10);
+    if (errno == ERANGE || *end != '\0') {
+        return -1;
+    }
+    *number = value;
+    return 0;
+}
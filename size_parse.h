@@ -0,0 +1,14 @@
+#ifndef SIZE_PARSE_H
+#define SIZE_PARSE_H
+
+#include <stdint.h>
+
+// Parse a decimal size with an optional binary K/M/G/T suffix (either
+// case), as given on the command line. Returns 0 when the text is not such
+// a size or the value does not fit in 64 bits.
+uint64_t parse_size(const char *text);
+// Parse a plain decimal number, where 0 is a valid value. Returns -1 when
+// the text is not such a number or does not fit in 64 bits.
+int parse_number(const char *text, uint64_t *number);
+
+#endif // SIZE_PARSE_H
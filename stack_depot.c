@@ -0,0 +1,191 @@
+#define _GNU_SOURCE
+#include "stack_depot.h"
+#include <dlfcn.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define DEPOT_MAX_STACKS (1u << 20)
+#define DEPOT_SLOTS (DEPOT_MAX_STACKS * 2)
+#define DEPOT_FRAME_CAPACITY (DEPOT_MAX_STACKS * 8u)
+
+// Stacks are stored back to back in one arena: a header word holding the
+// hash and depth, followed by the frames. All arrays are reserved up front
+// and only touched pages are ever backed by memory.
+static uintptr_t *arena;
+static uint32_t arena_used;
+static uint32_t *offsets;  // Id -> arena offset of its header
+static uint32_t *slots;    // Open-addressing table of ids, 0 when empty
+static uint32_t next_id = 1;
+
+static pthread_mutex_t depot_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t depot_once = PTHREAD_ONCE_INIT;
+
+// Stack bounds of the calling thread, looked up on its first capture
+static __thread uintptr_t stack_low __attribute__((tls_model("initial-exec")));
+static __thread uintptr_t stack_high __attribute__((tls_model("initial-exec")));
+
+static void *reserve(size_t bytes) {
+    void *memory = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return memory == MAP_FAILED ? NULL : memory;
+}
+
+static void create_depot(void) {
+    arena = reserve((size_t)DEPOT_FRAME_CAPACITY * sizeof(uintptr_t));
+    offsets = reserve((size_t)DEPOT_MAX_STACKS * sizeof(uint32_t));
+    slots = reserve((size_t)DEPOT_SLOTS * sizeof(uint32_t));
+}
+
+static void find_stack_bounds(void) {
+    pthread_attr_t attributes;
+    void *address;
+    size_t size;
+    stack_high = 1;  // Do not retry if the lookup fails
+    if (pthread_getattr_np(pthread_self(), &attributes) != 0) {
+        return;
+    }
+    if (pthread_attr_getstack(&attributes, &address, &size) == 0) {
+        stack_low = (uintptr_t)address;
+        stack_high = (uintptr_t)address + size;
+    }
+    pthread_attr_destroy(&attributes);
+}
+
+void current_stack_bounds(uintptr_t *low, uintptr_t *high) {
+    if (!stack_high) {
+        find_stack_bounds();
+    }
+    *low = stack_low;
+    *high = stack_high > 1 ? stack_high : 0;
+}
+
+unsigned stack_capture(void *frame, uintptr_t *frames, unsigned max_depth) {
+    if (!stack_high) {
+        find_stack_bounds();
+    }
+    unsigned depth = 0;
+    uintptr_t *current = frame;
+    while (depth < max_depth) {
+        uintptr_t address = (uintptr_t)current;
+        // A frame holds the caller's frame pointer and the return address
+        if (address < stack_low || address + 2 * sizeof(uintptr_t) > stack_high ||
+            address % sizeof(uintptr_t) != 0) {
+            break;
+        }
+        uintptr_t return_address = current[1];
+        if (return_address == 0) {
+            break;
+        }
+        frames[depth++] = return_address;
+        uintptr_t *caller = (uintptr_t *)current[0];
+        if (caller <= current) {  // Stacks grow down, so callers sit higher
+            break;
+        }
+        current = caller;
+    }
+    return depth;
+}
+
+static uint32_t hash_frames(const uintptr_t *frames, unsigned depth) {
+    uint64_t hash = 0x9E3779B97F4A7C15ull ^ depth;
+    for (unsigned i = 0; i < depth; i++) {
+        hash = (hash ^ frames[i]) * 0xff51afd7ed558ccdull;
+        hash ^= hash >> 32;
+    }
+    return (uint32_t)hash;
+}
+
+static int same_stack(uint32_t id, uint32_t hash, const uintptr_t *frames, unsigned depth) {
+    const uintptr_t *record = arena + offsets[id];
+    return record[0] == ((uintptr_t)hash << 32 | depth) &&
+           memcmp(record + 1, frames, depth * sizeof(uintptr_t)) == 0;
+}
+
+uint32_t depot_intern(const uintptr_t *frames, unsigned depth) {
+    if (depth == 0) {
+        return NO_STACK;
+    }
+    pthread_once(&depot_once, create_depot);
+    if (!arena || !offsets || !slots) {
+        return NO_STACK;
+    }
+    uint32_t hash = hash_frames(frames, depth);
+
+    // Lock-free lookup: a published slot always points at a complete record
+    uint32_t slot = hash & (DEPOT_SLOTS - 1), id;
+    while ((id = __atomic_load_n(&slots[slot], __ATOMIC_ACQUIRE)) != 0) {
+        if (same_stack(id, hash, frames, depth)) return id;
+        slot = (slot + 1) & (DEPOT_SLOTS - 1);
+    }
+
+    pthread_mutex_lock(&depot_lock);
+    // Another thread may have added it, or taken this slot, meanwhile
+    while ((id = slots[slot]) != 0) {
+        if (same_stack(id, hash, frames, depth)) {
+            pthread_mutex_unlock(&depot_lock);
+            return id;
+        }
+        slot = (slot + 1) & (DEPOT_SLOTS - 1);
+    }
+    id = NO_STACK;
+    if (next_id < DEPOT_MAX_STACKS && arena_used + depth + 1 <= DEPOT_FRAME_CAPACITY) {
+        id = next_id;
+        uintptr_t *record = arena + arena_used;
+        record[0] = (uintptr_t)hash << 32 | depth;
+        memcpy(record + 1, frames, depth * sizeof(uintptr_t));
+        offsets[id] = arena_used;
+        arena_used += depth + 1;
+        __atomic_store_n(&next_id, id + 1, __ATOMIC_RELEASE);
+        __atomic_store_n(&slots[slot], id, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&depot_lock);
+    return id;
+}
+
+uint32_t depot_capture(void *frame) {
+    uintptr_t frames[STACK_MAX_DEPTH];
+    return depot_intern(frames, stack_capture(frame, frames, STACK_MAX_DEPTH));
+}
+
+unsigned depot_get(uint32_t id, const uintptr_t **frames) {
+    if (id == NO_STACK || id >= __atomic_load_n(&next_id, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    const uintptr_t *record = arena + offsets[id];
+    *frames = record + 1;
+    return (unsigned)(record[0] & 0xffffffffu);
+}
+
+uint32_t depot_size(void) {
+    return __atomic_load_n(&next_id, __ATOMIC_ACQUIRE) - 1;
+}
+
+// Module and offset of a code address; the main program may come back
+// without a name, in which case /proc/self/exe stands in for it
+void depot_print(FILE *output, uint32_t id) {
+    const uintptr_t *frames;
+    unsigned depth = depot_get(id, &frames);
+    if (depth == 0) {
+        fprintf(output, "    (no stack)\n");
+        return;
+    }
+    for (unsigned i = 0; i < depth; i++) {
+        Dl_info info;
+        // Return addresses point after the call; step back into it
+        uintptr_t address = frames[i] - 1;
+        if (dladdr((void *)address, &info) && info.dli_fbase) {
+            char executable[512];
+            const char *module = info.dli_fname;
+            if (!module || !module[0]) {
+                ssize_t length = readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+                executable[length > 0 ? length : 0] = '\0';
+                module = executable;
+            }
+            fprintf(output, "    #%u 0x%lx (%s+0x%lx)\n", i, (unsigned long)address, module,
+                    (unsigned long)(address - (uintptr_t)info.dli_fbase));
+        } else {
+            fprintf(output, "    #%u 0x%lx\n", i, (unsigned long)address);
+        }
+    }
+}
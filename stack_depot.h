@@ -0,0 +1,39 @@
+#ifndef STACK_DEPOT_H
+#define STACK_DEPOT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Deduplicated store of call stacks. Each distinct stack is kept once and
+// named by a 32-bit id, so a tracked block only carries the id. Lookups of
+// known stacks take no lock; only adding a new stack does. Stacks are raw
+// return addresses: nothing is symbolized until a report asks for it, and
+// even then only module paths and offsets are printed, for addr2line to
+// resolve offline.
+//
+// Capture follows the frame-pointer chain, so code built without frame
+// pointers yields truncated stacks. Every frame is checked against the
+// thread's stack bounds, which makes a broken chain stop rather than fault.
+
+#define STACK_MAX_DEPTH 16
+#define NO_STACK 0u
+
+// Bounds of the calling thread's stack, looked up once per thread; both are
+// 0 if they cannot be found
+void current_stack_bounds(uintptr_t *low, uintptr_t *high);
+// Walk the frame chain starting at a frame address (usually
+// __builtin_frame_address(0) of an allocation wrapper), store the return
+// addresses and return the number stored
+unsigned stack_capture(void *frame, uintptr_t *frames, unsigned max_depth);
+// Id of a stack, adding it if it is new; NO_STACK when the depot is full
+uint32_t depot_intern(const uintptr_t *frames, unsigned depth);
+// Capture and intern in one step
+uint32_t depot_capture(void *frame);
+// Frames of a stack; returns the depth, 0 for NO_STACK or an unknown id
+unsigned depot_get(uint32_t id, const uintptr_t **frames);
+// Number of ids handed out so far; valid ids are 1 .. depot_size()
+uint32_t depot_size(void);
+// Print one frame per line as "#n 0xADDRESS (module+0xOFFSET)"
+void depot_print(FILE *output, uint32_t id);
+
+#endif // STACK_DEPOT_H
@@ -0,0 +1,226 @@
+#include "sweep_runner.h"
+#include "buddy_allocator.h"
+#include "metrics.h"
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// Jobs still queued at one worker: indexes [top, bottom) into the grid. The
+// owner takes from the top in grid order and thieves from the bottom, so
+// they only meet on the last job. Jobs are whole simulations, so a lock per
+// take costs nothing next to the work.
+typedef struct {
+    pthread_mutex_t lock;
+    size_t top, bottom;
+    unsigned long long steals;  // Jobs this worker took from others
+} __attribute__((aligned(64))) SweepDeque;
+
+typedef struct {
+    const SweepConfig *config;
+    SweepResult *results;
+    SweepDeque *deques;
+    int workers;
+} SweepPool;
+
+typedef struct {
+    SweepPool *pool;
+    int id;
+} SweepWorker;
+
+static const char *strategy_name(PlacementStrategy strategy) {
+    switch (strategy) {
+        case STRATEGY_BEST_FIT:
+            return "best";
+        case STRATEGY_BUDDY:
+            return "buddy";
+        default:
+            return "first";
+    }
+}
+
+static const char *status_name(SweepStatus status) {
+    return status == SWEEP_OK ? "ok" : status == SWEEP_FAILED ? "failed" : "skipped";
+}
+
+size_t sweep_point_count(const SweepConfig *config) {
+    return config->strategy_count * config->memory_count * config->page_count;
+}
+
+// Simulate one grid point in structures private to the calling thread
+static void run_point(const SweepConfig *config, size_t job, SweepResult *result) {
+    size_t page_index = job % config->page_count;
+    size_t memory_index = job / config->page_count % config->memory_count;
+    size_t strategy_index = job / config->page_count / config->memory_count;
+    memset(result, 0, sizeof(*result));
+    result->strategy = config->strategies[strategy_index];
+    result->memory_size = config->memory_sizes[memory_index];
+    result->page_size = config->page_sizes[page_index];
+
+    uint64_t pages = result->memory_size / result->page_size;
+    if (pages == 0) {
+        result->status = SWEEP_SKIPPED;
+        return;
+    }
+    // Compaction moves whole pages, so its budget is counted in them too
+    CompactionPolicy compaction = config->compaction;
+    compaction.budget = compaction.budget / result->page_size ? compaction.budget / result->page_size : 1;
+
+    MemoryList memory;
+    initialize_memory(&memory, pages);
+    if (result->strategy == STRATEGY_BUDDY) {
+        buddy_enable(&memory);
+    }
+    int status = simulate_trace_pages(&memory, config->trace, result->strategy, result->page_size, &compaction,
+                                      &result->stats);
+    free_memory(&memory);
+    result->stats.compaction.bytes_moved *= result->page_size;
+    result->status = status == 0 ? SWEEP_OK : SWEEP_FAILED;
+}
+
+static int take_own(SweepDeque *deque, size_t *job) {
+    pthread_mutex_lock(&deque->lock);
+    int found = deque->top < deque->bottom;
+    if (found) {
+        *job = deque->top++;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+// Take the last job of the first other worker that still has one, starting
+// with the next worker up so that thieves spread over their victims
+static int steal(SweepPool *pool, int thief, size_t *job) {
+    for (int i = 1; i < pool->workers; i++) {
+        SweepDeque *victim = &pool->deques[(thief + i) % pool->workers];
+        pthread_mutex_lock(&victim->lock);
+        int found = victim->top < victim->bottom;
+        if (found) {
+            *job = --victim->bottom;
+        }
+        pthread_mutex_unlock(&victim->lock);
+        if (found) {
+            pool->deques[thief].steals++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// No job ever creates another, so once every deque is empty the sweep is done
+static void *worker_main(void *arg) {
+    SweepWorker *worker = arg;
+    SweepPool *pool = worker->pool;
+    size_t job;
+    while (take_own(&pool->deques[worker->id], &job) || steal(pool, worker->id, &job)) {
+        run_point(pool->config, job, &pool->results[job]);
+    }
+    return NULL;
+}
+
+size_t sweep_run(const SweepConfig *config, SweepResult *results) {
+    size_t count = sweep_point_count(config);
+    int workers = config->threads > 0 ? config->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers < 1) workers = 1;
+    if ((size_t)workers > count) workers = count ? (int)count : 1;
+
+    SweepPool pool = {config, results, NULL, workers};
+    pool.deques = aligned_alloc(64, (size_t)workers * sizeof(SweepDeque));
+    SweepWorker *worker_args = malloc((size_t)workers * sizeof(SweepWorker));
+    pthread_t *threads = malloc((size_t)workers * sizeof(pthread_t));
+    if (!pool.deques || !worker_args || !threads) {
+        fprintf(stderr, "Memory allocation failed for sweep workers.\n");
+        exit(1);
+    }
+    // Deal out contiguous slices of the grid
+    for (int w = 0; w < workers; w++) {
+        pthread_mutex_init(&pool.deques[w].lock, NULL);
+        pool.deques[w].top = count * (size_t)w / (size_t)workers;
+        pool.deques[w].bottom = count * (size_t)(w + 1) / (size_t)workers;
+        pool.deques[w].steals = 0;
+        worker_args[w] = (SweepWorker){&pool, w};
+    }
+
+    double started = metrics_now_seconds();
+    // The calling thread works as worker 0
+    int started_threads = 1;
+    for (int w = 1; w < workers; w++, started_threads++) {
+        if (pthread_create(&threads[w], NULL, worker_main, &worker_args[w]) != 0) {
+            fprintf(stderr, "Warning: started only %d sweep threads\n", started_threads);
+            break;
+        }
+    }
+    worker_main(&worker_args[0]);
+    for (int w = 1; w < started_threads; w++) {
+        pthread_join(threads[w], NULL);
+    }
+    // Jobs of workers that never started were stolen by the others
+
+    size_t failed = 0;
+    unsigned long long steals = 0;
+    for (size_t i = 0; i < count; i++) {
+        failed += results[i].status == SWEEP_FAILED;
+    }
+    for (int w = 0; w < workers; w++) {
+        steals += pool.deques[w].steals;
+        pthread_mutex_destroy(&pool.deques[w].lock);
+    }
+    fprintf(stderr, "Swept %zu points on %d threads in %.3f s (%llu stolen, %zu failed)\n", count,
+            started_threads, metrics_now_seconds() - started, steals, failed);
+    free(threads);
+    free(worker_args);
+    free(pool.deques);
+    return failed;
+}
+
+// Derived columns shared by both output formats
+static double average_wait(const SimulationStats *stats) {
+    return stats->allocated ? (double)stats->total_wait_time / (double)stats->allocated : 0.0;
+}
+
+static double rounding_waste(const SimulationStats *stats) {
+    return stats->granted_bytes
+               ? 100.0 * (double)(stats->granted_bytes - stats->requested_bytes) / (double)stats->granted_bytes
+               : 0.0;
+}
+
+void sweep_write_csv(FILE *output, const SweepResult *results, size_t count) {
+    fprintf(output, "strategy,memory_size,page_size,status,arrived,allocated,completed,rejected,average_wait,"
+                    "max_waiting,requested,granted,rounding_waste_percent,peak_live_processes,compaction_passes,"
+                    "units_moved,end_time,events,elapsed_seconds\n");
+    for (size_t i = 0; i < count; i++) {
+        const SweepResult *result = &results[i];
+        const SimulationStats *stats = &result->stats;
+        fprintf(output,
+                "%s,%" PRIu64 ",%" PRIu64 ",%s,%lld,%lld,%lld,%lld,%.4f,%zu,%" PRIu64 ",%" PRIu64
+                ",%.4f,%zu,%" PRIu64 ",%" PRIu64 ",%lld,%lld,%.6f\n",
+                strategy_name(result->strategy), result->memory_size, result->page_size,
+                status_name(result->status), stats->arrived, stats->allocated, stats->completed, stats->rejected,
+                average_wait(stats), stats->max_waiting, stats->requested_bytes, stats->granted_bytes,
+                rounding_waste(stats), stats->peak_live_processes, stats->compaction.passes,
+                stats->compaction.bytes_moved, stats->end_time, stats->events, stats->elapsed_seconds);
+    }
+}
+
+void sweep_write_json(FILE *output, const SweepResult *results, size_t count) {
+    fprintf(output, "[\n");
+    for (size_t i = 0; i < count; i++) {
+        const SweepResult *result = &results[i];
+        const SimulationStats *stats = &result->stats;
+        fprintf(output,
+                "  {\"strategy\": \"%s\", \"memory_size\": %" PRIu64 ", \"page_size\": %" PRIu64
+                ", \"status\": \"%s\", \"arrived\": %lld, \"allocated\": %lld, \"completed\": %lld"
+                ", \"rejected\": %lld, \"average_wait\": %.4f, \"max_waiting\": %zu, \"requested\": %" PRIu64
+                ", \"granted\": %" PRIu64 ", \"rounding_waste_percent\": %.4f, \"peak_live_processes\": %zu"
+                ", \"compaction_passes\": %" PRIu64 ", \"units_moved\": %" PRIu64
+                ", \"end_time\": %lld, \"events\": %lld, \"elapsed_seconds\": %.6f}%s\n",
+                strategy_name(result->strategy), result->memory_size, result->page_size,
+                status_name(result->status), stats->arrived, stats->allocated, stats->completed, stats->rejected,
+                average_wait(stats), stats->max_waiting, stats->requested_bytes, stats->granted_bytes,
+                rounding_waste(stats), stats->peak_live_processes, stats->compaction.passes,
+                stats->compaction.bytes_moved, stats->end_time, stats->events, stats->elapsed_seconds,
+                i + 1 < count ? "," : "");
+    }
+    fprintf(output, "]\n");
+}
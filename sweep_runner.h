@@ -0,0 +1,48 @@
+#ifndef SWEEP_RUNNER_H
+#define SWEEP_RUNNER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "simulation.h"
+
+// Replays one trace under every combination of placement strategy, memory
+// size and page size. The grid points are independent simulations, run on
+// a pool of threads that each build their own memory map and event queues
+// and share nothing but the read-only trace file. Jobs are dealt out to
+// per-worker deques up front; a worker that runs out steals from the far
+// end of another's, so uneven job costs still keep every core busy.
+
+#define SWEEP_MAX_STRATEGIES 3
+
+typedef struct {
+    const char *trace;
+    PlacementStrategy strategies[SWEEP_MAX_STRATEGIES];
+    size_t strategy_count;
+    const uint64_t *memory_sizes;  // In trace units
+    size_t memory_count;
+    const uint64_t *page_sizes;    // Allocation granularity, in trace units
+    size_t page_count;
+    CompactionPolicy compaction;   // Applied to every fit strategy point
+    int threads;                   // 0 uses one per online CPU
+} SweepConfig;
+
+typedef enum { SWEEP_OK, SWEEP_FAILED, SWEEP_SKIPPED } SweepStatus;
+
+typedef struct {
+    PlacementStrategy strategy;
+    uint64_t memory_size, page_size;
+    SweepStatus status;  // SKIPPED when the memory holds no whole page
+    SimulationStats stats;
+} SweepResult;
+
+// Number of grid points, and so of results sweep_run fills in
+size_t sweep_point_count(const SweepConfig *config);
+// Run every point of the grid. results receives one entry per point in
+// grid order (strategy, then memory size, then page size) whichever thread
+// ran it. Returns the number of points that failed. A one-line summary of
+// the run goes to stderr.
+size_t sweep_run(const SweepConfig *config, SweepResult *results);
+void sweep_write_csv(FILE *output, const SweepResult *results, size_t count);
+void sweep_write_json(FILE *output, const SweepResult *results, size_t count);
+
+#endif // SWEEP_RUNNER_H
@@ -0,0 +1,26 @@
+#!/bin/sh
+# Resolve the "(module+0xOFFSET)" frames of a leak report to function names
+# and source lines. Reads the report from a file or standard input:
+#
+#   ./symbolize_leaks.sh leaks.txt
+#
+# Needs addr2line (binutils); modules should be built with -g for lines.
+awk '
+    match($0, /\(([^()+]+)\+(0x[0-9a-fA-F]+)\)$/) {
+        frame = substr($0, RSTART + 1, RLENGTH - 2)
+        split_at = index(frame, "+0x")
+        module = substr(frame, 1, split_at - 1)
+        offset = substr(frame, split_at + 1)
+        command = "addr2line -f -C -i -p -e \"" module "\" " offset " 2>/dev/null"
+        resolved = ""
+        while ((command | getline line) > 0) {
+            resolved = resolved (resolved == "" ? "" : " / ") line
+        }
+        close(command)
+        if (resolved != "" && resolved !~ /^\?\?/) {
+            print $0 " " resolved
+            next
+        }
+    }
+    { print }
+' "$@"
@@ -0,0 +1,59 @@
+#include "tlb.h"
+#include <stdlib.h>
+#include <string.h>
+
+int tlb_init(Tlb *tlb, uint32_t entries, uint32_t ways) {
+    memset(tlb, 0, sizeof(*tlb));
+    if (ways == 0 || entries == 0 || entries % ways != 0) {
+        return 0;
+    }
+    uint32_t sets = entries / ways;
+    if ((sets & (sets - 1)) != 0) {
+        return 0;
+    }
+    tlb->set_count = sets;
+    tlb->ways = ways;
+    tlb->tags = malloc((size_t)entries * sizeof(uint32_t));
+    if (!tlb->tags) {
+        return 0;
+    }
+    memset(tlb->tags, 0xff, (size_t)entries * sizeof(uint32_t));  // TLB_EMPTY
+    return 1;
+}
+
+void tlb_destroy(Tlb *tlb) {
+    free(tlb->tags);
+    tlb->tags = NULL;
+}
+
+int tlb_access(Tlb *tlb, uint32_t page) {
+    uint32_t *set = tlb->tags + (size_t)(page & (tlb->set_count - 1)) * tlb->ways;
+    uint32_t way = 0;
+    while (way < tlb->ways && set[way] != page) {
+        way++;
+    }
+    int hit = way < tlb->ways;
+    if (!hit) {
+        way = tlb->ways - 1;  // The least recently used way makes room
+    }
+    // Shift the more recent ways down one place and put the page in front
+    memmove(set + 1, set, way * sizeof(uint32_t));
+    set[0] = page;
+    if (hit) {
+        tlb->hits++;
+    } else {
+        tlb->misses++;
+    }
+    return hit;
+}
+
+void tlb_invalidate(Tlb *tlb, uint32_t page) {
+    uint32_t *set = tlb->tags + (size_t)(page & (tlb->set_count - 1)) * tlb->ways;
+    for (uint32_t way = 0; way < tlb->ways; way++) {
+        if (set[way] == page) {
+            memmove(set + way, set + way + 1, (tlb->ways - way - 1) * sizeof(uint32_t));
+            set[tlb->ways - 1] = TLB_EMPTY;
+            return;
+        }
+    }
+}
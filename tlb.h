@@ -0,0 +1,28 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include <stdint.h>
+
+// Set-associative translation lookaside buffer. A virtual page maps to set
+// page % set_count and may sit in any of its ways; each set is kept in
+// most-recently-used order, so a miss replaces its least recently used way.
+
+typedef struct {
+    uint32_t set_count, ways;
+    uint32_t *tags;  // set_count * ways pages, TLB_EMPTY when unused
+    uint64_t hits, misses;
+} Tlb;
+
+#define TLB_EMPTY UINT32_MAX
+
+// entries must be a multiple of ways and entries / ways a power of two.
+// Returns 0 on invalid sizes or when memory ran out.
+int tlb_init(Tlb *tlb, uint32_t entries, uint32_t ways);
+void tlb_destroy(Tlb *tlb);
+// Look a page up; returns 1 on a hit. Either way the page ends up as the
+// most recent entry of its set.
+int tlb_access(Tlb *tlb, uint32_t page);
+// Drop a page's translation, e.g. when it is evicted from memory
+void tlb_invalidate(Tlb *tlb, uint32_t page);
+
+#endif // TLB_H
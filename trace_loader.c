@@ -0,0 +1,263 @@
+#include "trace_loader.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Consumed input is dropped from the mapping in chunks of this size, so a
+// trace larger than RAM never stays resident
+#define TRACE_RELEASE_CHUNK (64UL << 20)
+
+int trace_open(TraceReader *reader, const char *filename) {
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = open(filename, O_RDONLY);
+    if (reader->fd < 0) {
+        perror(filename);
+        return -1;
+    }
+    struct stat info;
+    if (fstat(reader->fd, &info) < 0) {
+        perror(filename);
+        close(reader->fd);
+        return -1;
+    }
+    reader->size = (size_t)info.st_size;
+    if (reader->size > 0) {
+        void *data = mmap(NULL, reader->size, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+        if (data == MAP_FAILED) {
+            perror(filename);
+            close(reader->fd);
+            return -1;
+        }
+        madvise(data, reader->size, MADV_SEQUENTIAL);
+        reader->data = data;
+    }
+    reader->end = reader->size;
+
+    if (reader->size >= sizeof(TraceHeader) && memcmp(reader->data, TRACE_MAGIC, 4) == 0) {
+        TraceHeader header;
+        memcpy(&header, reader->data, sizeof(header));
+        if (header.version != TRACE_VERSION ||
+            header.record_count > (reader->size - sizeof(header)) / sizeof(TraceRecord)) {
+            fprintf(stderr, "%s: unsupported or truncated binary trace\n", filename);
+            trace_close(reader);
+            return -1;
+        }
+        reader->binary = 1;
+        reader->offset = sizeof(header);
+        reader->end = sizeof(header) + header.record_count * sizeof(TraceRecord);
+    }
+    return 0;
+}
+
+void trace_close(TraceReader *reader) {
+    if (reader->data) {
+        munmap((void *)reader->data, reader->size);
+    }
+    if (reader->fd >= 0) {
+        close(reader->fd);
+    }
+    reader->data = NULL;
+    reader->fd = -1;
+}
+
+// Hand fully consumed chunks of the mapping back to the kernel
+static void release_consumed(TraceReader *reader) {
+    if (reader->offset - reader->released < TRACE_RELEASE_CHUNK) {
+        return;
+    }
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t end = reader->offset & ~(page - 1);
+    madvise((void *)(reader->data + reader->released), end - reader->released, MADV_DONTNEED);
+    reader->released = end;
+}
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Parse a non-negative decimal integer no larger than limit without
+// leaving the mapping
+static int parse_number(const char **cursor, const char *end, uint64_t limit, uint64_t *value) {
+    const char *p = *cursor;
+    uint64_t result = 0;
+    while (p < end && is_space(*p)) p++;
+    if (p == end || *p < '0' || *p > '9') {
+        return 0;
+    }
+    while (p < end && *p >= '0' && *p <= '9') {
+        unsigned digit = (unsigned)(*p++ - '0');
+        if (result > (limit - digit) / 10) return 0;
+        result = result * 10 + digit;
+    }
+    *value = result;
+    *cursor = p;
+    return 1;
+}
+
+static int parse_int(const char **cursor, const char *end, int *value) {
+    uint64_t result;
+    if (!parse_number(cursor, end, INT32_MAX, &result)) return 0;
+    *value = (int)result;
+    return 1;
+}
+
+static int next_text(TraceReader *reader, Process *process) {
+    const char *end = reader->data + reader->end;
+    for (;;) {
+        const char *p = reader->data + reader->offset;
+        if (p >= end) {
+            return 0;
+        }
+        const char *line_end = memchr(p, '\n', (size_t)(end - p));
+        if (!line_end) line_end = end;
+        reader->offset = (size_t)(line_end - reader->data) + (line_end < end);
+        reader->line++;
+
+        while (p < line_end && is_space(*p)) p++;
+        if (p == line_end || *p == '#') {
+            continue;
+        }
+
+        const char *code = p;
+        while (p < line_end && !is_space(*p)) p++;
+        size_t length = (size_t)(p - code);
+        if (length >= sizeof(process->code)) {
+            return -1;
+        }
+        memcpy(process->code, code, length);
+        process->code[length] = '\0';
+
+        if (!parse_int(&p, line_end, &process->arrival_date) ||
+            !parse_number(&p, line_end, UINT64_MAX, &process->memory_required) ||
+            !parse_int(&p, line_end, &process->execution_time)) {
+            return -1;
+        }
+        while (p < line_end && is_space(*p)) p++;
+        return p == line_end ? 1 : -1;
+    }
+}
+
+static int next_binary(TraceReader *reader, Process *process) {
+    if (reader->offset + sizeof(TraceRecord) > reader->end) {
+        return 0;
+    }
+    TraceRecord record;
+    memcpy(&record, reader->data + reader->offset, sizeof(record));
+    reader->offset += sizeof(record);
+    reader->line++;
+
+    // Same limits as the text format
+    if (memchr(record.code, '\0', sizeof(process->code)) == NULL || record.arrival_date < 0 ||
+        record.execution_time < 0) {
+        return -1;
+    }
+    memcpy(process->code, record.code, sizeof(process->code));
+    process->arrival_date = record.arrival_date;
+    process->memory_required = record.memory_required;
+    process->execution_time = record.execution_time;
+    return 1;
+}
+
+int trace_next(TraceReader *reader, Process *process) {
+    int result = reader->binary ? next_binary(reader, process) : next_text(reader, process);
+    if (result == 1) {
+        process->allocation_status = 'N';
+        process->waiting_status = 'N';
+        process->block = NO_BLOCK;
+        process->next = NULL;
+        process->previous = NULL;
+        release_consumed(reader);
+    }
+    return result;
+}
+
+int convert_trace(const char *input_filename, const char *output_filename) {
+    TraceReader reader;
+    if (trace_open(&reader, input_filename) < 0) {
+        return -1;
+    }
+    FILE *output = fopen(output_filename, "wb");
+    if (!output) {
+        perror(output_filename);
+        trace_close(&reader);
+        return -1;
+    }
+
+    // The record count is patched in once the input has been read
+    TraceHeader header = {{'M', 'A', 'T', 'R'}, TRACE_VERSION, 0};
+    fwrite(&header, sizeof(header), 1, output);
+
+    Process process;
+    int result;
+    while ((result = trace_next(&reader, &process)) == 1) {
+        TraceRecord record = {process.memory_required, process.arrival_date, process.execution_time, {0}};
+        memcpy(record.code, process.code, sizeof(process.code));
+        fwrite(&record, sizeof(record), 1, output);
+        header.record_count++;
+    }
+    if (result < 0) {
+        fprintf(stderr, "%s: malformed entry at line %lld\n", input_filename, reader.line);
+    }
+    fseek(output, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, output);
+    int failed = ferror(output);
+    fclose(output);
+    trace_close(&reader);
+    return result < 0 || failed ? -1 : 0;
+}
+
+// Check that every entry of a trace file parses and that arrival dates
+// never go backwards. Returns 1 for a valid file.
+int validate_file_format(const char *filename) {
+    TraceReader reader;
+    if (trace_open(&reader, filename) < 0) {
+        return 0;
+    }
+    Process process;
+    int result, last_arrival = 0;
+    while ((result = trace_next(&reader, &process)) == 1) {
+        if (process.arrival_date < last_arrival) {
+            fprintf(stderr, "%s: arrival dates go backwards at line %lld\n", filename, reader.line);
+            trace_close(&reader);
+            return 0;
+        }
+        last_arrival = process.arrival_date;
+    }
+    if (result < 0) {
+        fprintf(stderr, "%s: malformed entry at line %lld\n", filename, reader.line);
+    }
+    trace_close(&reader);
+    return result == 0;
+}
+
+// Append every process of a trace file to the process list
+void load_processes_from_file(ProcessList *process_list, const char *filename) {
+    TraceReader reader;
+    if (trace_open(&reader, filename) < 0) {
+        return;
+    }
+    Process process;
+    int result, loaded = 0;
+    while ((result = trace_next(&reader, &process)) == 1) {
+        Process *new_process = pool_alloc(&process_list->process_pool);
+        *new_process = process;
+        new_process->previous = process_list->tail;
+        if (process_list->tail) {
+            process_list->tail->next = new_process;
+        } else {
+            process_list->head = new_process;
+        }
+        process_list->tail = new_process;
+        process_list->total_to_allocate++;
+        loaded++;
+    }
+    if (result < 0) {
+        printf("Error: malformed entry at line %lld of %s\n", reader.line, filename);
+    }
+    printf("%d process(es) loaded from %s\n", loaded, filename);
+    trace_close(&reader);
+}
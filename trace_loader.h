@@ -0,0 +1,49 @@
+#ifndef TRACE_LOADER_H
+#define TRACE_LOADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mem_allocate.h"
+
+// Process traces are read through a read-only memory mapping in a single
+// pass. Two formats are accepted:
+//
+//   text   one process per line: "code arrival_date memory_required
+//          execution_time", blank lines and lines starting with '#' ignored
+//   binary TraceHeader followed by record_count 32-byte TraceRecords
+//
+// Both must be sorted by arrival_date to be replayed as a stream.
+
+#define TRACE_MAGIC "MATR"
+#define TRACE_VERSION 1
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t record_count;
+} TraceHeader;
+
+typedef struct {
+    uint64_t memory_required;
+    int32_t arrival_date, execution_time;
+    char code[16];  // NUL-terminated, at most 9 characters like Process.code
+} TraceRecord;
+
+typedef struct {
+    int fd;
+    const char *data;
+    size_t size, end, offset;  // Mapping size, end of trace data, read position
+    size_t released;  // Bytes already handed back to the kernel
+    int binary;
+    long long line;   // Line (text) or record (binary) number of the last read
+} TraceReader;
+
+int trace_open(TraceReader *reader, const char *filename);
+// Read the next process into *process. Returns 1 on success, 0 at the end
+// of the trace and -1 on a malformed line.
+int trace_next(TraceReader *reader, Process *process);
+void trace_close(TraceReader *reader);
+// Convert any readable trace into the binary format
+int convert_trace(const char *input_filename, const char *output_filename);
+
+#endif // TRACE_LOADER_H
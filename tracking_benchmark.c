@@ -0,0 +1,152 @@
+// Measures the cost of allocation tracking under thread contention. Every
+// thread runs the same malloc/free loop, keeping a small window of live
+// blocks, in four modes:
+//   none     - plain malloc and free
+//   locked   - one mutex around a single allocation table
+//   sharded  - the per-thread buffers and sharded tables of allocation_tracker.c
+//   sampled  - the sharded tracker fed only by heap_sampler.c's Poisson sample
+//
+// Usage: tracking_benchmark [operations_per_thread] [max_threads] [sample_interval]
+//
+// cpu_ns_per_operation is a thread's CPU time over its own operations,
+// averaged over the threads; time asleep on a lock is not counted.
+
+#include "allocation_table.h"
+#include "allocation_tracker.h"
+#include "heap_sampler.h"
+#include "metrics.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define LIVE_WINDOW 32
+#define MAX_THREADS 64
+
+typedef enum { MODE_NONE, MODE_LOCKED, MODE_SHARDED, MODE_SAMPLED } TrackingMode;
+
+static const char *mode_names[] = {"none", "locked", "sharded", "sampled"};
+
+typedef struct {
+    TrackingMode mode;
+    long operations;
+    unsigned seed;
+    double cpu_seconds;  // Set by the worker
+} WorkerArguments;
+
+static pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
+static AllocationTable global_table;
+
+static void *tracked_malloc(TrackingMode mode, size_t size) {
+    void *ptr = malloc(size);
+    if (mode == MODE_LOCKED) {
+        pthread_mutex_lock(&global_lock);
+        table_insert(&global_table, ptr, size, 0);
+        pthread_mutex_unlock(&global_lock);
+    } else if (mode == MODE_SHARDED) {
+        tracker_alloc(ptr, size, 0);
+    } else if (mode == MODE_SAMPLED && sample_allocation(size)) {
+        sampler_mark(ptr);
+        tracker_alloc(ptr, size, 0);
+    }
+    return ptr;
+}
+
+static void tracked_free(TrackingMode mode, void *ptr) {
+    if (mode == MODE_LOCKED) {
+        pthread_mutex_lock(&global_lock);
+        table_remove(&global_table, ptr, NULL);
+        pthread_mutex_unlock(&global_lock);
+    } else if (mode == MODE_SHARDED) {
+        tracker_free(ptr);
+    } else if (mode == MODE_SAMPLED && sampler_may_hold(ptr) && tracker_free(ptr)) {
+        sampler_unmark(ptr);
+    }
+    free(ptr);
+}
+
+static double thread_cpu_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void *worker(void *argument) {
+    WorkerArguments *arguments = argument;
+    double started = thread_cpu_seconds();
+    void *live[LIVE_WINDOW] = {0};
+    unsigned state = arguments->seed;
+    for (long i = 0; i < arguments->operations; i++) {
+        unsigned slot = (unsigned)i % LIVE_WINDOW;
+        if (live[slot]) {
+            tracked_free(arguments->mode, live[slot]);
+        }
+        state = state * 1103515245u + 12345u;
+        live[slot] = tracked_malloc(arguments->mode, 16 + (state >> 16) % 1009);
+    }
+    for (unsigned slot = 0; slot < LIVE_WINDOW; slot++) {
+        if (live[slot]) tracked_free(arguments->mode, live[slot]);
+    }
+    if (arguments->mode == MODE_SHARDED || arguments->mode == MODE_SAMPLED) {
+        tracker_flush();
+    }
+    arguments->cpu_seconds = thread_cpu_seconds() - started;
+    return NULL;
+}
+
+// Returns the wall time taken by all threads together and stores the CPU
+// time of the average thread
+static double run(TrackingMode mode, int threads, long operations, double *cpu_seconds) {
+    pthread_t ids[MAX_THREADS];
+    WorkerArguments arguments[MAX_THREADS];
+    double started = metrics_now_seconds();
+    for (int t = 0; t < threads; t++) {
+        arguments[t] = (WorkerArguments){mode, operations, (unsigned)t * 7919u + 1, 0};
+        pthread_create(&ids[t], NULL, worker, &arguments[t]);
+    }
+    *cpu_seconds = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+        *cpu_seconds += arguments[t].cpu_seconds / threads;
+    }
+    return metrics_now_seconds() - started;
+}
+
+int main(int argc, char *argv[]) {
+    long operations = argc > 1 ? atol(argv[1]) : 1000000;
+    int max_threads = argc > 2 ? atoi(argv[2]) : MAX_THREADS;
+    long sample_interval = argc > 3 ? atol(argv[3]) : 512 * 1024;
+    if (operations <= 0 || max_threads <= 0 || max_threads > MAX_THREADS || sample_interval <= 0) {
+        fprintf(stderr, "Usage: %s [operations_per_thread] [max_threads <= %d] [sample_interval]\n", argv[0],
+                MAX_THREADS);
+        return 1;
+    }
+    table_init(&global_table);
+    tracker_init();
+    sampler_init((size_t)sample_interval);
+
+    printf("threads,mode,seconds,mops_per_second,cpu_ns_per_operation,overhead\n");
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        double baseline = 0;
+        for (TrackingMode mode = MODE_NONE; mode <= MODE_SAMPLED; mode++) {
+            double cpu_seconds;
+            double seconds = run(mode, threads, operations, &cpu_seconds);
+            double total = (double)operations * threads;
+            if (mode == MODE_NONE) baseline = seconds;
+            if (mode == MODE_SHARDED || mode == MODE_SAMPLED) {
+                // Everything was freed, so nothing may remain tracked
+                AllocationTable remaining;
+                table_init(&remaining);
+                tracker_collect(&remaining);
+                if (remaining.live_count) {
+                    fprintf(stderr, "%s tracker still holds %zu block(s)\n", mode_names[mode], remaining.live_count);
+                }
+                table_destroy(&remaining);
+            }
+            printf("%d,%s,%.3f,%.2f,%.1f,%.2fx\n", threads, mode_names[mode], seconds, total / seconds / 1e6,
+                   cpu_seconds * 1e9 / (double)operations, seconds / baseline);
+        }
+    }
+    table_destroy(&global_table);
+    return 0;
+}